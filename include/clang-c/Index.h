@@ -32,7 +32,7 @@
  * compatible, thus CINDEX_VERSION_MAJOR is expected to remain stable.
  */
 #define CINDEX_VERSION_MAJOR 0
-#define CINDEX_VERSION_MINOR 59
+#define CINDEX_VERSION_MINOR 60
 
 #define CINDEX_VERSION_ENCODE(major, minor) ( \
       ((major) * 10000)                       \
@@ -347,6 +347,22 @@ CINDEX_LINKAGE unsigned clang_CXIndex_getGlobalOptions(CXIndex);
 CINDEX_LINKAGE void
 clang_CXIndex_setInvocationEmissionPathOption(CXIndex, const char *Path);
 
+/**
+ * Sets the preamble store option in a CXIndex.
+ *
+ * The preamble store is a directory through which the precompiled preambles
+ * of translation units parsed with this index are shared, with other indexes
+ * and with other processes that use the same directory. A translation unit
+ * whose preamble was already built with the same options reuses it instead of
+ * building it again. A null value (default) disables the store.
+ *
+ * \param MaxSize The size, in bytes, that the store is trimmed to by removing
+ * the least recently used preambles. Zero means there is no limit.
+ */
+CINDEX_LINKAGE void
+clang_CXIndex_setPreambleStoreOption(CXIndex, const char *Path,
+                                     unsigned long long MaxSize);
+
 /**
  * \defgroup CINDEX_FILES File manipulation routines
  *
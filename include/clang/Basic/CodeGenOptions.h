@@ -196,6 +196,10 @@ public:
   /// Output filename for the split debug info, not used in the skeleton CU.
   std::string SplitDwarfOutput;
 
+  /// Output filenames for the partitions of the module after the first one,
+  /// when generating code for them concurrently.
+  std::vector<std::string> ParallelCodeGenOutputs;
+
   /// The name of the relocation model to use.
   llvm::Reloc::Model RelocationModel;
 
@@ -39,6 +39,7 @@ class MemoryBuffer;
 namespace clang {
 
 class FileSystemStatCache;
+class SharedFileSystemCache;
 
 /// Cached information about one directory (either on disk or in
 /// the virtual file system).
@@ -164,9 +165,18 @@ class FileManager : public RefCountedBase<FileManager> {
   // Caching.
   std::unique_ptr<FileSystemStatCache> StatCache;
 
+  /// The stats and file contents shared with the FileManagers of other
+  /// threads, if any.
+  IntrusiveRefCntPtr<SharedFileSystemCache> SharedCache;
+
   bool getStatValue(StringRef Path, llvm::vfs::Status &Status, bool isFile,
                     std::unique_ptr<llvm::vfs::File> *F);
 
+  /// Read the contents of \p Entry, bypassing the shared cache.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  readBufferForFile(const FileEntry *Entry, uint64_t FileSize, bool isVolatile,
+                    bool ShouldCloseOpenFile, bool RequiresNullTerminator);
+
   /// Add all ancestors of the given path (pointing to either a file
   /// or a directory) as virtual directories.
   void addAncestorsAsVirtualDirs(StringRef Path);
@@ -195,6 +205,12 @@ public:
   /// Removes the FileSystemStatCache object from the manager.
   void clearStatCache();
 
+  /// Share the stats of real files and directories and the contents of real
+  /// files with the other FileManagers using \p Cache.
+  void setSharedCache(IntrusiveRefCntPtr<SharedFileSystemCache> Cache);
+
+  SharedFileSystemCache *getSharedCache() const { return SharedCache.get(); }
+
   /// Lookup, cache, and verify the specified directory (real or
   /// virtual).
   ///
@@ -232,9 +248,13 @@ public:
 
   /// Open the specified file as a MemoryBuffer, returning a new
   /// MemoryBuffer if successful, otherwise returning null.
+  ///
+  /// Files that need no null terminator, like module files, can always be
+  /// memory mapped rather than only when their size allows it.
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
   getBufferForFile(const FileEntry *Entry, bool isVolatile = false,
-                   bool ShouldCloseOpenFile = true);
+                   bool ShouldCloseOpenFile = true,
+                   bool RequiresNullTerminator = true);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
   getBufferForFile(StringRef Filename, bool isVolatile = false);
 
@@ -15,6 +15,7 @@
 #define LLVM_CLANG_BASIC_FILESYSTEMSTATCACHE_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Allocator.h"
@@ -22,10 +23,16 @@
 #include "llvm/Support/VirtualFileSystem.h"
 #include <cstdint>
 #include <ctime>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
+namespace llvm {
+class MemoryBuffer;
+} // namespace llvm
+
 namespace clang {
 
 /// Abstract interface for introducing a FileManager cache for 'stat'
@@ -83,6 +90,78 @@ public:
                           llvm::vfs::FileSystem &FS) override;
 };
 
+/// A cache of 'stat' results and file contents that is shared by the
+/// FileManagers of several threads, e.g. in tools that process many
+/// translation units concurrently, so that the headers they have in common are
+/// only looked up and read once.
+///
+/// Only the successful stats of absolute paths are cached, since files are
+/// often created while compiling (e.g. modules).  The cache does not notice
+/// files that change on disk, call \c invalidate when they may have.  File
+/// contents are keyed by the unique ID of the file, and only reused while its
+/// size and modification time are the ones they were read with.
+///
+/// All the FileManagers sharing a cache must use file systems that agree on
+/// the files at the absolute paths they look up.
+class SharedFileSystemCache
+    : public llvm::ThreadSafeRefCountedBase<SharedFileSystemCache> {
+public:
+  SharedFileSystemCache();
+  ~SharedFileSystemCache();
+
+  /// Like FileSystemStatCache::get, but look up absolute paths in the shared
+  /// cache first.  On a hit, \p F is not filled in.
+  std::error_code getStat(StringRef Path, llvm::vfs::Status &Status,
+                          bool isFile, std::unique_ptr<llvm::vfs::File> *F,
+                          FileSystemStatCache *Cache,
+                          llvm::vfs::FileSystem &FS);
+
+  /// Get the contents of the file with \p UniqueID, if they were read while
+  /// it had \p Size and \p ModTime.
+  ///
+  /// \returns a buffer referring to the shared, null terminated contents, or
+  /// null if they are not cached.
+  std::unique_ptr<llvm::MemoryBuffer>
+  getBuffer(llvm::sys::fs::UniqueID UniqueID, uint64_t Size, time_t ModTime);
+
+  /// Share the null terminated contents of the file with \p UniqueID, read
+  /// while it had \p Size and \p ModTime.
+  ///
+  /// \returns a buffer referring to the shared contents, which are those of
+  /// \p Buffer unless another thread shared them first.
+  std::unique_ptr<llvm::MemoryBuffer>
+  addBuffer(llvm::sys::fs::UniqueID UniqueID, uint64_t Size, time_t ModTime,
+            std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+  /// Forget the stat of \p Path, which may have changed on disk.  Its
+  /// contents are not reused once its size or modification time change.
+  void invalidate(StringRef Path);
+
+private:
+  struct StatShard {
+    std::mutex Lock;
+    llvm::StringMap<llvm::vfs::Status> Stats;
+  };
+
+  struct ContentsEntry {
+    uint64_t Size;
+    time_t ModTime;
+    std::shared_ptr<const llvm::MemoryBuffer> Buffer;
+  };
+
+  struct ContentsShard {
+    std::mutex Lock;
+    std::map<llvm::sys::fs::UniqueID, ContentsEntry> Contents;
+  };
+
+  StatShard &getStatShard(StringRef Path);
+  ContentsShard &getContentsShard(llvm::sys::fs::UniqueID UniqueID);
+
+  unsigned NumShards;
+  std::unique_ptr<StatShard[]> StatShards;
+  std::unique_ptr<ContentsShard[]> ContentsShards;
+};
+
 } // namespace clang
 
 #endif // LLVM_CLANG_BASIC_FILESYSTEMSTATCACHE_H
@@ -42,6 +42,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -88,6 +89,76 @@ namespace SrcMgr {
     return CK == C_User_ModuleMap || CK == C_System_ModuleMap;
   }
 
+  /// The offsets of the lines of a buffer.
+  ///
+  /// The buffer is split into fixed-size chunks. The lines of a chunk are only
+  /// counted, and their offsets only collected, once a query needs them. A
+  /// query on a large buffer thus scans a prefix of the buffer for newlines,
+  /// and allocates the line offsets of a single chunk.
+  class LineOffsetMapping {
+  public:
+    /// The size in bytes of the chunks the buffer is split into.
+    enum { ChunkSize = 16 * 1024 };
+
+    /// Set up the mapping for the null terminated buffer \p Buf of \p Size
+    /// bytes. The tables are allocated from \p Alloc as they are needed.
+    void init(const char *Buf, unsigned Size, llvm::BumpPtrAllocator &Alloc);
+
+    /// Forget the tables, for example because the buffer changed. Their memory
+    /// is owned by the allocator.
+    void clear() { Buf = nullptr; }
+
+    /// Whether the mapping was set up for a buffer.
+    explicit operator bool() const { return Buf != nullptr; }
+
+    /// Returns the 1-based number of the line that contains \p FilePos.
+    unsigned getLineNumber(unsigned FilePos) const;
+
+    /// Returns the offset of the start of the 1-based line \p LineNo, or None
+    /// if the buffer has fewer lines.
+    llvm::Optional<unsigned> getLineStart(unsigned LineNo) const;
+
+    /// Returns the offset of the start of the line with the 0-based index
+    /// \p I, which must exist.
+    unsigned operator[](unsigned I) const {
+      llvm::Optional<unsigned> Start = getLineStart(I + 1);
+      assert(Start && "line index out of range");
+      return *Start;
+    }
+
+    /// Returns the number of lines in the buffer. This counts the lines of
+    /// the whole buffer, but does not collect their offsets.
+    unsigned getNumLines() const;
+
+    /// Returns the number of chunks whose line offsets were collected.
+    unsigned getNumChunksCollected() const;
+
+  private:
+    unsigned getNumChunks() const { return Size / ChunkSize + 1; }
+
+    /// Count the lines of the chunks up to and including \p Chunk.
+    void countLinesUpTo(unsigned Chunk) const;
+
+    /// Returns the offsets of the lines starting in \p Chunk, collecting them
+    /// on the first use.
+    const unsigned *getChunkLineOffsets(unsigned Chunk) const;
+
+    const char *Buf = nullptr;
+    unsigned Size = 0;
+    llvm::BumpPtrAllocator *Alloc = nullptr;
+
+    /// For each chunk that has been counted, the number of lines starting
+    /// before it. The entry after the last counted chunk is valid too.
+    unsigned *FirstLine = nullptr;
+
+    /// The number of chunks whose lines have been counted.
+    mutable unsigned NumChunksCounted = 0;
+
+    /// For each chunk, the offsets of the lines starting in it, or null if
+    /// they were not collected yet.
+    unsigned **ChunkLineOffsets = nullptr;
+  };
+
   /// One instance of this struct is kept for every file loaded or used.
   ///
   /// This object owns the MemoryBuffer object.
@@ -122,16 +193,11 @@ namespace SrcMgr {
     /// with the contents of another file.
     const FileEntry *ContentsEntry;
 
-    /// A bump pointer allocated array of offsets for each source line.
+    /// The offsets of each source line.
     ///
-    /// This is lazily computed.  This is owned by the SourceManager
+    /// This is lazily computed.  The tables are owned by the SourceManager
     /// BumpPointerAllocator object.
-    unsigned *SourceLineCache = nullptr;
-
-    /// The number of lines in this ContentCache.
-    ///
-    /// This is only valid if SourceLineCache is non-null.
-    unsigned NumLines = 0;
+    LineOffsetMapping SourceLineCache;
 
     /// Indicates whether the buffer itself was provided to override
     /// the actual file contents.
@@ -164,11 +230,8 @@ namespace SrcMgr {
       OrigEntry = RHS.OrigEntry;
       ContentsEntry = RHS.ContentsEntry;
 
-      assert(RHS.Buffer.getPointer() == nullptr &&
-             RHS.SourceLineCache == nullptr &&
+      assert(RHS.Buffer.getPointer() == nullptr && !RHS.SourceLineCache &&
              "Passed ContentCache object cannot own a buffer.");
-
-      NumLines = RHS.NumLines;
     }
 
     ContentCache &operator=(const ContentCache& RHS) = delete;
@@ -681,11 +744,10 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// This is referenced by indices from SLocEntryTable.
   std::unique_ptr<LineTableInfo> LineTable;
 
-  /// These ivars serve as a cache used in the getLineNumber
-  /// method which is used to speedup getLineNumber calls to nearby locations.
+  /// These ivars serve as a cache used in the getLineNumber and
+  /// getColumnNumber methods, which are usually called for nearby locations.
   mutable FileID LastLineNoFileIDQuery;
   mutable SrcMgr::ContentCache *LastLineNoContentCache;
-  mutable unsigned LastLineNoFilePos;
   mutable unsigned LastLineNoResult;
 
   /// The file ID for the main source file of the translation unit.
@@ -20,6 +20,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace clang {
 class CompilerInstance;
@@ -89,6 +90,49 @@ parseCrossTUIndex(StringRef IndexPath, StringRef CrossTUDir);
 
 std::string createCrossTUIndexString(const llvm::StringMap<std::string> &Index);
 
+/// This function writes an index in a binary format, an on-disk hash table
+///        that can be queried without reading the whole file.
+///
+/// \p Index maps USRs to file paths, like the textual index does. The paths
+/// are resolved against the CTU directory when the index is read.
+llvm::Error writeCrossTUIndexTable(const llvm::StringMap<std::string> &Index,
+                                   StringRef OutputPath);
+
+/// An index written by writeCrossTUIndexTable.
+///
+/// The file is memory mapped, and a lookup only reads the hash table bucket
+/// of the looked up name and the path of the file it maps to.
+class OnDiskCrossTUIndex {
+public:
+  ~OnDiskCrossTUIndex();
+
+  /// \return Returns true if the file at \p IndexPath is a binary index.
+  static bool isOnDiskIndex(StringRef IndexPath);
+
+  /// Open the binary index at \p IndexPath. The file paths it contains are
+  /// resolved against \p CrossTUDir.
+  static llvm::Expected<std::unique_ptr<OnDiskCrossTUIndex>>
+  create(StringRef IndexPath, StringRef CrossTUDir);
+
+  /// \return Returns the path of the file containing the definition of
+  /// \p LookupName, or None if the index has no such definition.
+  llvm::Optional<std::string> lookup(StringRef LookupName) const;
+
+private:
+  OnDiskCrossTUIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                     StringRef CrossTUDir);
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  std::string CrossTUDir;
+
+  /// The on-disk hash table mapping USRs to file numbers.
+  void *Table = nullptr;
+
+  /// The number of files and the start of their offsets in the buffer.
+  unsigned NumFiles = 0;
+  const unsigned char *FileOffsets = nullptr;
+};
+
 // Returns true if the variable or any field of a record variable is const.
 bool containsConst(const VarDecl *VD, const ASTContext &ACtx);
 
@@ -101,7 +145,10 @@ bool containsConst(const VarDecl *VD, const ASTContext &ACtx);
 /// In order to use this class, an index file is required that describes
 /// the locations of the AST files for each definition.
 ///
-/// Note that this class also implements caching.
+/// Note that this class also implements caching. The loaded AST files are
+/// kept in memory until the memory they take up exceeds the budget set by the
+/// ctu-memory-budget analyzer option, at which point the least recently used
+/// ones are unloaded.
 class CrossTranslationUnitContext {
 public:
   CrossTranslationUnitContext(CompilerInstance &CI);
@@ -172,9 +219,15 @@ public:
   /// object that is returned here).
   /// If any error happens (ToLoc is a non-imported source location) empty is
   /// returned.
+  /// Locations imported from an AST that has been unloaded since are treated
+  /// as non-imported ones.
   llvm::Optional<std::pair<SourceLocation /*FromLoc*/, ASTUnit *>>
   getImportedFromSourceLocation(const clang::SourceLocation &ToLoc) const;
 
+  /// Set the amount of memory, in bytes, the loaded AST files may take up
+  /// before the least recently used ones are unloaded. 0 means no limit.
+  void setMemoryBudget(uint64_t Bytes) { MemoryBudget = Bytes; }
+
 private:
   using ImportedFileIDMap =
       llvm::DenseMap<FileID, std::pair<FileID, ASTUnit *>>;
@@ -192,9 +245,28 @@ private:
   template <typename T>
   llvm::Expected<const T *> importDefinitionImpl(const T *D, ASTUnit *Unit);
 
-  llvm::StringMap<std::unique_ptr<clang::ASTUnit>> FileASTUnitMap;
-  llvm::StringMap<clang::ASTUnit *> NameASTUnitMap;
+  /// Unload the least recently used ASTs, other than \p InUse, until the
+  /// loaded ones fit in the memory budget.
+  void enforceMemoryBudget(const ASTUnit *InUse, bool DisplayCTUProgress);
+
+  /// An AST file loaded by loadExternalAST. \p Unit is null if the file could
+  /// not be loaded. The entry of an evicted AST is kept, so reloading it is not
+  /// counted against the load threshold again.
+  struct LoadedASTUnit {
+    std::unique_ptr<clang::ASTUnit> Unit;
+    /// The value of ASTUseCounter the last time the unit was looked up.
+    uint64_t LastUse = 0;
+    bool Evicted = false;
+  };
+
+  void evictASTUnit(llvm::StringMapEntry<LoadedASTUnit> &Entry,
+                    bool DisplayCTUProgress);
+
+  llvm::StringMap<LoadedASTUnit> FileASTUnitMap;
+  llvm::StringMap<LoadedASTUnit *> NameASTUnitMap;
   llvm::StringMap<std::string> NameFileMap;
+  /// Used instead of NameFileMap when the index is in the binary format.
+  std::unique_ptr<OnDiskCrossTUIndex> OnDiskIndex;
   llvm::DenseMap<TranslationUnitDecl *, std::unique_ptr<ASTImporter>>
       ASTUnitImporterMap;
   CompilerInstance &CI;
@@ -213,6 +285,10 @@ private:
   /// imported in order to reduce the memory footprint of CTU analysis.
   const unsigned CTULoadThreshold;
   unsigned NumASTLoaded{0u};
+  /// The amount of memory the loaded ASTs may take up, in bytes. 0 means no
+  /// limit.
+  uint64_t MemoryBudget;
+  uint64_t ASTUseCounter{0u};
 };
 
 } // namespace cross_tu
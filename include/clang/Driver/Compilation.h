@@ -278,8 +278,28 @@ public:
   /// \return The result code of the subprocess.
   int ExecuteCommand(const Command &C, const Command *&FailingCommand) const;
 
+private:
+  /// Print the command line of \p C to \p OS, or to the CC_PRINT_OPTIONS
+  /// file, if requested.
+  ///
+  /// \return False if the CC_PRINT_OPTIONS file could not be opened.
+  bool PrintCommand(const Command &C, raw_ostream &OS) const;
+
+  /// Execute the independent jobs of \p Jobs on up to \p NumThreads threads.
+  /// The output of the jobs is buffered and replayed in the order of the job
+  /// list, so it does not depend on the scheduling.
+  void ExecuteJobsInParallel(
+      const JobList &Jobs,
+      SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands,
+      unsigned NumThreads) const;
+
+public:
+
   /// ExecuteJob - Execute a single job.
   ///
+  /// The jobs run serially, unless -parallel-jobs= was given in which case the
+  /// jobs whose inputs are available run in parallel.
+  ///
   /// \param FailingCommands - For non-zero results, this will be a vector of
   /// failing commands and their associated result code.
   void ExecuteJobs(
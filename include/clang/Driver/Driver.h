@@ -199,6 +199,12 @@ public:
   /// Whether the driver is generating diagnostics for debugging purposes.
   unsigned CCGenDiagnostics : 1;
 
+  /// Pointer to the -cc1 tool entry point, if the driver is linked into a
+  /// binary that provides one. It is used to run the cc1 jobs in the driver
+  /// process instead of spawning a new one.
+  typedef int (*CC1ToolFunc)(SmallVectorImpl<const char *> &ArgV);
+  CC1ToolFunc CC1Main = nullptr;
+
 private:
   /// Raw target triple.
   std::string TargetTriple;
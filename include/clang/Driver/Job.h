@@ -130,6 +130,28 @@ public:
 
   /// Set whether to print the input filenames when executing.
   void setPrintInputFilenames(bool P) { PrintInputFilenames = P; }
+
+  /// Whether the command will be executed in this process or not.
+  bool InProcess = false;
+
+protected:
+  /// Print the input filenames, if requested by /showFilenames.
+  void PrintFileNames() const;
+};
+
+/// Like Command, but runs the -cc1 tool in the driver process through
+/// Driver::CC1Main instead of spawning a new process.
+class CC1Command : public Command {
+public:
+  CC1Command(const Action &Source, const Tool &Creator,
+             const char *Executable, const llvm::opt::ArgStringList &Arguments,
+             ArrayRef<InputInfo> Inputs);
+
+  void Print(llvm::raw_ostream &OS, const char *Terminator, bool Quote,
+             CrashReportInfo *CrashInfo = nullptr) const override;
+
+  int Execute(ArrayRef<Optional<StringRef>> Redirects, std::string *ErrMsg,
+              bool *ExecutionFailed) const override;
 };
 
 /// Like Command, but with a fallback which is executed in case
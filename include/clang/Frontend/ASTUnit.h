@@ -358,6 +358,10 @@ private:
   /// \brief Enumerator specifying the scope for skipping function bodies.
   SkipFunctionBodiesScope SkipFunctionBodies = SkipFunctionBodiesScope::None;
 
+  /// The store through which precompiled preambles are shared with other
+  /// translation units and processes, if any.
+  std::shared_ptr<PreambleStore> SharedPreambles;
+
   /// Cache any "global" code-completion results, so that we can avoid
   /// recomputing them with each completion.
   void CacheCodeCompletionResults();
@@ -376,6 +380,14 @@ private:
       CompilerInvocation &PreambleInvocationIn,
       IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS, bool AllowRebuild = true,
       unsigned MaxLines = 0);
+
+  /// Try to load the preamble of \p MainFileBuffer from SharedPreambles.
+  ///
+  /// \returns true if a preamble was loaded.
+  bool loadPreambleFromStore(CompilerInvocation &PreambleInvocationIn,
+                             const llvm::MemoryBuffer *MainFileBuffer,
+                             PreambleBounds Bounds,
+                             llvm::vfs::FileSystem &VFS);
   void RealizeTopLevelDeclsFromPreamble();
 
   /// Transfers ownership of the objects (like SourceManager) from
@@ -771,6 +783,10 @@ public:
   ///
   /// \param Diags - The diagnostics engine to use for reporting errors; its
   /// lifetime is expected to extend past that of the returned ASTUnit.
+  ///
+  /// \param Preambles - If non-null, precompiled preambles are looked up in
+  /// and published to this store, so that they are shared with other
+  /// translation units and processes.
   //
   // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
   // shouldn't need to specify them at construction time.
@@ -784,7 +800,8 @@ public:
       TranslationUnitKind TUKind = TU_Complete,
       bool CacheCodeCompletionResults = false,
       bool IncludeBriefCommentsInCodeCompletion = false,
-      bool UserFilesAreVolatile = false);
+      bool UserFilesAreVolatile = false,
+      std::shared_ptr<PreambleStore> Preambles = nullptr);
 
   /// LoadFromCommandLine - Create an ASTUnit from a vector of command line
   /// arguments, which must specify exactly one source file.
@@ -813,6 +830,10 @@ public:
   /// it(i.e., be an overlay over RealFileSystem). RealFileSystem will be used
   /// if \p VFS is nullptr.
   ///
+  /// \param Preambles - If non-null, precompiled preambles are looked up in
+  /// and published to this store, so that they are shared with other
+  /// translation units and processes.
+  ///
   // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
   // shouldn't need to specify them at construction time.
   static ASTUnit *LoadFromCommandLine(
@@ -834,7 +855,8 @@ public:
       bool ForSerialization = false,
       llvm::Optional<StringRef> ModuleFormat = llvm::None,
       std::unique_ptr<ASTUnit> *ErrAST = nullptr,
-      IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS = nullptr);
+      IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS = nullptr,
+      std::shared_ptr<PreambleStore> Preambles = nullptr);
 
   /// Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
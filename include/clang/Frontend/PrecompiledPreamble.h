@@ -16,6 +16,7 @@
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Support/AlignOf.h"
 #include "llvm/Support/MD5.h"
 #include <cstddef>
@@ -43,6 +44,36 @@ PreambleBounds ComputePreambleBounds(const LangOptions &LangOpts,
 
 class PreambleCallbacks;
 
+/// A directory of precompiled preambles shared by all the processes that use
+/// it, so that a preamble built by one process can be reused by the others.
+///
+/// Preambles are keyed by a hash of the preamble bytes and of the compiler
+/// invocation, and carry the stamps of the files they were built from, which
+/// are checked before a preamble is reused. They are published by renaming a
+/// fully written temporary file into place, so concurrent readers never see a
+/// partially written preamble.
+class PreambleStore {
+public:
+  /// \param Directory The directory holding the preambles. It is created when
+  /// the first preamble is published.
+  ///
+  /// \param SizeLimit The size, in bytes, that the store is trimmed to after a
+  /// preamble is published. Zero means there is no limit.
+  PreambleStore(StringRef Directory, uint64_t SizeLimit = 0);
+
+  StringRef getDirectory() const { return Directory; }
+  uint64_t getSizeLimit() const { return SizeLimit; }
+
+  /// Remove the least recently used preambles until the store fits within its
+  /// size limit, along with the temporary files left behind by processes that
+  /// crashed while publishing a preamble.
+  void collectGarbage();
+
+private:
+  std::string Directory;
+  uint64_t SizeLimit;
+};
+
 /// A class holding a PCH and all information to check whether it is valid to
 /// reuse the PCH for the subsequent runs. Use BuildPreamble to create PCH and
 /// CanReusePreamble + AddImplicitPreamble to make use of it.
@@ -83,6 +114,31 @@ public:
         std::shared_ptr<PCHContainerOperations> PCHContainerOps,
         bool StoreInMemory, PreambleCallbacks &Callbacks);
 
+  /// Look up a preamble for \p Invocation and the preamble of \p
+  /// MainFileBuffer in \p Store, and check that none of the files it was
+  /// built from have changed.
+  ///
+  /// \param ClientData If not null, receives the data the preamble was
+  /// published with.
+  ///
+  /// \returns None if the store has no preamble that can be reused.
+  static llvm::Optional<PrecompiledPreamble>
+  LoadFromStore(PreambleStore &Store, const CompilerInvocation &Invocation,
+                const llvm::MemoryBuffer *MainFileBuffer, PreambleBounds Bounds,
+                llvm::vfs::FileSystem &VFS, std::string *ClientData = nullptr);
+
+  /// Publish this preamble in \p Store, so that LoadFromStore finds it in this
+  /// and other processes. \p Invocation must be the one the preamble was
+  /// built with.
+  ///
+  /// \param ClientData Data stored along with the preamble. PreambleCallbacks
+  /// are not run for preambles loaded from a store, so clients use it to keep
+  /// what the callbacks collected.
+  std::error_code Publish(PreambleStore &Store,
+                          const CompilerInvocation &Invocation,
+                          llvm::vfs::FileSystem &VFS,
+                          StringRef ClientData = StringRef()) const;
+
   PrecompiledPreamble(PrecompiledPreamble &&) = default;
   PrecompiledPreamble &operator=(PrecompiledPreamble &&) = default;
 
@@ -167,13 +223,23 @@ private:
     std::string Data;
   };
 
+  /// A preamble loaded from a PreambleStore.
+  class StoredPreamble {
+  public:
+    /// The whole store entry, usually memory mapped.
+    std::unique_ptr<llvm::MemoryBuffer> Entry;
+    /// The PCH within Entry.
+    StringRef PCH;
+  };
+
   class PCHStorage {
   public:
-    enum class Kind { Empty, InMemory, TempFile };
+    enum class Kind { Empty, InMemory, TempFile, Stored };
 
     PCHStorage() = default;
     PCHStorage(TempPCHFile File);
     PCHStorage(InMemoryPreamble Memory);
+    PCHStorage(StoredPreamble Stored);
 
     PCHStorage(const PCHStorage &) = delete;
     PCHStorage &operator=(const PCHStorage &) = delete;
@@ -191,13 +257,17 @@ private:
     InMemoryPreamble &asMemory();
     const InMemoryPreamble &asMemory() const;
 
+    StoredPreamble &asStored();
+    const StoredPreamble &asStored() const;
+
   private:
     void destroy();
     void setEmpty();
 
   private:
     Kind StorageKind = Kind::Empty;
-    llvm::AlignedCharArrayUnion<TempPCHFile, InMemoryPreamble> Storage = {};
+    llvm::AlignedCharArrayUnion<TempPCHFile, InMemoryPreamble, StoredPreamble>
+        Storage = {};
   };
 
   /// Data used to determine if a file used in the preamble has been changed.
@@ -0,0 +1,84 @@
+//===- HeaderLookupCache.h - Persistent header lookup results ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the HeaderLookupCache interface, which lets compiles with
+// the same header search paths share the results of their header lookups.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_HEADERLOOKUPCACHE_H
+#define LLVM_CLANG_LEX_HEADERLOOKUPCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace clang {
+
+class DirectoryLookup;
+class FileManager;
+
+/// An on-disk record of the search directories in which the headers included
+/// by previous compiles were found, so that the compiles with the same search
+/// directories can skip the ones before it instead of looking the header up in
+/// each of them.
+///
+/// The cache of a list of search directories is stored in a file named after
+/// a hash of the list, together with the modification times of the
+/// directories.  The results are discarded when any of these changed, as
+/// adding or removing a header in a search directory does.  Headers added to
+/// or removed from subdirectories of a search directory would not change
+/// them, so the lookups of names with a directory component are not cached.
+class HeaderLookupCache {
+  /// The file the cache is stored in.
+  std::string Path;
+
+  /// The modification times of the search directories, as stored in the file.
+  std::string Stamps;
+
+  /// The number of search directories.
+  unsigned NumSearchDirs;
+
+  /// For each header, the pairs of the index of the search directory the
+  /// lookup started from and of the one the header was found in.
+  llvm::StringMap<SmallVector<std::pair<unsigned, unsigned>, 1>> Lookups;
+
+  /// Whether lookups were added since the cache was loaded.
+  bool Modified = false;
+
+  /// Add the lookups stored in the file to \c Lookups.
+  void read();
+
+public:
+  /// Load the cache of \p SearchDirs from the directory \p CacheDir.
+  HeaderLookupCache(StringRef CacheDir, ArrayRef<DirectoryLookup> SearchDirs,
+                    unsigned AngledDirIdx, unsigned SystemDirIdx,
+                    FileManager &FileMgr);
+
+  /// \returns the index of the search directory in which \p Filename was found
+  /// by a lookup starting at \p StartIdx, if it is known.
+  Optional<unsigned> lookup(StringRef Filename, unsigned StartIdx) const;
+
+  /// Record that \p Filename was found in the search directory \p HitIdx by a
+  /// lookup starting at \p StartIdx.
+  void add(StringRef Filename, unsigned StartIdx, unsigned HitIdx);
+
+  /// Write the cache back, merged with the lookups stored by other compiles
+  /// in the meantime, if lookups were added.
+  std::error_code save();
+};
+
+} // namespace clang
+
+#endif // LLVM_CLANG_LEX_HEADERLOOKUPCACHE_H
@@ -16,6 +16,7 @@
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/DirectoryLookup.h"
+#include "clang/Lex/HeaderLookupCache.h"
 #include "clang/Lex/HeaderMap.h"
 #include "clang/Lex/ModuleMap.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -214,6 +215,12 @@ class HeaderSearch {
   };
   llvm::StringMap<LookupFileCacheInfo, llvm::BumpPtrAllocator> LookupFileCache;
 
+  /// The lookups of the compiles with the same search directories, if
+  /// HeaderSearchOptions::HeaderLookupCachePath is set.  It is loaded by the
+  /// first lookup, and dropped if the search directories change afterwards.
+  std::unique_ptr<HeaderLookupCache> PersistentLookupCache;
+  bool PersistentLookupCacheLoaded = false;
+
   /// Collection mapping a framework or subframework
   /// name like "Carbon" to the Carbon.framework directory.
   llvm::StringMap<FrameworkCacheEntry, llvm::BumpPtrAllocator> FrameworkMap;
@@ -255,6 +262,7 @@ class HeaderSearch {
   unsigned NumMultiIncludeFileOptzn = 0;
   unsigned NumFrameworkLookups = 0;
   unsigned NumSubFrameworkLookups = 0;
+  unsigned NumPersistentLookupCacheHits = 0;
 
 public:
   HeaderSearch(std::shared_ptr<HeaderSearchOptions> HSOpts,
@@ -282,6 +290,8 @@ public:
     SystemDirIdx = systemDirIdx;
     NoCurDirSearch = noCurDirSearch;
     //LookupFileCache.clear();
+    PersistentLookupCache.reset();
+    PersistentLookupCacheLoaded = false;
   }
 
   /// Add an additional search path.
@@ -291,6 +301,9 @@ public:
     if (!isAngled)
       AngledDirIdx++;
     SystemDirIdx++;
+    // The indices of the persistent lookups are no longer valid.
+    PersistentLookupCache.reset();
+    PersistentLookupCacheLoaded = true;
   }
 
   /// Set the list of system header prefixes.
@@ -734,11 +747,18 @@ public:
                                               llvm::StringRef MainFile,
                                               bool *IsSystem = nullptr);
 
+  /// Store the lookups of this compile in the persistent lookup cache, if
+  /// there is one.
+  void savePersistentLookupCache();
+
   void PrintStats();
 
   size_t getTotalMemory() const;
 
 private:
+  /// Load the persistent lookup cache on the first lookup.
+  HeaderLookupCache *getPersistentLookupCache();
+
   /// Describes what happened when we tried to load a module map file.
   enum LoadModuleMapResult {
     /// The module map file had already been loaded.
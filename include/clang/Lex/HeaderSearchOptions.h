@@ -113,6 +113,10 @@ public:
   /// The directory used for a user build.
   std::string ModuleUserBuildPath;
 
+  /// The directory holding the header lookup results shared by the compiles
+  /// with the same search directories, or empty if they are not shared.
+  std::string HeaderLookupCachePath;
+
   /// The mapping of module names to prebuilt module files.
   std::map<std::string, std::string> PrebuiltModuleFiles;
 
@@ -202,6 +206,16 @@ public:
 
   unsigned ModulesHashContent : 1;
 
+  /// Whether to compress the lookup tables of the declaration contexts in
+  /// module and PCH files, which are only decompressed when the declaration
+  /// context is deserialized.
+  unsigned ModulesCompressLookupTables : 1;
+
+  /// Whether to compress the declarations, types and statements of module
+  /// and PCH files in chunks, which are only decompressed when something in
+  /// them is deserialized.
+  unsigned ModulesCompressDeclsAndTypes : 1;
+
   HeaderSearchOptions(StringRef _Sysroot = "/")
       : Sysroot(_Sysroot), ModuleFormat("raw"), DisableModuleHash(false),
         ImplicitModuleMaps(false), ModuleMapFileHomeIsCwd(false),
@@ -209,7 +223,9 @@ public:
         UseStandardCXXIncludes(true), UseLibcxx(false), Verbose(false),
         ModulesValidateOncePerBuildSession(false),
         ModulesValidateSystemHeaders(false), UseDebugInfo(false),
-        ModulesValidateDiagnosticOptions(true), ModulesHashContent(false) {}
+        ModulesValidateDiagnosticOptions(true), ModulesHashContent(false),
+        ModulesCompressLookupTables(false),
+        ModulesCompressDeclsAndTypes(false) {}
 
   /// AddPath - Add the \p Path path to the specified \p Group list.
   void AddPath(StringRef Path, frontend::IncludeDirGroup Group,
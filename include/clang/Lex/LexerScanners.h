@@ -0,0 +1,100 @@
+//===--- LexerScanners.h - Vectorized scanners for the lexer ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the scanners the lexer uses to skip over long runs of
+// characters that need no processing: the bodies of line comments, string
+// literals and raw string literals, identifiers and horizontal whitespace.
+//
+// The scanners are implemented with SSE2 and AVX2 where available. The widest
+// implementation supported by the host CPU is selected at runtime, so a build
+// for baseline x86-64 still uses AVX2 on machines that have it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_LEXERSCANNERS_H
+#define LLVM_CLANG_LEX_LEXERSCANNERS_H
+
+#include "clang/Basic/CharInfo.h"
+#include "clang/Basic/LLVM.h"
+
+namespace clang {
+namespace lexer_scan {
+
+/// The instruction sets the scanners are implemented with.
+enum class ScannerKind { Scalar, SSE2, AVX2 };
+
+/// \returns the scanner implementation the lexer currently uses.
+ScannerKind getScannerKind();
+
+/// \returns true if \p Kind was compiled in and is supported by the host CPU.
+bool isScannerKindAvailable(ScannerKind Kind);
+
+/// Select the scanner implementation used by the lexer. This is meant for
+/// tests and benchmarks, which compare the implementations against each other.
+///
+/// \returns false, leaving the selection untouched, if \p Kind is not
+/// available.
+bool setScannerKind(ScannerKind Kind);
+
+/// Every scanner takes a pointer into a null terminated buffer that ends at
+/// \p End, and returns a pointer to the first character at or after \p Ptr
+/// that stops the scan. The scanners never read past the null terminator at
+/// \p End, but like the scalar loops of the lexer they may continue past \p End
+/// if it is not null terminated.
+namespace detail {
+const char *skipLineCommentBody(const char *Ptr, const char *End);
+const char *skipHorizontalWhitespace(const char *Ptr, const char *End);
+const char *skipIdentifierBody(const char *Ptr, const char *End);
+const char *skipStringLiteralBody(const char *Ptr, const char *End);
+const char *skipRawStringLiteralBody(const char *Ptr, const char *End);
+} // end namespace detail
+
+/// Most identifiers and whitespace runs are short, so they are scanned one
+/// character at a time up to this length before switching to the vectorized
+/// scanners.
+enum { ShortRunLength = 16 };
+
+/// Skip the body of a line comment, stopping at a newline or a null character.
+inline const char *skipLineCommentBody(const char *Ptr, const char *End) {
+  return detail::skipLineCommentBody(Ptr, End);
+}
+
+/// Skip spaces, tabs, form feeds and vertical tabs.
+inline const char *skipHorizontalWhitespace(const char *Ptr, const char *End) {
+  for (unsigned I = 0; I != ShortRunLength; ++I, ++Ptr)
+    if (!isHorizontalWhitespace(*Ptr))
+      return Ptr;
+  return detail::skipHorizontalWhitespace(Ptr, End);
+}
+
+/// Skip the characters matched by [_A-Za-z0-9]. A '$', a '\' or a '?' stops the
+/// scan, the lexer deals with those itself.
+inline const char *skipIdentifierBody(const char *Ptr, const char *End) {
+  for (unsigned I = 0; I != ShortRunLength; ++I, ++Ptr)
+    if (!isIdentifierBody(*Ptr))
+      return Ptr;
+  return detail::skipIdentifierBody(Ptr, End);
+}
+
+/// Skip the characters of a string literal that need no processing, stopping
+/// at a '"', a '\' (escapes and line splices), a '?' (trigraphs), a newline or
+/// a null character.
+inline const char *skipStringLiteralBody(const char *Ptr, const char *End) {
+  return detail::skipStringLiteralBody(Ptr, End);
+}
+
+/// Skip the characters of a raw string literal that cannot end it, stopping at
+/// a ')' or a null character.
+inline const char *skipRawStringLiteralBody(const char *Ptr, const char *End) {
+  return detail::skipRawStringLiteralBody(Ptr, End);
+}
+
+} // end namespace lexer_scan
+} // end namespace clang
+
+#endif // LLVM_CLANG_LEX_LEXERSCANNERS_H
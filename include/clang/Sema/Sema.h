@@ -3560,6 +3560,12 @@ public:
                                    const ParsedAttributesView &Attrs,
                                    SourceRange Range);
 
+  /// Check that \p St, marked with the musttail attribute \p MTA, is the
+  /// return of a call that can be emitted as a guaranteed tail call. Checks
+  /// that depend on template arguments are skipped in dependent contexts, so
+  /// this must be called again on the instantiated statement.
+  bool CheckMustTailAttr(Stmt *St, const MustTailAttr &MTA);
+
   void WarnConflictingTypedMethods(ObjCMethodDecl *Method,
                                    ObjCMethodDecl *MethodDecl,
                                    bool IsProtocolMethodDecl);
@@ -10879,6 +10885,7 @@ private:
   bool CheckNeonBuiltinFunctionCall(unsigned BuiltinID, CallExpr *TheCall);
   bool CheckARMBuiltinFunctionCall(unsigned BuiltinID, CallExpr *TheCall);
   bool CheckCheerpBuiltinFunctionCall(unsigned BuiltinID, CallExpr *TheCall);
+  bool CheckCheerpExternRefTableCall(unsigned BuiltinID, CallExpr *TheCall);
   bool CheckAArch64BuiltinFunctionCall(unsigned BuiltinID, CallExpr *TheCall);
   bool CheckHexagonBuiltinFunctionCall(unsigned BuiltinID, CallExpr *TheCall);
   bool CheckHexagonBuiltinCpu(unsigned BuiltinID, CallExpr *TheCall);
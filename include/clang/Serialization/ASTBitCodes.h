@@ -41,7 +41,7 @@ namespace serialization {
     /// Version 4 of AST files also requires that the version control branch and
     /// revision match exactly, since there is no backward compatibility of
     /// AST files at this time.
-    const unsigned VERSION_MAJOR = 7;
+    const unsigned VERSION_MAJOR = 8;
 
     /// AST file minor version number supported by this version of
     /// Clang.
@@ -647,7 +647,16 @@ namespace serialization {
       PP_CONDITIONAL_STACK = 62,
 
       /// A table of skipped ranges within the preprocessing record.
-      PPD_SKIPPED_RANGES = 63
+      PPD_SKIPPED_RANGES = 63,
+
+      /// Record code for the compressed contents of the DECLTYPES_BLOCK,
+      /// which is left empty.
+      ///
+      /// The record holds the number of chunks and the byte offset at which
+      /// the block would end uncompressed. The blob starts with the bit
+      /// offset of the first record of each chunk and the size of the chunk
+      /// once compressed, followed by the compressed chunks.
+      DECLTYPES_CHUNKS = 64
     };
 
     /// Record types used within a source manager block.
@@ -1382,6 +1391,9 @@ namespace serialization {
       /// declaration context. This data is used when iterating over
       /// the contents of a DeclContext, e.g., via
       /// DeclContext::decls_begin() and DeclContext::decls_end().
+      ///
+      /// The blob is preceded by its size if it is compressed, and 0
+      /// otherwise.
       DECL_CONTEXT_LEXICAL,
 
       /// A record that stores the set of declarations that are
@@ -1391,6 +1403,9 @@ namespace serialization {
       /// associates a declaration name with one or more declaration
       /// IDs. This data is used when performing qualified name lookup
       /// into a DeclContext via DeclContext::lookup.
+      ///
+      /// The blob is preceded by its size if it is compressed, and 0
+      /// otherwise.
       DECL_CONTEXT_VISIBLE,
 
       /// A LabelDecl record.
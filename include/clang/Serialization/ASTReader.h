@@ -609,6 +609,19 @@ private:
   /// performed deduplication.
   llvm::SetVector<NamedDecl *> PendingMergedDefinitionsToDeduplicate;
 
+  /// Decompress the lookup table \p Blob of a DC if \p Size, its size once
+  /// decompressed, is not zero, keeping the contents alive as long as \p M.
+  bool decompressLookupTable(ModuleFile &M, uint64_t Size, StringRef &Blob);
+
+  /// Set up the DeclsCursor of \p F to read the compressed chunks of its
+  /// DECLS_BLOCK described by a DECLTYPES_CHUNKS record.
+  bool ReadDeclTypesChunks(ModuleFile &F, const RecordData &Record,
+                           StringRef Blob);
+
+  /// Move the DeclsCursor of \p F to \p Offset, decompressing the chunk of
+  /// the DECLS_BLOCK it points into first, if needed.
+  llvm::Error JumpToDeclsOffset(ModuleFile &F, uint64_t Offset);
+
   /// Read the record that describes the lexical contents of a DC.
   bool ReadLexicalDeclContextStorage(ModuleFile &M,
                                      llvm::BitstreamCursor &Cursor,
@@ -1007,6 +1020,26 @@ private:
   /// Number of visible decl contexts read/total.
   unsigned NumVisibleDeclContextsRead = 0, TotalVisibleDeclContexts = 0;
 
+  /// Number of compressed lookup tables decompressed/total.
+  unsigned NumCompressedLookupTablesRead = 0, TotalCompressedLookupTables = 0;
+
+  /// Size of the compressed lookup tables decompressed/total, once
+  /// decompressed.
+  uint64_t LookupTablesSizeRead = 0, TotalLookupTablesSize = 0;
+
+  /// Size of the compressed lookup tables in the AST files.
+  uint64_t TotalCompressedLookupTablesSize = 0;
+
+  /// Number of chunks of declarations and types decompressed/total.
+  unsigned NumDeclTypesChunksRead = 0, TotalDeclTypesChunks = 0;
+
+  /// Size of the chunks of declarations and types decompressed/total, once
+  /// decompressed.
+  uint64_t DeclTypesChunksSizeRead = 0, TotalDeclTypesChunksSize = 0;
+
+  /// Size of the chunks of declarations and types in the AST files.
+  uint64_t TotalCompressedDeclTypesChunksSize = 0;
+
   /// Total size of modules, in bits, currently loaded
   uint64_t TotalModulesSizeInBits = 0;
 
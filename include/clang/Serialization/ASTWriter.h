@@ -129,7 +129,7 @@ private:
   llvm::BitstreamWriter &Stream;
 
   /// The buffer associated with the bitstream.
-  const SmallVectorImpl<char> &Buffer;
+  SmallVectorImpl<char> &Buffer;
 
   /// The PCM manager which manages memory buffers for pcm files.
   InMemoryModuleCache &ModuleCache;
@@ -442,6 +442,18 @@ private:
   /// file.
   unsigned NumVisibleDeclContexts = 0;
 
+  /// The number of compressed declaration lookup tables written to the AST
+  /// file.
+  unsigned NumCompressedLookupTables = 0;
+
+  /// The total size of the compressed lookup tables, before and after
+  /// compression.
+  uint64_t LookupTablesSize = 0, CompressedLookupTablesSize = 0;
+
+  /// The bit offsets in the DECLTYPES_BLOCK at which each chunk starts, when
+  /// the block is compressed.
+  SmallVector<uint64_t, 16> DeclTypesChunkStarts;
+
   /// A mapping from each known submodule to its ID number, which will
   /// be a positive integer.
   llvm::DenseMap<Module *, unsigned> SubmoduleIDs;
@@ -489,6 +501,10 @@ private:
 
   void GenerateNameLookupTable(const DeclContext *DC,
                                llvm::SmallVectorImpl<char> &LookupTable);
+  uint64_t compressLookupTable(StringRef Blob,
+                               SmallVectorImpl<char> &Compressed);
+  void startDeclTypesChunk();
+  void compressDeclTypesBlock(uint64_t BodyStart);
   uint64_t WriteDeclContextLexicalBlock(ASTContext &Context, DeclContext *DC);
   uint64_t WriteDeclContextVisibleBlock(ASTContext &Context, DeclContext *DC);
   void WriteTypeDeclOffsets();
@@ -15,6 +15,7 @@
 #ifndef LLVM_CLANG_SERIALIZATION_GLOBALMODULEINDEX_H
 #define LLVM_CLANG_SERIALIZATION_GLOBALMODULEINDEX_H
 
+#include "clang/Basic/Module.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -84,6 +85,10 @@ class GlobalModuleIndex {
     /// index was built.
     time_t ModTime;
 
+    /// The signature of the module file at the time the global index was
+    /// built, if it has one.
+    ASTFileSignature Signature;
+
     /// The module IDs on which this module directly depends.
     /// FIXME: We don't really need a vector here.
     llvm::SmallVector<unsigned, 4> Dependencies;
@@ -175,7 +180,12 @@ public:
   /// Print debugging view to standard error.
   void dump();
 
-  /// Write a global index into the given
+  /// Write a global index into the given directory.
+  ///
+  /// The information the previous index holds about the module files that
+  /// did not change since it was built is reused, and the other module files
+  /// are read in parallel. The new index replaces the previous one atomically,
+  /// so that readers can keep using the previous one in the meantime.
   ///
   /// \param FileMgr The file manager to use to load module files.
   /// \param PCHContainerRdr - The PCHContainerOperations to use for loading and
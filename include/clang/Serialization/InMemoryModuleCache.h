@@ -36,6 +36,11 @@ class InMemoryModuleCache : public llvm::RefCountedBase<InMemoryModuleCache> {
     /// cache).
     bool IsFinal = false;
 
+    /// Track whether this PCM was built by an ASTWriter and Buffer is the
+    /// writer's copy, which may still be replaced by a mapping of the file the
+    /// PCM is written to.
+    bool IsWritten = false;
+
     PCM() = default;
     PCM(std::unique_ptr<llvm::MemoryBuffer> Buffer)
         : Buffer(std::move(Buffer)) {}
@@ -75,6 +80,32 @@ public:
   llvm::MemoryBuffer &addBuiltPCM(llvm::StringRef Filename,
                                   std::unique_ptr<llvm::MemoryBuffer> Buffer);
 
+  /// Store a PCM that was just built and is being written to Filename.  This
+  /// is like \a addBuiltPCM, but the in-memory copy may later be replaced by a
+  /// mapping of the written file with \a replaceWrittenPCM.
+  ///
+  /// \pre state is Unknown or ToBuild.
+  /// \post state is Final.
+  void addWrittenPCM(llvm::StringRef Filename,
+                     std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+  /// Check whether the PCM was stored by \a addWrittenPCM and its buffer has
+  /// not been replaced yet.
+  bool isPCMWritten(llvm::StringRef Filename) const;
+
+  /// Replace the in-memory copy of a PCM stored by \a addWrittenPCM with \p
+  /// Buffer, usually a read-only mapping of the file it was written to.  The
+  /// pages of a mapping are shared with the other processes that import the
+  /// PCM, instead of being private to this process.
+  ///
+  /// \pre The PCM was not looked up since it was stored, so that nobody refers
+  /// to its current buffer.
+  /// \return true if the buffer was replaced; false, leaving the PCM as is, if
+  /// it was not stored by \a addWrittenPCM or if \p Buffer has different
+  /// contents.
+  bool replaceWrittenPCM(llvm::StringRef Filename,
+                         std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
   /// Try to remove a buffer from the cache.  No effect if state is Final.
   ///
   /// \pre state is Tentative/Final.
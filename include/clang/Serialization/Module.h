@@ -26,6 +26,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitstream/BitstreamReader.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <cassert>
 #include <cstdint>
 #include <memory>
@@ -404,6 +405,38 @@ public:
   /// jump around with these in context.
   llvm::BitstreamCursor DeclsCursor;
 
+  /// The bit offset at which DeclsCursor was cloned, just before the
+  /// abbreviation width of the DECLS_BLOCK.
+  uint64_t DeclsCursorStart = 0;
+
+  /// A compressed chunk of the DECLS_BLOCK.
+  struct DeclTypesChunk {
+    /// The bit offset of the first record in the chunk.
+    uint64_t StartBit;
+
+    /// The byte range of the chunk once decompressed into DeclTypesBuffer.
+    uint64_t Begin, End;
+
+    /// The compressed contents of the chunk.
+    StringRef Compressed;
+
+    /// Whether the chunk was decompressed into DeclTypesBuffer.
+    bool Loaded = false;
+  };
+
+  /// The chunks of the DECLS_BLOCK, if it is compressed, sorted by offset.
+  std::vector<DeclTypesChunk> DeclTypesChunks;
+
+  /// The buffer DeclsCursor reads when the DECLS_BLOCK is compressed. It is
+  /// laid out like the uncompressed file, so that the offsets of types and
+  /// declarations are valid in it, but only the chunks decompressed so far
+  /// are filled in.
+  std::unique_ptr<llvm::WritableMemoryBuffer> DeclTypesBuffer;
+
+  /// The decompressed contents of the lookup tables of the declaration
+  /// contexts read so far, which the lookup structures point into.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> DecompressedBlobs;
+
   /// The number of declarations in this AST file.
   unsigned LocalNumDecls = 0;
 
@@ -61,11 +61,17 @@ public:
     OverlayFiles[FilePath] = Content;
   }
 
+  /// Stream the results to \p NumShards files in \p Dir as they are reported,
+  /// instead of keeping them in memory. This must be called before execute().
+  llvm::Error setResultsDirectory(StringRef Dir, unsigned NumShards);
+
 private:
   // Used to store the parser when the executor is initialized with parser.
   llvm::Optional<CommonOptionsParser> OptionsParser;
   const CompilationDatabase &Compilations;
   std::unique_ptr<ToolResults> Results;
+  /// The results if they are streamed to disk, owned by Results.
+  OnDiskToolResults *DiskResults = nullptr;
   ExecutionContext Context;
   llvm::StringMap<std::string> OverlayFiles;
   unsigned ThreadCount;
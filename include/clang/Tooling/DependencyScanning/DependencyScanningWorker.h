@@ -13,6 +13,8 @@
 #include "clang/Basic/LLVM.h"
 #include "clang/Frontend/PCHContainerOperations.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/DependencyScanning/DependencyScanningService.h"
+#include "clang/Tooling/DependencyScanning/ModuleDepCollector.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include <string>
@@ -21,6 +23,20 @@ namespace clang {
 namespace tooling {
 namespace dependencies {
 
+/// The consumer of the dependencies that are discovered by a worker while
+/// scanning a single translation unit.
+class DependencyConsumer {
+public:
+  virtual ~DependencyConsumer() {}
+
+  virtual void handleFileDependency(const DependencyOutputOptions &Opts,
+                                    StringRef Filename) = 0;
+
+  virtual void handleModuleDependency(ModuleDeps MD) = 0;
+
+  virtual void handleContextHash(std::string Hash) = 0;
+};
+
 /// An individual dependency scanning worker that is able to run on its own
 /// thread.
 ///
@@ -29,7 +45,7 @@ namespace dependencies {
 /// using the regular processing run.
 class DependencyScanningWorker {
 public:
-  DependencyScanningWorker();
+  DependencyScanningWorker(DependencyScanningService &Service);
 
   /// Print out the dependency information into a string using the dependency
   /// file format that is specified in the options (-MD is the default) and
@@ -41,13 +57,32 @@ public:
                                                 StringRef WorkingDirectory,
                                                 const CompilationDatabase &CDB);
 
+  /// Run the dependency scanner for the given input and report the discovered
+  /// dependencies to \p Consumer.
+  ///
+  /// The textual file dependencies are always reported. The module
+  /// dependencies and the context hash are only reported when the service
+  /// uses the \c ScanningOutputFormat::Full format.
+  ///
+  /// \returns A \c StringError with the diagnostic output if clang errors
+  /// occurred, success otherwise.
+  llvm::Error computeDependencies(const std::string &Input,
+                                  StringRef WorkingDirectory,
+                                  const CompilationDatabase &CDB,
+                                  DependencyConsumer &Consumer);
+
 private:
   IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts;
   std::shared_ptr<PCHContainerOperations> PCHContainerOps;
+  ScanningOutputFormat Format;
 
+  /// The physical filesystem overlaid by the worker. Changing its working
+  /// directory does not change the working directory of the process.
+  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> RealFS;
   /// The file system that is used by each worker when scanning for
   /// dependencies. This filesystem persists accross multiple compiler
-  /// invocations.
+  /// invocations. In the minimized source mode it consults the cache that is
+  /// shared by all the workers of the service.
   llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> WorkerFS;
 };
 
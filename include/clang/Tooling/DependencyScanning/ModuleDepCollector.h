@@ -0,0 +1,112 @@
+//===- ModuleDepCollector.h - Callbacks to collect deps ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLING_DEPENDENCY_SCANNING_MODULE_DEP_COLLECTOR_H
+#define LLVM_CLANG_TOOLING_DEPENDENCY_SCANNING_MODULE_DEP_COLLECTOR_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/Utils.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringSet.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tooling {
+namespace dependencies {
+
+class DependencyConsumer;
+
+/// The dependencies of a single Clang module, as discovered while scanning a
+/// translation unit that imports it.
+struct ModuleDeps {
+  /// The full name of the top level module.
+  std::string ModuleName;
+
+  /// The hash of the compiler options that affect the module file. Two modules
+  /// with the same name and context hash are interchangeable.
+  std::string ContextHash;
+
+  /// The path to the module map file that defines this module. Empty if the
+  /// module was not loaded from a module map.
+  std::string ClangModuleMapFile;
+
+  /// The files the module was built from.
+  llvm::StringSet<> FileDeps;
+
+  /// The names of the other top level modules this module directly imports.
+  llvm::StringSet<> ClangModuleDeps;
+
+  /// Whether this module is directly imported by the main file of the
+  /// translation unit being scanned.
+  bool ImportedByMainFile = false;
+};
+
+class ModuleDepCollector;
+
+/// Callbacks that record the textual includes of the main file and the
+/// modules that it imports.
+class ModuleDepCollectorPP final : public PPCallbacks {
+public:
+  ModuleDepCollectorPP(CompilerInstance &I, ModuleDepCollector &MDC)
+      : Instance(I), MDC(MDC) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override;
+  void InclusionDirective(SourceLocation HashLoc, const Token &IncludeTok,
+                          StringRef FileName, bool IsAngled,
+                          CharSourceRange FilenameRange, const FileEntry *File,
+                          StringRef SearchPath, StringRef RelativePath,
+                          const Module *Imported,
+                          SrcMgr::CharacteristicKind FileType) override;
+  void moduleImport(SourceLocation ImportLoc, ModuleIdPath Path,
+                    const Module *Imported) override;
+
+  void EndOfMainFile() override;
+
+private:
+  CompilerInstance &Instance;
+  ModuleDepCollector &MDC;
+  llvm::DenseSet<const Module *> DirectDeps;
+
+  void addDirectImport(const Module *Imported);
+  void handleTopLevelModule(const Module *M);
+  void addAllSubmoduleDeps(const Module *M, ModuleDeps &MD);
+  void addModuleDep(const Module *M, ModuleDeps &MD);
+};
+
+/// Collects the textual file dependencies and the Clang module dependencies of
+/// a translation unit and reports them to a \c DependencyConsumer.
+class ModuleDepCollector final : public DependencyCollector {
+public:
+  ModuleDepCollector(CompilerInstance &I, DependencyConsumer &C);
+
+  void attachToPreprocessor(Preprocessor &PP) override;
+  void attachToASTReader(ASTReader &R) override;
+
+private:
+  friend ModuleDepCollectorPP;
+
+  CompilerInstance &Instance;
+  DependencyConsumer &Consumer;
+  std::string MainFile;
+  std::string ContextHash;
+  std::vector<std::string> MainDeps;
+  llvm::StringMap<ModuleDeps> Deps;
+};
+
+} // end namespace dependencies
+} // end namespace tooling
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLING_DEPENDENCY_SCANNING_MODULE_DEP_COLLECTOR_H
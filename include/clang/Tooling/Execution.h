@@ -30,6 +30,7 @@
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Registry.h"
 #include "llvm/Support/StringSaver.h"
 
@@ -72,6 +73,57 @@ private:
   std::vector<std::pair<llvm::StringRef, llvm::StringRef>> KVResults;
 };
 
+/// Streams the key-value results to files on disk as they are reported, so
+/// that tools producing a large set of results run in bounded memory.
+///
+/// The results are spread over a number of shard files by the hash of their
+/// key, so that the results with the same key end up in the same shard and
+/// concurrent writers rarely wait on each other. This class is thread safe.
+class OnDiskToolResults : public ToolResults {
+public:
+  /// Creates the results in \p NumShards files in directory \p Dir. The
+  /// directory is created if needed, and existing shard files are overwritten.
+  static llvm::Expected<std::unique_ptr<OnDiskToolResults>>
+  create(StringRef Dir, unsigned NumShards);
+
+  ~OnDiskToolResults() override;
+
+  void addResult(StringRef Key, StringRef Value) override;
+
+  /// Reads all the results back into memory. They stay alive as long as this
+  /// object.
+  std::vector<std::pair<llvm::StringRef, llvm::StringRef>>
+  AllKVResults() override;
+
+  /// Reads the results back one shard at a time, so only the results of a
+  /// single shard are in memory at once.
+  void forEachResult(llvm::function_ref<void(StringRef Key, StringRef Value)>
+                         Callback) override;
+
+  /// Writes the buffered results of all shards to disk.
+  ///
+  /// \returns an error if writing any of the shards failed.
+  llvm::Error flush();
+
+  /// \returns the paths of the shard files.
+  std::vector<std::string> getShardPaths() const;
+
+private:
+  struct Shard;
+
+  explicit OnDiskToolResults(std::vector<std::unique_ptr<Shard>> Shards);
+
+  /// Reads the results of \p S into a buffer, and calls \p Callback on each.
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+  readShard(Shard &S,
+            llvm::function_ref<void(StringRef Key, StringRef Value)> Callback);
+
+  std::vector<std::unique_ptr<Shard>> Shards;
+
+  /// The shards read by AllKVResults, which own the returned strings.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> LoadedShards;
+};
+
 /// The context of an execution, including the information about
 /// compilation and results.
 class ExecutionContext {
@@ -314,12 +314,19 @@ public:
   /// clang modules.
   /// \param BaseFS VFS used for all underlying file accesses when running the
   /// tool.
+  /// \param Files The file manager to use for the underlying file accesses,
+  /// for example to share the files looked up by a previous tool. It must be
+  /// backed by \p BaseFS, so that it follows the working directory of each
+  /// compile command, and it does not see the files mapped with
+  /// mapVirtualFile(). If null, a file manager backed by \p BaseFS and the
+  /// mapped files is created.
   ClangTool(const CompilationDatabase &Compilations,
             ArrayRef<std::string> SourcePaths,
             std::shared_ptr<PCHContainerOperations> PCHContainerOps =
                 std::make_shared<PCHContainerOperations>(),
             IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS =
-                llvm::vfs::getRealFileSystem());
+                llvm::vfs::getRealFileSystem(),
+            IntrusiveRefCntPtr<FileManager> Files = nullptr);
 
   ~ClangTool();
 
@@ -61,6 +61,11 @@ void FileManager::setStatCache(std::unique_ptr<FileSystemStatCache> statCache) {
 
 void FileManager::clearStatCache() { StatCache.reset(); }
 
+void FileManager::setSharedCache(
+    IntrusiveRefCntPtr<SharedFileSystemCache> Cache) {
+  SharedCache = std::move(Cache);
+}
+
 /// Retrieve the directory that the given file name resides in.
 /// Filename can point to either a real file or a virtual file.
 static const DirectoryEntry *getDirectoryFromFile(FileManager &FileMgr,
@@ -376,19 +381,49 @@ void FileManager::fillRealPathName(FileEntry *UFE, llvm::StringRef FileName) {
 
 llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
 FileManager::getBufferForFile(const FileEntry *Entry, bool isVolatile,
-                              bool ShouldCloseOpenFile) {
+                              bool ShouldCloseOpenFile,
+                              bool RequiresNullTerminator) {
   uint64_t FileSize = Entry->getSize();
   // If there's a high enough chance that the file have changed since we
   // got its size, force a stat before opening it.
   if (isVolatile)
     FileSize = -1;
 
+  // Reuse the contents another FileManager read, unless the file may have
+  // changed. Virtual files that do not exist on disk have no unique ID.
+  bool UseSharedCache = SharedCache && !isVolatile && RequiresNullTerminator &&
+                        !Entry->isNamedPipe() &&
+                        Entry->getUniqueID() != llvm::sys::fs::UniqueID(0, 0);
+  if (UseSharedCache) {
+    if (std::unique_ptr<llvm::MemoryBuffer> Buffer = SharedCache->getBuffer(
+            Entry->getUniqueID(), Entry->getSize(),
+            Entry->getModificationTime())) {
+      if (ShouldCloseOpenFile)
+        Entry->closeFile();
+      return std::move(Buffer);
+    }
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Result =
+      readBufferForFile(Entry, FileSize, isVolatile, ShouldCloseOpenFile,
+                        RequiresNullTerminator);
+  if (!UseSharedCache || !Result)
+    return Result;
+  return SharedCache->addBuffer(Entry->getUniqueID(), Entry->getSize(),
+                                Entry->getModificationTime(),
+                                std::move(*Result));
+}
+
+llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+FileManager::readBufferForFile(const FileEntry *Entry, uint64_t FileSize,
+                               bool isVolatile, bool ShouldCloseOpenFile,
+                               bool RequiresNullTerminator) {
   StringRef Filename = Entry->getName();
   // If the file is already open, use the open file descriptor.
   if (Entry->File) {
     auto Result =
         Entry->File->getBuffer(Filename, FileSize,
-                               /*RequiresNullTerminator=*/true, isVolatile);
+                               RequiresNullTerminator, isVolatile);
     // FIXME: we need a set of APIs that can make guarantees about whether a
     // FileEntry is open or not.
     if (ShouldCloseOpenFile)
@@ -399,13 +434,13 @@ FileManager::getBufferForFile(const FileEntry *Entry, bool isVolatile,
   // Otherwise, open the file.
 
   if (FileSystemOpts.WorkingDir.empty())
-    return FS->getBufferForFile(Filename, FileSize,
-                                /*RequiresNullTerminator=*/true, isVolatile);
+    return FS->getBufferForFile(Filename, FileSize, RequiresNullTerminator,
+                                isVolatile);
 
   SmallString<128> FilePath(Entry->getName());
   FixupRelativePath(FilePath);
-  return FS->getBufferForFile(FilePath, FileSize,
-                              /*RequiresNullTerminator=*/true, isVolatile);
+  return FS->getBufferForFile(FilePath, FileSize, RequiresNullTerminator,
+                              isVolatile);
 }
 
 llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
@@ -428,14 +463,17 @@ bool FileManager::getStatValue(StringRef Path, llvm::vfs::Status &Status,
                                std::unique_ptr<llvm::vfs::File> *F) {
   // FIXME: FileSystemOpts shouldn't be passed in here, all paths should be
   // absolute!
-  if (FileSystemOpts.WorkingDir.empty())
-    return bool(FileSystemStatCache::get(Path, Status, isFile, F,
-                                         StatCache.get(), *FS));
-
-  SmallString<128> FilePath(Path);
-  FixupRelativePath(FilePath);
+  SmallString<128> FilePath;
+  if (!FileSystemOpts.WorkingDir.empty()) {
+    FilePath = Path;
+    FixupRelativePath(FilePath);
+    Path = FilePath;
+  }
 
-  return bool(FileSystemStatCache::get(FilePath.c_str(), Status, isFile, F,
+  if (SharedCache)
+    return bool(
+        SharedCache->getStat(Path, Status, isFile, F, StatCache.get(), *FS));
+  return bool(FileSystemStatCache::get(Path, Status, isFile, F,
                                        StatCache.get(), *FS));
 }
 
@@ -455,6 +493,8 @@ void FileManager::invalidateCache(const FileEntry *Entry) {
   assert(Entry && "Cannot invalidate a NULL FileEntry");
 
   SeenFileEntries.erase(Entry->getName());
+  if (SharedCache)
+    SharedCache->invalidate(Entry->getName());
 
   // FileEntry invalidation should not block future optimizations in the file
   // caches. Possible alternatives are cache truncation (invalidate last N) or
@@ -11,9 +11,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Chrono.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include <utility>
 
@@ -118,3 +122,118 @@ MemorizeStatCalls::getStat(StringRef Path, llvm::vfs::Status &Status,
 
   return std::error_code();
 }
+
+namespace {
+
+/// A buffer referring to contents shared by a SharedFileSystemCache, which it
+/// keeps alive even if the cache drops them.
+class SharedContentsBuffer : public llvm::MemoryBuffer {
+public:
+  SharedContentsBuffer(std::shared_ptr<const llvm::MemoryBuffer> Contents)
+      : Contents(std::move(Contents)) {
+    init(this->Contents->getBufferStart(), this->Contents->getBufferEnd(),
+         /*RequiresNullTerminator=*/true);
+  }
+
+  StringRef getBufferIdentifier() const override {
+    return Contents->getBufferIdentifier();
+  }
+
+  BufferKind getBufferKind() const override {
+    return Contents->getBufferKind();
+  }
+
+private:
+  std::shared_ptr<const llvm::MemoryBuffer> Contents;
+};
+
+} // namespace
+
+SharedFileSystemCache::SharedFileSystemCache() {
+  // Like the dependency scanning cache, one shard per four hardware threads
+  // keeps the contention low without spreading the entries too thin.
+  NumShards = std::max(2u, llvm::hardware_concurrency() / 4);
+  StatShards = llvm::make_unique<StatShard[]>(NumShards);
+  ContentsShards = llvm::make_unique<ContentsShard[]>(NumShards);
+}
+
+SharedFileSystemCache::~SharedFileSystemCache() = default;
+
+SharedFileSystemCache::StatShard &
+SharedFileSystemCache::getStatShard(StringRef Path) {
+  return StatShards[llvm::hash_value(Path) % NumShards];
+}
+
+SharedFileSystemCache::ContentsShard &
+SharedFileSystemCache::getContentsShard(llvm::sys::fs::UniqueID UniqueID) {
+  return ContentsShards[llvm::hash_combine(UniqueID.getDevice(),
+                                           UniqueID.getFile()) %
+                        NumShards];
+}
+
+std::error_code SharedFileSystemCache::getStat(
+    StringRef Path, llvm::vfs::Status &Status, bool isFile,
+    std::unique_ptr<llvm::vfs::File> *F, FileSystemStatCache *Cache,
+    llvm::vfs::FileSystem &FS) {
+  // Relative paths depend on the working directory of each file system.
+  if (!llvm::sys::path::is_absolute(Path))
+    return FileSystemStatCache::get(Path, Status, isFile, F, Cache, FS);
+
+  StatShard &Shard = getStatShard(Path);
+  {
+    std::unique_lock<std::mutex> LockGuard(Shard.Lock);
+    auto It = Shard.Stats.find(Path);
+    if (It != Shard.Stats.end()) {
+      Status = It->second;
+      if (Status.isDirectory() == isFile)
+        return std::make_error_code(Status.isDirectory()
+                                        ? std::errc::is_a_directory
+                                        : std::errc::not_a_directory);
+      return std::error_code();
+    }
+  }
+
+  // Stat without holding the lock, another thread may do the same.
+  if (std::error_code EC =
+          FileSystemStatCache::get(Path, Status, isFile, F, Cache, FS))
+    return EC;
+
+  std::unique_lock<std::mutex> LockGuard(Shard.Lock);
+  Shard.Stats.insert(std::make_pair(Path, Status));
+  return std::error_code();
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+SharedFileSystemCache::getBuffer(llvm::sys::fs::UniqueID UniqueID,
+                                 uint64_t Size, time_t ModTime) {
+  ContentsShard &Shard = getContentsShard(UniqueID);
+  std::unique_lock<std::mutex> LockGuard(Shard.Lock);
+  auto It = Shard.Contents.find(UniqueID);
+  if (It == Shard.Contents.end() || It->second.Size != Size ||
+      It->second.ModTime != ModTime)
+    return nullptr;
+  return llvm::make_unique<SharedContentsBuffer>(It->second.Buffer);
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+SharedFileSystemCache::addBuffer(llvm::sys::fs::UniqueID UniqueID,
+                                 uint64_t Size, time_t ModTime,
+                                 std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  ContentsShard &Shard = getContentsShard(UniqueID);
+  std::unique_lock<std::mutex> LockGuard(Shard.Lock);
+  ContentsEntry &Entry = Shard.Contents[UniqueID];
+  // Replace contents read while the file had another size or modification
+  // time. The buffers handed out for them keep them alive.
+  if (!Entry.Buffer || Entry.Size != Size || Entry.ModTime != ModTime) {
+    Entry.Size = Size;
+    Entry.ModTime = ModTime;
+    Entry.Buffer = std::move(Buffer);
+  }
+  return llvm::make_unique<SharedContentsBuffer>(Entry.Buffer);
+}
+
+void SharedFileSystemCache::invalidate(StringRef Path) {
+  StatShard &Shard = getStatShard(Path);
+  std::unique_lock<std::mutex> LockGuard(Shard.Lock);
+  Shard.Stats.erase(Path);
+}
@@ -93,6 +93,8 @@ void ContentCache::replaceBuffer(const llvm::MemoryBuffer *B, bool DoNotFree) {
     delete Buffer.getPointer();
   Buffer.setPointer(B);
   Buffer.setInt((B && DoNotFree) ? DoNotFreeFlag : 0);
+  // The line table points into the old buffer.
+  SourceLineCache.clear();
 }
 
 const llvm::MemoryBuffer *ContentCache::getBuffer(DiagnosticsEngine &Diag,
@@ -657,6 +659,8 @@ void SourceManager::overrideFileContents(const FileEntry *SourceFile,
 
   const_cast<SrcMgr::ContentCache *>(IR)->replaceBuffer(Buffer, DoNotFree);
   const_cast<SrcMgr::ContentCache *>(IR)->BufferOverridden = true;
+  if (LastLineNoContentCache == IR)
+    LastLineNoFileIDQuery = FileID();
 
   getOverriddenFilesInfo().OverriddenFilesWithBuffer.insert(SourceFile);
 }
@@ -679,6 +683,8 @@ void SourceManager::disableFileContentsOverride(const FileEntry *File) {
   const SrcMgr::ContentCache *IR = getOrCreateContentCache(File);
   const_cast<SrcMgr::ContentCache *>(IR)->replaceBuffer(nullptr);
   const_cast<SrcMgr::ContentCache *>(IR)->ContentsEntry = IR->OrigEntry;
+  if (LastLineNoContentCache == IR)
+    LastLineNoFileIDQuery = FileID();
 
   assert(OverriddenFilesInfo);
   OverriddenFilesInfo->OverriddenFiles.erase(File);
@@ -1159,13 +1165,14 @@ unsigned SourceManager::getColumnNumber(FileID FID, unsigned FilePos,
   const char *Buf = MemBuf->getBufferStart();
   // See if we just calculated the line number for this FilePos and can use
   // that to lookup the start of the line instead of searching for it.
-  if (LastLineNoFileIDQuery == FID &&
-      LastLineNoContentCache->SourceLineCache != nullptr &&
-      LastLineNoResult < LastLineNoContentCache->NumLines) {
-    unsigned *SourceLineCache = LastLineNoContentCache->SourceLineCache;
+  if (LastLineNoFileIDQuery == FID && LastLineNoContentCache->SourceLineCache) {
+    const LineOffsetMapping &SourceLineCache =
+        LastLineNoContentCache->SourceLineCache;
     unsigned LineStart = SourceLineCache[LastLineNoResult - 1];
-    unsigned LineEnd = SourceLineCache[LastLineNoResult];
-    if (FilePos >= LineStart && FilePos < LineEnd) {
+    Optional<unsigned> NextLineStart =
+        SourceLineCache.getLineStart(LastLineNoResult + 1);
+    if (NextLineStart && FilePos >= LineStart && FilePos < *NextLineStart) {
+      unsigned LineEnd = *NextLineStart;
       // LineEnd is the LineStart of the next line.
       // A line ends with separator LF or CR+LF on Windows.
       // FilePos might point to the last separator,
@@ -1217,53 +1224,213 @@ unsigned SourceManager::getPresumedColumnNumber(SourceLocation Loc,
 
 #ifdef __SSE2__
 #include <emmintrin.h>
+#define CLANG_SCAN_LINE_ENDS_SSE2 1
 #endif
 
-static LLVM_ATTRIBUTE_NOINLINE void
-ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
-                   llvm::BumpPtrAllocator &Alloc,
-                   const SourceManager &SM, bool &Invalid);
-static void ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
-                               llvm::BumpPtrAllocator &Alloc,
-                               const SourceManager &SM, bool &Invalid) {
-  // Note that calling 'getBuffer()' may lazily page in the file.
-  const MemoryBuffer *Buffer =
-      FI->getBuffer(Diag, SM, SourceLocation(), &Invalid);
-  if (Invalid)
-    return;
+// The AVX2 scanner is compiled with the target attribute and selected at
+// runtime, so that builds for baseline x86-64 still use it.
+#if defined(__SSE2__) && defined(__GNUC__) &&                                  \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLANG_SCAN_LINE_ENDS_AVX2 1
+#endif
 
-  // Find the file offsets of all of the *physical* source lines.  This does
-  // not look at trigraphs, escaped newlines, or anything else tricky.
-  SmallVector<unsigned, 256> LineOffsets;
+// The scanners below find the characters in [I, End) that end a line: a '\n',
+// or a '\r' that is not followed by a '\n'. The offset of the character after
+// each one, which starts a line, is written to Out if it is not null. They
+// return the number of line ends found. The character at End must be readable,
+// which it is because the buffers are null terminated.
+
+static unsigned scanLineEndsScalar(const char *Buf, unsigned I, unsigned End,
+                                   unsigned *Out) {
+  unsigned N = 0;
+  for (; I != End; ++I) {
+    if (Buf[I] == '\n' || (Buf[I] == '\r' && Buf[I + 1] != '\n')) {
+      if (Out)
+        Out[N] = I + 1;
+      ++N;
+    }
+  }
+  return N;
+}
 
-  // Line #1 starts at char 0.
-  LineOffsets.push_back(0);
+#if defined(CLANG_SCAN_LINE_ENDS_SSE2) || defined(CLANG_SCAN_LINE_ENDS_AVX2)
+/// Append the line starts for the line ends in \p Mask, a block of characters
+/// starting at \p I.
+static inline unsigned appendLineStarts(uint32_t Mask, unsigned I,
+                                        unsigned *Out) {
+  if (Out)
+    for (uint32_t M = Mask; M; M &= M - 1)
+      *Out++ = I + llvm::countTrailingZeros(M) + 1;
+  return llvm::countPopulation(Mask);
+}
+#endif
 
-  const unsigned char *Buf = (const unsigned char *)Buffer->getBufferStart();
-  const unsigned char *End = (const unsigned char *)Buffer->getBufferEnd();
-  unsigned I = 0;
-  while (true) {
-    // Skip over the contents of the line.
-    while (Buf[I] != '\n' && Buf[I] != '\r' && Buf[I] != '\0')
-      ++I;
-
-    if (Buf[I] == '\n' || Buf[I] == '\r') {
-      // If this is \r\n, skip both characters.
-      if (Buf[I] == '\r' && Buf[I+1] == '\n')
-        ++I;
-      ++I;
-      LineOffsets.push_back(I);
-    } else {
-      // Otherwise, this is a NUL. If end of file, exit.
-      if (Buf+I == End) break;
-      ++I;
-    }
+#ifdef CLANG_SCAN_LINE_ENDS_SSE2
+static unsigned scanLineEndsSSE2(const char *Buf, unsigned I, unsigned End,
+                                 unsigned *Out) {
+  const __m128i NL = _mm_set1_epi8('\n');
+  const __m128i CR = _mm_set1_epi8('\r');
+  unsigned N = 0;
+  for (; End - I >= 16; I += 16) {
+    __m128i V = _mm_loadu_si128((const __m128i *)(Buf + I));
+    __m128i Next = _mm_loadu_si128((const __m128i *)(Buf + I + 1));
+    __m128i LineEnd = _mm_or_si128(
+        _mm_cmpeq_epi8(V, NL),
+        _mm_andnot_si128(_mm_cmpeq_epi8(Next, NL), _mm_cmpeq_epi8(V, CR)));
+    N += appendLineStarts(_mm_movemask_epi8(LineEnd), I, Out ? Out + N : nullptr);
+  }
+  return N + scanLineEndsScalar(Buf, I, End, Out ? Out + N : nullptr);
+}
+#endif
+
+#ifdef CLANG_SCAN_LINE_ENDS_AVX2
+__attribute__((target("avx2")))
+static unsigned scanLineEndsAVX2(const char *Buf, unsigned I, unsigned End,
+                                 unsigned *Out) {
+  const __m256i NL = _mm256_set1_epi8('\n');
+  const __m256i CR = _mm256_set1_epi8('\r');
+  unsigned N = 0;
+  for (; End - I >= 32; I += 32) {
+    __m256i V = _mm256_loadu_si256((const __m256i *)(Buf + I));
+    __m256i Next = _mm256_loadu_si256((const __m256i *)(Buf + I + 1));
+    __m256i LineEnd = _mm256_or_si256(
+        _mm256_cmpeq_epi8(V, NL),
+        _mm256_andnot_si256(_mm256_cmpeq_epi8(Next, NL),
+                            _mm256_cmpeq_epi8(V, CR)));
+    N += appendLineStarts(_mm256_movemask_epi8(LineEnd), I,
+                          Out ? Out + N : nullptr);
+  }
+  return N + scanLineEndsSSE2(Buf, I, End, Out ? Out + N : nullptr);
+}
+#endif
+
+typedef unsigned (*ScanLineEndsFn)(const char *Buf, unsigned I, unsigned End,
+                                   unsigned *Out);
+
+static ScanLineEndsFn selectScanLineEnds() {
+#ifdef CLANG_SCAN_LINE_ENDS_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return scanLineEndsAVX2;
+#endif
+#ifdef CLANG_SCAN_LINE_ENDS_SSE2
+  return scanLineEndsSSE2;
+#else
+  return scanLineEndsScalar;
+#endif
+}
+
+static unsigned scanLineEnds(const char *Buf, unsigned I, unsigned End,
+                             unsigned *Out) {
+  static const ScanLineEndsFn Scan = selectScanLineEnds();
+  return Scan(Buf, I, End, Out);
+}
+
+void LineOffsetMapping::init(const char *Buf, unsigned Size,
+                             llvm::BumpPtrAllocator &Alloc) {
+  this->Buf = Buf;
+  this->Size = Size;
+  this->Alloc = &Alloc;
+  unsigned NumChunks = getNumChunks();
+  FirstLine = Alloc.Allocate<unsigned>(NumChunks + 1);
+  FirstLine[0] = 0;
+  NumChunksCounted = 0;
+  ChunkLineOffsets = Alloc.Allocate<unsigned *>(NumChunks);
+  std::fill(ChunkLineOffsets, ChunkLineOffsets + NumChunks, nullptr);
+}
+
+// A chunk holds the lines that start at offsets [Begin, End) of the buffer. The
+// last chunk ends one past the end of the buffer, since a newline at the very
+// end of the buffer starts an empty last line. Line 1 starts at offset 0, any
+// other line starts right after the character that ends the previous line.
+// These are the *physical* source lines, trigraphs, escaped newlines and
+// anything else tricky are not looked at.
+
+void LineOffsetMapping::countLinesUpTo(unsigned Chunk) const {
+  assert(Buf && Chunk < getNumChunks() && "chunk out of range");
+  for (; NumChunksCounted <= Chunk; ++NumChunksCounted) {
+    unsigned Begin = NumChunksCounted * ChunkSize;
+    unsigned End = std::min(Begin + ChunkSize, Size + 1);
+    unsigned NumLines = Begin == 0 ? 1 + scanLineEnds(Buf, 0, End - 1, nullptr)
+                                   : scanLineEnds(Buf, Begin - 1, End - 1,
+                                                  nullptr);
+    FirstLine[NumChunksCounted + 1] = FirstLine[NumChunksCounted] + NumLines;
+  }
+}
+
+const unsigned *
+LineOffsetMapping::getChunkLineOffsets(unsigned Chunk) const {
+  if (const unsigned *Offsets = ChunkLineOffsets[Chunk])
+    return Offsets;
+
+  countLinesUpTo(Chunk);
+  unsigned NumLines = FirstLine[Chunk + 1] - FirstLine[Chunk];
+  unsigned *Offsets = Alloc->Allocate<unsigned>(std::max(NumLines, 1u));
+  unsigned Begin = Chunk * ChunkSize;
+  unsigned End = std::min(Begin + ChunkSize, Size + 1);
+  if (Begin == 0) {
+    Offsets[0] = 0;
+    scanLineEnds(Buf, 0, End - 1, Offsets + 1);
+  } else {
+    scanLineEnds(Buf, Begin - 1, End - 1, Offsets);
   }
+  ChunkLineOffsets[Chunk] = Offsets;
+  return Offsets;
+}
+
+unsigned LineOffsetMapping::getLineNumber(unsigned FilePos) const {
+  // It is okay to ask for a position past the end of the buffer, it is on the
+  // last line.
+  FilePos = std::min(FilePos, Size);
+  unsigned Chunk = FilePos / ChunkSize;
+  countLinesUpTo(Chunk);
+  const unsigned *Offsets = getChunkLineOffsets(Chunk);
+  unsigned NumLines = FirstLine[Chunk + 1] - FirstLine[Chunk];
+  return FirstLine[Chunk] +
+         (std::upper_bound(Offsets, Offsets + NumLines, FilePos) - Offsets);
+}
+
+Optional<unsigned> LineOffsetMapping::getLineStart(unsigned LineNo) const {
+  assert(LineNo > 0 && "line numbers start at 1");
+  unsigned Index = LineNo - 1;
+  unsigned NumChunks = getNumChunks();
+  while (FirstLine[NumChunksCounted] <= Index && NumChunksCounted < NumChunks)
+    countLinesUpTo(NumChunksCounted);
+  if (FirstLine[NumChunksCounted] <= Index)
+    return None;
 
-  // Copy the offsets into the FileInfo structure.
-  FI->NumLines = LineOffsets.size();
-  FI->SourceLineCache = Alloc.Allocate<unsigned>(LineOffsets.size());
-  std::copy(LineOffsets.begin(), LineOffsets.end(), FI->SourceLineCache);
+  // Find the chunk the line starts in, skipping the chunks with no lines.
+  unsigned *NextChunk = std::upper_bound(
+      FirstLine, FirstLine + NumChunksCounted + 1, Index);
+  unsigned Chunk = NextChunk - FirstLine - 1;
+  return getChunkLineOffsets(Chunk)[Index - FirstLine[Chunk]];
+}
+
+unsigned LineOffsetMapping::getNumLines() const {
+  countLinesUpTo(getNumChunks() - 1);
+  return FirstLine[getNumChunks()];
+}
+
+unsigned LineOffsetMapping::getNumChunksCollected() const {
+  if (!Buf)
+    return 0;
+  return std::count_if(ChunkLineOffsets, ChunkLineOffsets + getNumChunks(),
+                       [](const unsigned *Offsets) { return Offsets != nullptr; });
+}
+
+/// Set up the line table of \p FI. Note that this may lazily page in the file.
+static bool initLineTable(DiagnosticsEngine &Diag, ContentCache *FI,
+                          llvm::BumpPtrAllocator &Alloc,
+                          const SourceManager &SM) {
+  bool Invalid = false;
+  const MemoryBuffer *Buffer =
+      FI->getBuffer(Diag, SM, SourceLocation(), &Invalid);
+  if (Invalid)
+    return false;
+  FI->SourceLineCache.init(Buffer->getBufferStart(), Buffer->getBufferSize(),
+                           Alloc);
+  return true;
 }
 
 /// getLineNumber - Given a SourceLocation, return the spelling line number
@@ -1293,11 +1460,10 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
     Content = const_cast<ContentCache*>(Entry.getFile().getContentCache());
   }
 
-  // If this is the first use of line information for this buffer, compute the
-  /// SourceLineCache for it on demand.
+  // If this is the first use of line information for this buffer, set up the
+  // SourceLineCache for it on demand.
   if (!Content->SourceLineCache) {
-    bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    bool MyInvalid = !initLineTable(Diag, Content, ContentCacheAlloc, *this);
     if (Invalid)
       *Invalid = MyInvalid;
     if (MyInvalid)
@@ -1305,61 +1471,12 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
   } else if (Invalid)
     *Invalid = false;
 
-  // Okay, we know we have a line number table.  Do a binary search to find the
-  // line number that this character position lands on.
-  unsigned *SourceLineCache = Content->SourceLineCache;
-  unsigned *SourceLineCacheStart = SourceLineCache;
-  unsigned *SourceLineCacheEnd = SourceLineCache + Content->NumLines;
-
-  unsigned QueriedFilePos = FilePos+1;
-
-  // FIXME: I would like to be convinced that this code is worth being as
-  // complicated as it is, binary search isn't that slow.
-  //
-  // If it is worth being optimized, then in my opinion it could be more
-  // performant, simpler, and more obviously correct by just "galloping" outward
-  // from the queried file position. In fact, this could be incorporated into a
-  // generic algorithm such as lower_bound_with_hint.
-  //
-  // If someone gives me a test case where this matters, and I will do it! - DWD
-
-  // If the previous query was to the same file, we know both the file pos from
-  // that query and the line number returned.  This allows us to narrow the
-  // search space from the entire file to something near the match.
-  if (LastLineNoFileIDQuery == FID) {
-    if (QueriedFilePos >= LastLineNoFilePos) {
-      // FIXME: Potential overflow?
-      SourceLineCache = SourceLineCache+LastLineNoResult-1;
-
-      // The query is likely to be nearby the previous one.  Here we check to
-      // see if it is within 5, 10 or 20 lines.  It can be far away in cases
-      // where big comment blocks and vertical whitespace eat up lines but
-      // contribute no tokens.
-      if (SourceLineCache+5 < SourceLineCacheEnd) {
-        if (SourceLineCache[5] > QueriedFilePos)
-          SourceLineCacheEnd = SourceLineCache+5;
-        else if (SourceLineCache+10 < SourceLineCacheEnd) {
-          if (SourceLineCache[10] > QueriedFilePos)
-            SourceLineCacheEnd = SourceLineCache+10;
-          else if (SourceLineCache+20 < SourceLineCacheEnd) {
-            if (SourceLineCache[20] > QueriedFilePos)
-              SourceLineCacheEnd = SourceLineCache+20;
-          }
-        }
-      }
-    } else {
-      if (LastLineNoResult < Content->NumLines)
-        SourceLineCacheEnd = SourceLineCache+LastLineNoResult+1;
-    }
-  }
-
-  unsigned *Pos
-    = std::lower_bound(SourceLineCache, SourceLineCacheEnd, QueriedFilePos);
-  unsigned LineNo = Pos-SourceLineCacheStart;
+  // The line table only counts and collects the lines of the chunks up to the
+  // one FilePos is in, then binary searches the lines of that chunk.
+  unsigned LineNo = Content->SourceLineCache.getLineNumber(FilePos);
 
   LastLineNoFileIDQuery = FID;
   LastLineNoContentCache = Content;
-  LastLineNoFilePos = QueriedFilePos;
   LastLineNoResult = LineNo;
   return LineNo;
 }
@@ -1737,14 +1854,12 @@ SourceLocation SourceManager::translateLineCol(FileID FID,
 
   // If this is the first use of line information for this buffer, compute the
   // SourceLineCache for it on demand.
-  if (!Content->SourceLineCache) {
-    bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
-    if (MyInvalid)
-      return SourceLocation();
-  }
+  if (!Content->SourceLineCache &&
+      !initLineTable(Diag, Content, ContentCacheAlloc, *this))
+    return SourceLocation();
 
-  if (Line > Content->NumLines) {
+  Optional<unsigned> LineStart = Content->SourceLineCache.getLineStart(Line);
+  if (!LineStart) {
     unsigned Size = Content->getBuffer(Diag, *this)->getBufferSize();
     if (Size > 0)
       --Size;
@@ -1752,7 +1867,7 @@ SourceLocation SourceManager::translateLineCol(FileID FID,
   }
 
   const llvm::MemoryBuffer *Buffer = Content->getBuffer(Diag, *this);
-  unsigned FilePos = Content->SourceLineCache[Line - 1];
+  unsigned FilePos = *LineStart;
   const char *Buf = Buffer->getBufferStart() + FilePos;
   unsigned BufLength = Buffer->getBufferSize() - FilePos;
   if (BufLength == 0)
@@ -2137,15 +2252,19 @@ void SourceManager::PrintStats() const {
                << "B of Sloc address space used.\n";
 
   unsigned NumLineNumsComputed = 0;
+  unsigned NumLineChunksCollected = 0;
   unsigned NumFileBytesMapped = 0;
   for (fileinfo_iterator I = fileinfo_begin(), E = fileinfo_end(); I != E; ++I){
-    NumLineNumsComputed += I->second->SourceLineCache != nullptr;
+    NumLineNumsComputed += bool(I->second->SourceLineCache);
+    NumLineChunksCollected +=
+        I->second->SourceLineCache.getNumChunksCollected();
     NumFileBytesMapped  += I->second->getSizeBytesMapped();
   }
   unsigned NumMacroArgsComputed = MacroArgsCacheMap.size();
 
   llvm::errs() << NumFileBytesMapped << " bytes of files mapped, "
-               << NumLineNumsComputed << " files with line #'s computed, "
+               << NumLineNumsComputed << " files with line #'s computed ("
+               << NumLineChunksCollected << " chunks of line offsets), "
                << NumMacroArgsComputed << " files with macro args computed.\n";
   llvm::errs() << "FileID scans: " << NumLinearScans << " linear, "
                << NumBinaryProbes << " binary.\n";
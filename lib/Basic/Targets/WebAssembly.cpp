@@ -255,6 +255,9 @@ void CheerpTargetInfo::getTargetDefines(const LangOptions &Opts,
     }
   }
 
+  if (Opts.CheerpAnyref)
+    Builder.defineMacro("__CHEERP_EXTERNREF__");
+
   if (Opts.CPlusPlus)
     Builder.defineMacro("_GNU_SOURCE");
 
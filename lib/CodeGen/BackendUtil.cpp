@@ -30,6 +30,7 @@
 #include "llvm/CodeGen/SchedulerRegistry.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
@@ -45,6 +46,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -70,10 +72,13 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Utils.h"
 #include "llvm/Transforms/Utils/CanonicalizeAliases.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/EntryExitInstrumenter.h"
 #include "llvm/Transforms/Utils/NameAnonGlobals.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "llvm/Transforms/Utils/SymbolRewriter.h"
 #include <memory>
+#include <mutex>
 using namespace clang;
 using namespace llvm;
 
@@ -119,6 +124,18 @@ class EmitAssemblyHelper {
   bool AddEmitPasses(legacy::PassManager &CodeGenPasses, BackendAction Action,
                      raw_pwrite_stream &OS, raw_pwrite_stream *DwoOS);
 
+  /// Whether code should be generated for partitions of the module
+  /// concurrently, as requested by -fparallel-codegen.
+  bool shouldSplitCodeGen(BackendAction Action) const {
+    return CodeGenOpts.ParallelCodeGen > 1 &&
+           (Action == Backend_EmitAssembly || Action == Backend_EmitObj);
+  }
+
+  /// Split the module into CodeGenOpts.ParallelCodeGen partitions and run
+  /// the code generator on each of them. The output of the first partition
+  /// is written to \p OS, the others to CodeGenOpts.ParallelCodeGenOutputs.
+  void EmitPartitions(BackendAction Action, raw_pwrite_stream &OS);
+
   std::unique_ptr<llvm::ToolOutputFile> openOutputFile(StringRef Path) {
     std::error_code EC;
     auto F = llvm::make_unique<llvm::ToolOutputFile>(Path, EC,
@@ -842,6 +859,217 @@ bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
   return true;
 }
 
+namespace {
+/// Forwards the diagnostics reported in the context that a partition of the
+/// module is generated in to the context of the module, one at a time.
+class ForwardingDiagnosticHandler : public DiagnosticHandler {
+public:
+  ForwardingDiagnosticHandler(LLVMContext &Ctx, std::mutex &Mutex)
+      : Ctx(Ctx), Mutex(Mutex) {}
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Ctx.diagnose(DI);
+    return true;
+  }
+
+  bool isAnalysisRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isAnalysisRemarkEnabled(PassName);
+  }
+  bool isMissedOptRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isMissedOptRemarkEnabled(PassName);
+  }
+  bool isPassedOptRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isPassedOptRemarkEnabled(PassName);
+  }
+  bool isAnyRemarkEnabled() const override {
+    return Ctx.getDiagHandlerPtr()->isAnyRemarkEnabled();
+  }
+
+  static void handleInlineAsmDiagnostic(const SMDiagnostic &D, void *Context,
+                                        unsigned LocCookie) {
+    auto *Handler = static_cast<ForwardingDiagnosticHandler *>(Context);
+    std::lock_guard<std::mutex> Lock(Handler->Mutex);
+    LLVMContext &Ctx = Handler->Ctx;
+    Ctx.getInlineAsmDiagnosticHandler()(
+        D, Ctx.getInlineAsmDiagnosticContext(), LocCookie);
+  }
+
+private:
+  LLVMContext &Ctx;
+  std::mutex &Mutex;
+};
+}
+
+/// Returns, for each compile unit of \p M, the positions in its list of global
+/// variables of those that no global variable of \p M is attached to, like the
+/// ones of constants that were folded away.
+static std::vector<SmallSet<unsigned, 4>> getUnattachedDebugGlobals(Module &M) {
+  SmallPtrSet<DIGlobalVariableExpression *, 16> Attached;
+  SmallVector<DIGlobalVariableExpression *, 1> GVEs;
+  for (GlobalVariable &GV : M.globals()) {
+    GVEs.clear();
+    GV.getDebugInfo(GVEs);
+    Attached.insert(GVEs.begin(), GVEs.end());
+  }
+
+  std::vector<SmallSet<unsigned, 4>> Unattached;
+  for (DICompileUnit *CU : M.debug_compile_units()) {
+    Unattached.emplace_back();
+    unsigned I = 0;
+    for (DIGlobalVariableExpression *GVE : CU->getGlobalVariables()) {
+      if (!Attached.count(GVE))
+        Unattached.back().insert(I);
+      ++I;
+    }
+  }
+  return Unattached;
+}
+
+/// Restricts the global variables listed by the compile units of the partition
+/// \p MPart to the ones it defines, so that each global variable is described
+/// once in the object the partitions are linked into. The ones listed in
+/// \p Unattached are kept by the first partition.
+static void
+pruneDebugGlobals(Module &MPart, bool IsFirst,
+                  const std::vector<SmallSet<unsigned, 4>> &Unattached) {
+  // Only the definitions keep their attachments when the module is split.
+  SmallPtrSet<DIGlobalVariableExpression *, 16> Defined;
+  SmallVector<DIGlobalVariableExpression *, 1> GVEs;
+  for (GlobalVariable &GV : MPart.globals()) {
+    GVEs.clear();
+    GV.getDebugInfo(GVEs);
+    Defined.insert(GVEs.begin(), GVEs.end());
+  }
+
+  unsigned CUIndex = 0;
+  for (DICompileUnit *CU : MPart.debug_compile_units()) {
+    const SmallSet<unsigned, 4> &CUUnattached = Unattached[CUIndex++];
+    SmallVector<Metadata *, 16> Globals;
+    unsigned I = 0;
+    for (DIGlobalVariableExpression *GVE : CU->getGlobalVariables()) {
+      if (Defined.count(GVE) || (IsFirst && CUUnattached.count(I)))
+        Globals.push_back(GVE);
+      ++I;
+    }
+    if (Globals.size() != CU->getGlobalVariables().size())
+      CU->replaceGlobalVariables(DIGlobalVariableExpressionArray(
+          MDTuple::get(MPart.getContext(), Globals)));
+  }
+}
+
+void EmitAssemblyHelper::EmitPartitions(BackendAction Action,
+                                        raw_pwrite_stream &OS) {
+  SmallVector<raw_pwrite_stream *, 4> PartitionOSs;
+  PartitionOSs.push_back(&OS);
+  std::vector<std::unique_ptr<llvm::ToolOutputFile>> PartitionFiles;
+  for (const std::string &Path : CodeGenOpts.ParallelCodeGenOutputs) {
+    PartitionFiles.push_back(openOutputFile(Path));
+    if (!PartitionFiles.back())
+      return;
+    PartitionOSs.push_back(&PartitionFiles.back()->os());
+  }
+
+  // Each partition is generated in a context of its own, on a thread of its
+  // own. The time trace, the pass timers and the optimization record are not
+  // synchronized, so when they are enabled the partitions are generated one
+  // after the other instead, in the context of the module.
+  LLVMContext &Ctx = TheModule->getContext();
+  bool Concurrent = !llvm::timeTraceProfilerEnabled() &&
+                    !llvm::TimePassesIsEnabled && !Ctx.getRemarkStreamer();
+
+  struct Partition {
+    std::unique_ptr<TargetMachine> TM;
+    std::unique_ptr<legacy::PassManager> CodeGenPasses;
+    SmallString<0> Bitcode;
+  };
+  std::vector<Partition> Partitions(PartitionOSs.size());
+  unsigned NumPartitions = 0;
+  bool Failed = false;
+  std::vector<SmallSet<unsigned, 4>> UnattachedDebugGlobals =
+      getUnattachedDebugGlobals(*TheModule);
+
+  // Internal symbols stay in the partition of their users rather than being
+  // exported, and comdats are not split, so that linking the partitions
+  // together with a relocatable link gives the same symbols as generating
+  // code for the whole module. The partitioning only depends on the names of
+  // the symbols, so it is deterministic.
+  SplitModule(
+      CloneModule(*TheModule), Partitions.size(),
+      [&](std::unique_ptr<Module> MPart) {
+        bool IsFirst = NumPartitions == 0;
+        Partition &P = Partitions[NumPartitions];
+        raw_pwrite_stream &PartitionOS = *PartitionOSs[NumPartitions++];
+        if (Failed)
+          return;
+        pruneDebugGlobals(*MPart, IsFirst, UnattachedDebugGlobals);
+
+        // The code generator of a partition is set up here, where the
+        // diagnostics can be reported.
+        EmitAssemblyHelper PartitionHelper(Diags, HSOpts, CodeGenOpts,
+                                           TargetOpts, LangOpts, MPart.get());
+        PartitionHelper.CreateTargetMachine(/*MustCreateTM=*/true);
+        if (!PartitionHelper.TM) {
+          Failed = true;
+          return;
+        }
+        P.CodeGenPasses = llvm::make_unique<legacy::PassManager>();
+        P.CodeGenPasses->add(createTargetTransformInfoWrapperPass(
+            PartitionHelper.getTargetIRAnalysis()));
+        if (!PartitionHelper.AddEmitPasses(*P.CodeGenPasses, Action,
+                                           PartitionOS, /*DwoOS=*/nullptr)) {
+          Failed = true;
+          return;
+        }
+        P.TM = std::move(PartitionHelper.TM);
+
+        if (!Concurrent) {
+          P.CodeGenPasses->run(*MPart);
+          P.CodeGenPasses.reset();
+          return;
+        }
+
+        // The threads read their partition back into their own context.
+        raw_svector_ostream BCOS(P.Bitcode);
+        WriteBitcodeToFile(*MPart, BCOS);
+      },
+      /*PreserveLocals=*/true);
+  if (Failed)
+    return;
+
+  if (Concurrent) {
+    std::mutex DiagMutex;
+    ThreadPool Pool(Partitions.size());
+    for (Partition &P : Partitions) {
+      Pool.async([&Ctx, &DiagMutex, &P] {
+        LLVMContext PartitionCtx;
+        auto Handler =
+            llvm::make_unique<ForwardingDiagnosticHandler>(Ctx, DiagMutex);
+        if (Ctx.getInlineAsmDiagnosticHandler())
+          PartitionCtx.setInlineAsmDiagnosticHandler(
+              ForwardingDiagnosticHandler::handleInlineAsmDiagnostic,
+              Handler.get());
+        PartitionCtx.setDiagnosticHandler(std::move(Handler));
+        PartitionCtx.setDiagnosticsHotnessRequested(
+            Ctx.getDiagnosticsHotnessRequested());
+        PartitionCtx.setDiagnosticsHotnessThreshold(
+            Ctx.getDiagnosticsHotnessThreshold());
+
+        Expected<std::unique_ptr<Module>> MPart = parseBitcodeFile(
+            MemoryBufferRef(P.Bitcode.str(), "<split-module>"), PartitionCtx);
+        if (!MPart)
+          report_fatal_error("Failed to read the bitcode of a partition");
+        P.CodeGenPasses->run(**MPart);
+        P.CodeGenPasses.reset();
+      });
+    }
+    Pool.wait();
+  }
+
+  for (std::unique_ptr<llvm::ToolOutputFile> &File : PartitionFiles)
+    File->keep();
+}
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       std::unique_ptr<raw_pwrite_stream> OS) {
   TimeRegion Region(FrontendTimesIsEnabled ? &CodeGenerationTime : nullptr);
@@ -915,6 +1143,8 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
     break;
 
   default:
+    if (shouldSplitCodeGen(Action))
+      break;
     if (!CodeGenOpts.SplitDwarfOutput.empty()) {
       DwoOS = openOutputFile(CodeGenOpts.SplitDwarfOutput);
       if (!DwoOS)
@@ -948,7 +1178,10 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   {
     PrettyStackTraceString CrashInfo("Code generation");
-    CodeGenPasses.run(*TheModule);
+    if (shouldSplitCodeGen(Action))
+      EmitPartitions(Action, *OS);
+    else
+      CodeGenPasses.run(*TheModule);
   }
 
   if (ThinLinkOS)
@@ -1332,6 +1565,8 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
   case Backend_EmitMCNull:
   case Backend_EmitObj:
     NeedCodeGen = true;
+    if (shouldSplitCodeGen(Action))
+      break;
     CodeGenPasses.add(
         createTargetTransformInfoWrapperPass(getTargetIRAnalysis()));
     if (!CodeGenOpts.SplitDwarfOutput.empty()) {
@@ -1358,7 +1593,10 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
   // Now if needed, run the legacy PM for codegen.
   if (NeedCodeGen) {
     PrettyStackTraceString CrashInfo("Code generation");
-    CodeGenPasses.run(*TheModule);
+    if (shouldSplitCodeGen(Action))
+      EmitPartitions(Action, *OS);
+    else
+      CodeGenPasses.run(*TheModule);
   }
 
   if (ThinLinkOS)
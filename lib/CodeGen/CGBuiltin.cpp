@@ -9381,6 +9381,27 @@ Value *CodeGenFunction::EmitAArch64BuiltinExpr(unsigned BuiltinID,
   }
 }
 
+/// CHEERP: Get the declaration of llvm.cheerp.externref.table.<Op>, overloaded
+/// on the client pointer type \p ObjTy if it is not null. The Cheerp backend
+/// lowers these intrinsics to table.get, table.set and table.grow on the
+/// externref table of the module. They are declared by name, like the
+/// intrinsics of the backend are, since the Intrinsic enum of the LLVM
+/// headers clang is built against does not list them.
+static Function *getCheerpExternRefTableFn(CodeGenModule &CGM, StringRef Op,
+                                           llvm::FunctionType *FTy,
+                                           llvm::Type *ObjTy) {
+  std::string Name = ("llvm.cheerp.externref.table." + Op).str();
+  if (ObjTy) {
+    // Mangle the overloaded type the way Intrinsic::getName does.
+    llvm::PointerType *PTy = cast<llvm::PointerType>(ObjTy);
+    Name += ".p" + utostr(PTy->getAddressSpace());
+    llvm::StructType *STy = cast<llvm::StructType>(PTy->getElementType());
+    Name += "s_" + STy->getName().str();
+  }
+  return cast<Function>(
+      CGM.getModule().getOrInsertFunction(Name, FTy).getCallee());
+}
+
 Value *CodeGenFunction::EmitCheerpBuiltinExpr(unsigned BuiltinID,
                                               const CallExpr *E, bool asmjs) {
   //Emit the operands
@@ -9407,6 +9428,8 @@ Value *CodeGenFunction::EmitCheerpBuiltinExpr(unsigned BuiltinID,
   else if (BuiltinID == Cheerp::BI__builtin_cheerp_create_closure) {
     llvm::Type *Tys[] = { ConvertType(E->getType()), Ops[0]->getType(), Ops[1]->getType() };
     Function *F = CGM.getIntrinsic(Intrinsic::cheerp_create_closure, Tys);
+    if (getLangOpts().CheerpCachedClosures && !asmjs)
+      return EmitCheerpCachedClosure(F, Ops, E);
     return Builder.CreateCall(F, Ops);
   }
   else if (BuiltinID == Cheerp::BI__builtin_cheerp_make_complete_object) {
@@ -9436,6 +9459,26 @@ Value *CodeGenFunction::EmitCheerpBuiltinExpr(unsigned BuiltinID,
     Function *F = CGM.getIntrinsic(Intrinsic::stackrestore);
     return Builder.CreateCall(F, Ops);
   }
+  else if (BuiltinID == Cheerp::BI__builtin_cheerp_externref_table_get) {
+    llvm::Type *RetTy = ConvertType(E->getType());
+    llvm::FunctionType *FTy =
+        llvm::FunctionType::get(RetTy, {Int32Ty}, /*isVarArg=*/false);
+    Function *F = getCheerpExternRefTableFn(CGM, "get", FTy, RetTy);
+    return Builder.CreateCall(F, Ops);
+  }
+  else if (BuiltinID == Cheerp::BI__builtin_cheerp_externref_table_set) {
+    llvm::Type *ObjTy = Ops[1]->getType();
+    llvm::FunctionType *FTy =
+        llvm::FunctionType::get(VoidTy, {Int32Ty, ObjTy}, /*isVarArg=*/false);
+    Function *F = getCheerpExternRefTableFn(CGM, "set", FTy, ObjTy);
+    return Builder.CreateCall(F, Ops);
+  }
+  else if (BuiltinID == Cheerp::BI__builtin_cheerp_externref_table_grow) {
+    llvm::FunctionType *FTy =
+        llvm::FunctionType::get(Int32Ty, {Int32Ty}, /*isVarArg=*/false);
+    Function *F = getCheerpExternRefTableFn(CGM, "grow", FTy, nullptr);
+    return Builder.CreateCall(F, Ops);
+  }
   else if (BuiltinID == Builtin::BImalloc) {
     const FunctionDecl* FD=dyn_cast<FunctionDecl>(CurFuncDecl);
     assert(FD);
@@ -9558,6 +9601,72 @@ Value *CodeGenFunction::EmitCheerpBuiltinExpr(unsigned BuiltinID,
   return 0;
 }
 
+/// Emit a call to __builtin_cheerp_create_closure that reuses the last closure
+/// created for the same function. When the bound object carries no state (a
+/// null pointer or an empty class, like a captureless lambda) a single closure
+/// is created the first time and reused forever. Otherwise the closure is
+/// reused as long as it is requested for the same object as the previous time.
+/// This makes patterns like re-registering the same callback on every frame
+/// allocation free.
+Value *CodeGenFunction::EmitCheerpCachedClosure(Function *CreateClosure,
+                                                ArrayRef<Value*> Ops,
+                                                const CallExpr *E) {
+  // We can only key the cache on a statically known function
+  Function *Callee = dyn_cast<Function>(Ops[0]->stripPointerCasts());
+  if (!Callee)
+    return Builder.CreateCall(CreateClosure, Ops);
+
+  const Expr *ObjArg = E->getArg(1)->IgnoreParenImpCasts();
+  bool Stateless = ObjArg->isNullPointerConstant(getContext(),
+                                                 Expr::NPC_ValueDependentIsNotNull);
+  if (const CXXRecordDecl *RD = ObjArg->getType()->getPointeeCXXRecordDecl())
+    Stateless |= RD->isEmpty();
+
+  llvm::Type *ClosureTy = CreateClosure->getReturnType();
+  llvm::Type *ObjTy = Ops[1]->getType();
+  llvm::Module &M = CGM.getModule();
+  auto GetCache = [&](StringRef Suffix, llvm::Type *Ty) -> Address {
+    std::string Name = (Callee->getName() + Suffix).str();
+    llvm::GlobalVariable *GV = M.getNamedGlobal(Name);
+    if (!GV || GV->getValueType() != Ty) {
+      GV = new llvm::GlobalVariable(M, Ty, /*isConstant=*/false,
+                                    llvm::GlobalValue::InternalLinkage,
+                                    llvm::Constant::getNullValue(Ty), Name);
+      GV->setAlignment(getPointerAlign().getQuantity());
+    }
+    return Address(GV, getPointerAlign());
+  };
+
+  Address ClosureCache = GetCache(
+      Stateless ? ".cheerp.static_closure" : ".cheerp.closure", ClosureTy);
+  Value *Cached = Builder.CreateLoad(ClosureCache, "closure.cached");
+  Value *Hit = Builder.CreateIsNotNull(Cached);
+  Address ObjCache = Address::invalid();
+  if (!Stateless) {
+    ObjCache = GetCache(".cheerp.closure_obj", ObjTy);
+    Value *LastObj = Builder.CreateLoad(ObjCache, "closure.obj");
+    Hit = Builder.CreateAnd(Hit, Builder.CreateICmpEQ(LastObj, Ops[1]));
+  }
+
+  BasicBlock *HitBlock = Builder.GetInsertBlock();
+  BasicBlock *CreateBlock = createBasicBlock("closure.create", CurFn);
+  BasicBlock *EndBlock = createBasicBlock("closure.end", CurFn);
+  Builder.CreateCondBr(Hit, EndBlock, CreateBlock);
+
+  Builder.SetInsertPoint(CreateBlock);
+  Value *NewClosure = Builder.CreateCall(CreateClosure, Ops);
+  Builder.CreateStore(NewClosure, ClosureCache);
+  if (ObjCache.isValid())
+    Builder.CreateStore(Ops[1], ObjCache);
+  Builder.CreateBr(EndBlock);
+
+  Builder.SetInsertPoint(EndBlock);
+  llvm::PHINode *Result = Builder.CreatePHI(ClosureTy, 2, "closure");
+  Result->addIncoming(Cached, HitBlock);
+  Result->addIncoming(NewClosure, CreateBlock);
+  return Result;
+}
+
 llvm::Value *CodeGenFunction::
 BuildVector(ArrayRef<llvm::Value*> Ops) {
   assert((Ops.size() & (Ops.size() - 1)) == 0 &&
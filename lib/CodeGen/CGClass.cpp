@@ -157,6 +157,11 @@ CodeGenFunction::EmitCXXMemberDataPointerAddress(const Expr *E, Address base,
     CGM.getCXXABI().EmitMemberDataPointerAddress(*this, E, base,
                                                  memberPtr, memberPtrType);
 
+  // CHEERP: The accessed field is not known, any field of the class may be read
+  if (getLangOpts().CheerpFieldAccessInfo)
+    CGM.AddCheerpRecordRead(QualType(memberPtrType->getClass(), 0),
+                            LoopStack.hasInfo());
+
   QualType memberType = memberPtrType->getPointeeType();
   CharUnits memberAlign = getNaturalTypeAlignment(memberType, BaseInfo,
                                                   TBAAInfo);
@@ -835,6 +840,8 @@ static void EmitMemberInitializer(CodeGenFunction &CGF,
     LHS = CGF.MakeNaturalAlignAddrLValue(ThisPtr, RecordTy);
 
   EmitLValueForAnyFieldInitialization(CGF, MemberInit, LHS);
+  if (CGF.getLangOpts().CheerpFieldAccessInfo)
+    CGF.CGM.AddCheerpFieldAccess(Field, /*IsWrite=*/true, /*InLoop=*/false);
 
   // Special case: if we are in a copy or move constructor, and we are copying
   // an array of PODs or classes with trivial copy constructors, ignore the
@@ -855,6 +862,10 @@ static void EmitMemberInitializer(CodeGenFunction &CGF,
         = CGF.Builder.CreateLoad(CGF.GetAddrOfLocalVar(Args[SrcArgIndex]));
       LValue ThisRHSLV = CGF.MakeNaturalAlignAddrLValue(SrcPtr, RecordTy);
       LValue Src = CGF.EmitLValueForFieldInitialization(ThisRHSLV, Field);
+      // CHEERP: The source field is read without a member expression
+      if (CGF.getLangOpts().CheerpFieldAccessInfo)
+        CGF.CGM.AddCheerpFieldAccess(Field, /*IsWrite=*/false,
+                                     /*InLoop=*/false);
 
       // Copy the aggregate.
       CGF.EmitAggregateCopy(LHS, Src, FieldType, CGF.getOverlapForFieldInit(Field),
@@ -1533,6 +1544,12 @@ void CodeGenFunction::EmitCtorPrologue(const CXXConstructorDecl *CD,
 
   InitializeVTablePointers(ClassDecl);
 
+  // CHEERP: Create all the fields in declaration order before they are
+  // conditionally initialized, so that every object has the same shape
+  if (getLangOpts().CheerpStableShapes && !getTarget().isByteAddressable() &&
+      CurFn->getSection() != StringRef("asmjs"))
+    EmitCheerpStableShapeInit(ClassDecl);
+
   // And finally, initialize class members.
   FieldConstructionScope FCS(*this, LoadCXXThisAddress());
   ConstructorMemcpyizer CM(*this, CD, Args);
@@ -1546,6 +1563,36 @@ void CodeGenFunction::EmitCtorPrologue(const CXXConstructorDecl *CD,
   CM.finish();
 }
 
+void CodeGenFunction::EmitCheerpStableShapeInit(const CXXRecordDecl *RD) {
+  // Virtual bases are placed differently depending on the most derived class,
+  // and the layout of unions and bytelayout objects is fixed anyway
+  if (RD->isUnion() || RD->isByteLayout() || RD->getNumVBases())
+    return;
+
+  QualType RecordTy = getContext().getRecordType(RD);
+  LValue ThisLV = MakeNaturalAlignAddrLValue(LoadCXXThis(), RecordTy);
+  for (const FieldDecl *Field : RD->fields()) {
+    QualType FieldType = Field->getType();
+    // Bit-fields share their storage and references must be bound by the
+    // initializer
+    if (Field->isBitField() || FieldType->isReferenceType() ||
+        FieldType->isIncompleteArrayType() || Field->isZeroSize(getContext()))
+      continue;
+    // Records with a non-trivial default constructor create their own fields
+    // in their constructor prologue, whichever constructor is used
+    QualType ElementType = getContext().getBaseElementType(FieldType);
+    if (const CXXRecordDecl *FieldRD = ElementType->getAsCXXRecordDecl())
+      if (!FieldRD->hasTrivialDefaultConstructor())
+        continue;
+    LValue FieldLV = EmitLValueForField(ThisLV, Field);
+    if (hasScalarEvaluationKind(FieldType))
+      EmitStoreOfScalar(CGM.EmitNullConstant(FieldType), FieldLV,
+                        /*isInit*/ true);
+    else
+      EmitNullInitialization(FieldLV.getAddress(), FieldType);
+  }
+}
+
 static bool
 FieldHasTrivialDestructorBody(ASTContext &Context, const FieldDecl *Field);
 
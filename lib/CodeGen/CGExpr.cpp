@@ -3862,6 +3862,11 @@ EmitExtVectorElementExpr(const ExtVectorElementExpr *E) {
 }
 
 LValue CodeGenFunction::EmitMemberExpr(const MemberExpr *E) {
+  // CHEERP: Only the outermost member expression is being stored to, any field
+  // accessed while computing the base is read.
+  bool IsFieldStore = IsCheerpFieldStore;
+  IsCheerpFieldStore = false;
+
   if (DeclRefExpr *DRE = tryToConvertMemberExprToDeclRefExpr(*this, E)) {
     EmitIgnoredExpr(E->getBase());
     return EmitDeclRefLValue(DRE);
@@ -3891,6 +3896,8 @@ LValue CodeGenFunction::EmitMemberExpr(const MemberExpr *E) {
   if (auto *Field = dyn_cast<FieldDecl>(ND)) {
     LValue LV = EmitLValueForField(BaseLV, Field);
     setObjCGCLValueClass(getContext(), E, LV);
+    if (getLangOpts().CheerpFieldAccessInfo)
+      CGM.AddCheerpFieldAccess(Field, IsFieldStore, LoopStack.hasInfo());
     return LV;
   }
 
@@ -4956,7 +4963,7 @@ RValue CodeGenFunction::EmitCall(QualType CalleeType, const CGCallee &OrigCallee
 
   llvm::CallBase *CallOrInvoke = nullptr;
   RValue Call = EmitCall(FnInfo, Callee, ReturnValue, Args, &CallOrInvoke,
-                         E->getExprLoc());
+                         E->getExprLoc(), E == MustTailCall);
 
   // Generate function declaration DISuprogram in order to be used
   // in debug info about call sites.
@@ -1919,6 +1919,10 @@ void CodeGenFunction::EmitAggregateCopy(LValue Dest, LValue Src, QualType Ty,
   Address DestPtr = Dest.getAddress();
   Address SrcPtr = Src.getAddress();
 
+  // CHEERP: Copying an aggregate reads all of its fields
+  if (getLangOpts().CheerpFieldAccessInfo)
+    CGM.AddCheerpRecordRead(Ty, LoopStack.hasInfo());
+
   if (getLangOpts().CPlusPlus) {
     if (const RecordType *RT = Ty->getAs<RecordType>()) {
       CXXRecordDecl *Record = cast<CXXRecordDecl>(RT->getDecl());
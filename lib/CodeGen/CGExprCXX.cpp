@@ -89,7 +89,8 @@ RValue CodeGenFunction::EmitCXXMemberOrOperatorCall(
   auto &FnInfo = CGM.getTypes().arrangeCXXMethodCall(
       Args, FPT, CallInfo.ReqArgs, CallInfo.PrefixSize);
   return EmitCall(FnInfo, Callee, ReturnValue, Args, nullptr,
-                  CE ? CE->getExprLoc() : SourceLocation());
+                  CE ? CE->getExprLoc() : SourceLocation(),
+                  CE && CE == MustTailCall);
 }
 
 RValue CodeGenFunction::EmitCXXDestructorCall(
@@ -35,6 +35,7 @@
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/SaveAndRestore.h"
 #include "clang/Sema/SemaDiagnostic.h"
 #include <cstdarg>
 
@@ -3962,7 +3963,14 @@ Value *ScalarExprEmitter::VisitBinAssign(const BinaryOperator *E) {
     // __block variables need to have the rhs evaluated first, plus
     // this should improve codegen just a little.
     RHS = Visit(E->getRHS());
-    LHS = EmitCheckedLValue(E->getLHS(), CodeGenFunction::TCK_Store);
+    {
+      // CHEERP: A plain store does not read the field, unless the result of
+      // the assignment needs to be reloaded
+      llvm::SaveAndRestore<bool> FieldStore(CGF.IsCheerpFieldStore,
+          isa<MemberExpr>(E->getLHS()->IgnoreParens()) &&
+          !E->getLHS()->getType().isVolatileQualified());
+      LHS = EmitCheckedLValue(E->getLHS(), CodeGenFunction::TCK_Store);
+    }
 
     // Store the value into the LHS.  Bit-fields are handled specially
     // because the result is altered by the store, i.e., [C99 6.5.16p1]
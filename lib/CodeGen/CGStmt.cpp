@@ -23,6 +23,7 @@
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/MDBuilder.h"
+#include "llvm/Support/SaveAndRestore.h"
 
 using namespace clang;
 using namespace CodeGen;
@@ -583,6 +584,15 @@ void CodeGenFunction::EmitLabelStmt(const LabelStmt &S) {
 }
 
 void CodeGenFunction::EmitAttributedStmt(const AttributedStmt &S) {
+  const CallExpr *MustTail = nullptr;
+  for (const auto *A : S.getAttrs()) {
+    if (A->getKind() == attr::MustTail) {
+      // Sema checked that this is a return of a call expression
+      const ReturnStmt *R = cast<ReturnStmt>(S.getSubStmt());
+      MustTail = cast<CallExpr>(R->getRetValue()->IgnoreParenImpCasts());
+    }
+  }
+  SaveAndRestore<const CallExpr *> SaveMustTail(MustTailCall, MustTail);
   EmitStmt(S.getSubStmt(), S.getAttrs());
 }
 
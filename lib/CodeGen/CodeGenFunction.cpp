@@ -1195,6 +1195,18 @@ void CodeGenFunction::GenerateCode(GlobalDecl GD, llvm::Function *Fn,
   // Emit the standard function prologue.
   StartFunction(GD, ResTy, Fn, FnInfo, Args, Loc, BodyRange.getBegin());
 
+  // CHEERP: Defaulted copy and move operations may copy fields without member
+  // expressions, for example arrays, so they read every field of the class
+  if (getLangOpts().CheerpFieldAccessInfo && FD->isDefaulted()) {
+    const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD);
+    const CXXConstructorDecl *CD = dyn_cast<CXXConstructorDecl>(FD);
+    if ((CD && CD->isCopyOrMoveConstructor()) ||
+        (MD && (MD->isCopyAssignmentOperator() ||
+                MD->isMoveAssignmentOperator())))
+      CGM.AddCheerpRecordRead(getContext().getRecordType(MD->getParent()),
+                              /*InLoop=*/false);
+  }
+
   // Generate the body of the function.
   PGO.assignRegionCounters(GD, CurFn);
   if (isa<CXXDestructorDecl>(FD))
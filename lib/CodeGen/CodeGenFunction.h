@@ -299,6 +299,14 @@ public:
   QualType FnRetTy;
   llvm::Function *CurFn = nullptr;
 
+  /// The call expression of the return statement marked musttail which is
+  /// currently being emitted, if any.
+  const CallExpr *MustTailCall = nullptr;
+
+  /// CHEERP: Set while emitting the member expression on the left hand side of
+  /// a plain assignment, which only writes the field.
+  bool IsCheerpFieldStore = false;
+
   // Holds coroutine data if the current function is a coroutine. We use a
   // wrapper to manage its lifetime, so that we don't have to define CGCoroData
   // in this header.
@@ -1898,6 +1906,12 @@ public:
 
   void EmitInitializerForField(FieldDecl *Field, LValue LHS, Expr *Init);
 
+  /// CHEERP: Store a null value in every field of \p RD, in declaration
+  /// order, for -cheerp-stable-shapes. Arrays and records with a trivial
+  /// default constructor are cleared as a whole, the other records are left
+  /// to their own constructor.
+  void EmitCheerpStableShapeInit(const CXXRecordDecl *RD);
+
   /// Struct with all information about dynamic [sub]class needed to set vptr.
   struct VPtr {
     BaseSubobject Base;
@@ -3621,7 +3635,8 @@ public:
   /// LLVM arguments and the types they were derived from.
   RValue EmitCall(const CGFunctionInfo &CallInfo, const CGCallee &Callee,
                   ReturnValueSlot ReturnValue, const CallArgList &Args,
-                  llvm::CallBase **callOrInvoke, SourceLocation Loc);
+                  llvm::CallBase **callOrInvoke, SourceLocation Loc,
+                  bool IsMustTail = false);
   RValue EmitCall(const CGFunctionInfo &CallInfo, const CGCallee &Callee,
                   ReturnValueSlot ReturnValue, const CallArgList &Args,
                   llvm::CallBase **callOrInvoke = nullptr) {
@@ -3786,6 +3801,9 @@ public:
 
   llvm::Value *BuildVector(ArrayRef<llvm::Value*> Ops);
   llvm::Value *EmitCheerpBuiltinExpr(unsigned BuiltinID, const CallExpr *E, bool asmjs);
+  llvm::Value *EmitCheerpCachedClosure(llvm::Function *CreateClosure,
+                                       ArrayRef<llvm::Value*> Ops,
+                                       const CallExpr *E);
   llvm::Value *EmitX86BuiltinExpr(unsigned BuiltinID, const CallExpr *E);
   llvm::Value *EmitPPCBuiltinExpr(unsigned BuiltinID, const CallExpr *E);
   llvm::Value *EmitAMDGPUBuiltinExpr(unsigned BuiltinID, const CallExpr *E);
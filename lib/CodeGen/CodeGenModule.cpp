@@ -62,6 +62,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/TimeProfiler.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 using namespace clang;
 using namespace CodeGen;
@@ -447,6 +448,8 @@ void CodeGenModule::Release() {
   }
   emitAtAvailableLinkGuard();
   emitLLVMUsed();
+  EmitCheerpFieldAccessInfo();
+  EmitCheerpDualSectionFunctions();
   if (SanStats)
     SanStats->finish();
 
@@ -5717,6 +5720,179 @@ llvm::Constant *CodeGenModule::GetAddrOfRTTIDescriptor(QualType Ty,
   return getCXXABI().getAddrOfRTTIDescriptor(Ty);
 }
 
+void CodeGenModule::AddCheerpFieldAccess(const FieldDecl *Field, bool IsWrite,
+                                         bool InLoop) {
+  const RecordDecl *RD = Field->getParent();
+  // Only the layout of genericjs objects can be changed
+  if (getTarget().isByteAddressable() || RD->isUnion() || RD->isByteLayout() ||
+      RD->hasAttr<AsmJSAttr>() || Field->isBitField())
+    return;
+  CheerpFieldAccess &Access = CheerpFieldAccesses[Field->getCanonicalDecl()];
+  if (IsWrite)
+    Access.Writes++;
+  else
+    Access.Reads++;
+  if (InLoop)
+    Access.LoopAccesses++;
+}
+
+void CodeGenModule::AddCheerpRecordRead(QualType Ty, bool InLoop) {
+  const RecordType *RT =
+      getContext().getBaseElementType(Ty)->getAs<RecordType>();
+  if (!RT)
+    return;
+  const RecordDecl *RD = RT->getDecl()->getDefinition();
+  if (!RD)
+    return;
+  if (const CXXRecordDecl *CXXRD = dyn_cast<CXXRecordDecl>(RD))
+    for (const CXXBaseSpecifier &Base : CXXRD->bases())
+      AddCheerpRecordRead(Base.getType(), InLoop);
+  for (const FieldDecl *Field : RD->fields()) {
+    AddCheerpFieldAccess(Field, /*IsWrite=*/false, InLoop);
+    AddCheerpRecordRead(Field->getType(), InLoop);
+  }
+}
+
+void CodeGenModule::EmitCheerpFieldAccessInfo() {
+  if (!getLangOpts().CheerpFieldAccessInfo)
+    return;
+  // Records which are not described at all have no accessed fields. The flag
+  // only tells that this module has been compiled with the information: the
+  // linker rejects modules with different values, but a module without the
+  // flag links silently and the flag survives. The driver passes the option
+  // to every compilation when the optimization is requested, and the
+  // optimization must not trust the flag for modules built otherwise.
+  getModule().addModuleFlag(llvm::Module::Error, "cheerp.field.access.info", 1);
+  if (CheerpFieldAccesses.empty())
+    return;
+  llvm::NamedMDNode *NMD = getModule().getOrInsertNamedMetadata("cheerp.field.access");
+  for (const auto &It : CheerpFieldAccesses) {
+    const FieldDecl *Field = It.first;
+    const RecordDecl *RD = Field->getParent();
+    llvm::Type *RecordTy =
+        getTypes().ConvertTypeForMem(getContext().getRecordType(RD));
+    unsigned FieldNo = getTypes().getCGRecordLayout(RD).getLLVMFieldNo(Field);
+    llvm::Metadata *Ops[] = {
+      llvm::ConstantAsMetadata::get(
+          llvm::Constant::getNullValue(RecordTy->getPointerTo())),
+      llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(Int32Ty, FieldNo)),
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantInt::get(Int32Ty, It.second.Reads)),
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantInt::get(Int32Ty, It.second.Writes)),
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantInt::get(Int32Ty, It.second.LoopAccesses))
+    };
+    NMD->addOperand(llvm::MDNode::get(getLLVMContext(), Ops));
+  }
+}
+
+/// Check if \p F can be emitted in both the genericjs and the asmjs section.
+/// Only small functions which take and return scalar values, and which only
+/// access their own scalar locals, are considered.
+static bool isCheerpDualSectionCandidate(const llvm::Function *F) {
+  const unsigned MaxInstructions = 64;
+  if (F->isDeclaration() || F->isVarArg() || F->hasPersonalityFn() ||
+      F->hasAddressTaken())
+    return false;
+  // Only inline and internal functions can be duplicated, since any other
+  // definition may be replaced at link time
+  if (!F->hasLocalLinkage() && !F->hasLinkOnceODRLinkage())
+    return false;
+  auto isScalar = [](llvm::Type *T) {
+    return T->isVoidTy() || T->isIntegerTy() || T->isFloatingPointTy();
+  };
+  if (!isScalar(F->getReturnType()))
+    return false;
+  for (const llvm::Argument &A : F->args())
+    if (!isScalar(A.getType()))
+      return false;
+
+  unsigned NumInstructions = 0;
+  for (const llvm::BasicBlock &BB : *F) {
+    for (const llvm::Instruction &I : BB) {
+      if (isa<llvm::DbgInfoIntrinsic>(I))
+        continue;
+      if (++NumInstructions > MaxInstructions)
+        return false;
+      if (const auto *AI = dyn_cast<llvm::AllocaInst>(&I)) {
+        if (!isScalar(AI->getAllocatedType()) || AI->isArrayAllocation())
+          return false;
+      } else if (const auto *LI = dyn_cast<llvm::LoadInst>(&I)) {
+        if (!isa<llvm::AllocaInst>(LI->getPointerOperand()) || LI->isVolatile())
+          return false;
+      } else if (const auto *SI = dyn_cast<llvm::StoreInst>(&I)) {
+        if (!isa<llvm::AllocaInst>(SI->getPointerOperand()) || SI->isVolatile())
+          return false;
+      } else if (const auto *CI = dyn_cast<llvm::CallInst>(&I)) {
+        // Pure intrinsics, like the math ones, are available in both sections
+        const llvm::Function *Callee = CI->getCalledFunction();
+        if (!Callee || !Callee->isIntrinsic() || !Callee->doesNotAccessMemory())
+          return false;
+      } else if (isa<llvm::CastInst>(I)) {
+        if (!isScalar(I.getType()) || !isScalar(I.getOperand(0)->getType()))
+          return false;
+      } else if (!isa<llvm::BinaryOperator>(I) && !isa<llvm::CmpInst>(I) &&
+                 !isa<llvm::SelectInst>(I) && !isa<llvm::PHINode>(I) &&
+                 !isa<llvm::UnaryOperator>(I) && !I.isTerminator()) {
+        return false;
+      } else if (I.isTerminator() && !isa<llvm::BranchInst>(I) &&
+                 !isa<llvm::SwitchInst>(I) && !isa<llvm::ReturnInst>(I) &&
+                 !isa<llvm::UnreachableInst>(I)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void CodeGenModule::EmitCheerpDualSectionFunctions() {
+  if (!getLangOpts().CheerpDualSectionFunctions ||
+      getTarget().isByteAddressable())
+    return;
+
+  auto isAsmJS = [](const llvm::Function *F) {
+    return F->getSection() == StringRef("asmjs");
+  };
+  // Collect the calls which cross the section boundary first, the clones
+  // are added to the module while iterating over them
+  SmallVector<llvm::CallInst *, 16> CrossSectionCalls;
+  for (llvm::Function &F : getModule()) {
+    for (llvm::BasicBlock &BB : F) {
+      for (llvm::Instruction &I : BB) {
+        auto *CI = dyn_cast<llvm::CallInst>(&I);
+        if (!CI)
+          continue;
+        llvm::Function *Callee = CI->getCalledFunction();
+        if (Callee && !Callee->isIntrinsic() && isAsmJS(Callee) != isAsmJS(&F))
+          CrossSectionCalls.push_back(CI);
+      }
+    }
+  }
+
+  llvm::DenseMap<llvm::Function *, llvm::Function *> Clones;
+  for (llvm::CallInst *CI : CrossSectionCalls) {
+    llvm::Function *Callee = CI->getCalledFunction();
+    auto It = Clones.find(Callee);
+    if (It == Clones.end()) {
+      llvm::Function *Clone = nullptr;
+      if (isCheerpDualSectionCandidate(Callee)) {
+        llvm::ValueToValueMapTy VMap;
+        Clone = llvm::CloneFunction(Callee, VMap);
+        bool CloneAsmJS = !isAsmJS(Callee);
+        Clone->setName(Callee->getName() +
+                       (CloneAsmJS ? ".cheerp.asmjs" : ".cheerp.genericjs"));
+        Clone->setLinkage(llvm::GlobalValue::InternalLinkage);
+        Clone->setComdat(nullptr);
+        Clone->setSection(CloneAsmJS ? "asmjs" : "");
+      }
+      It = Clones.insert({Callee, Clone}).first;
+    }
+    if (It->second)
+      CI->setCalledFunction(It->second);
+  }
+}
+
 void CodeGenModule::EmitOMPThreadPrivateDecl(const OMPThreadPrivateDecl *D) {
   // Do not emit threadprivates in simd-only mode.
   if (LangOpts.OpenMP && LangOpts.OpenMPSimd)
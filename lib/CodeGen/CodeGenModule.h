@@ -468,6 +468,15 @@ private:
   /// The complete set of modules that has been imported.
   llvm::SetVector<clang::Module *> ImportedModules;
 
+  /// CHEERP: How the fields of genericjs records are accessed in this TU.
+  struct CheerpFieldAccess {
+    unsigned Reads = 0;
+    unsigned Writes = 0;
+    /// Reads and writes which happen inside a loop
+    unsigned LoopAccesses = 0;
+  };
+  llvm::MapVector<const FieldDecl *, CheerpFieldAccess> CheerpFieldAccesses;
+
   /// The set of modules for which the module initializers
   /// have been emitted.
   llvm::SmallPtrSet<clang::Module *, 16> EmittedModuleInitializers;
@@ -843,6 +852,14 @@ public:
                                     ForDefinition_t IsForDefinition
                                       = NotForDefinition);
 
+  /// CHEERP: Record an access to \p Field for the object shape optimization.
+  void AddCheerpFieldAccess(const FieldDecl *Field, bool IsWrite, bool InLoop);
+
+  /// CHEERP: Record a read of every field of \p Ty, including the ones of its
+  /// bases and of nested records. Used for copies and member pointer accesses,
+  /// which can not be attributed to a single field.
+  void AddCheerpRecordRead(QualType Ty, bool InLoop);
+
   /// Get the address of the RTTI descriptor for the given type.
   llvm::Constant *GetAddrOfRTTIDescriptor(QualType Ty, bool ForEH = false);
 
@@ -1453,6 +1470,15 @@ private:
   /// Emit the llvm.used and llvm.compiler.used metadata.
   void emitLLVMUsed();
 
+  /// Emit the cheerp.field.access named metadata, used by the Cheerp link step
+  /// to remove never read fields and to reorder fields of genericjs records.
+  void EmitCheerpFieldAccessInfo();
+
+  /// Redirect calls between genericjs and asmjs code to a copy of the callee
+  /// in the section of the caller, when the callee is small and only works
+  /// on scalar values.
+  void EmitCheerpDualSectionFunctions();
+
   /// Emit the link options introduced by imported modules.
   void EmitModuleLinkOptions();
 
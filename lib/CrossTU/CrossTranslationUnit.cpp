@@ -18,10 +18,15 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Index/USRGeneration.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <fstream>
@@ -49,6 +54,11 @@ STATISTIC(NumLangMismatch, "The # of language mismatches");
 STATISTIC(NumLangDialectMismatch, "The # of language dialect mismatches");
 STATISTIC(NumASTLoadThresholdReached,
           "The # of ASTs not loaded because of threshold");
+STATISTIC(NumASTUnitsLoaded, "The # of AST files loaded, including reloads");
+STATISTIC(NumASTUnitsEvicted,
+          "The # of ASTs unloaded because of the memory budget");
+STATISTIC(NumASTUnitCacheHits,
+          "The # of AST lookups served by an already loaded AST");
 
 // Same as Triple's equality operator, but we check a field only if that is
 // known in both instances.
@@ -166,6 +176,233 @@ createCrossTUIndexString(const llvm::StringMap<std::string> &Index) {
   return Result.str();
 }
 
+namespace {
+
+/// The layout of a binary index:
+///
+///   Signature      "CTUIDX"
+///   Version        uint16
+///   TableOffset    uint32, the offset of the hash table buckets
+///   FilesOffset    uint32, the offset of the file table
+///   <hash table>   USR -> uint32 file number
+///   <file table>   uint32 NumFiles, NumFiles uint32 offsets of the names,
+///                  each name stored as a uint32 length and the characters
+///
+/// All the integers are little endian and all the offsets are relative to the
+/// start of the file.
+const char IndexTableSignature[] = {'C', 'T', 'U', 'I', 'D', 'X'};
+const unsigned IndexTableVersion = 1;
+const unsigned IndexTableHeaderSize = sizeof(IndexTableSignature) + 2 + 4 + 4;
+
+class IndexTableWriterTrait {
+public:
+  using key_type = StringRef;
+  using key_type_ref = StringRef;
+  using data_type = uint32_t;
+  using data_type_ref = uint32_t;
+  using hash_value_type = uint32_t;
+  using offset_type = uint32_t;
+
+  static hash_value_type ComputeHash(key_type_ref Key) {
+    return llvm::djbHash(Key);
+  }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(raw_ostream &Out, key_type_ref Key, data_type_ref) {
+    llvm::support::endian::write<uint32_t>(Out, Key.size(),
+                                           llvm::support::little);
+    return std::make_pair(Key.size(), 4);
+  }
+
+  static void EmitKey(raw_ostream &Out, key_type_ref Key, offset_type) {
+    Out << Key;
+  }
+
+  static void EmitData(raw_ostream &Out, key_type_ref, data_type_ref Data,
+                       offset_type) {
+    llvm::support::endian::write<uint32_t>(Out, Data, llvm::support::little);
+  }
+};
+
+class IndexTableReaderTrait {
+public:
+  using internal_key_type = StringRef;
+  using external_key_type = StringRef;
+  using data_type = uint32_t;
+  using hash_value_type = uint32_t;
+  using offset_type = uint32_t;
+
+  static bool EqualKey(StringRef LHS, StringRef RHS) { return LHS == RHS; }
+
+  static hash_value_type ComputeHash(StringRef Key) {
+    return llvm::djbHash(Key);
+  }
+
+  static StringRef GetInternalKey(StringRef Key) { return Key; }
+
+  static std::pair<offset_type, offset_type>
+  ReadKeyDataLength(const unsigned char *&Data) {
+    using namespace llvm::support;
+    offset_type KeyLen = endian::readNext<uint32_t, little, unaligned>(Data);
+    return std::make_pair(KeyLen, 4);
+  }
+
+  static StringRef ReadKey(const unsigned char *Data, offset_type KeyLen) {
+    return StringRef(reinterpret_cast<const char *>(Data), KeyLen);
+  }
+
+  static data_type ReadData(StringRef, const unsigned char *Data,
+                            offset_type) {
+    using namespace llvm::support;
+    return endian::readNext<uint32_t, little, unaligned>(Data);
+  }
+};
+
+using IndexTable = llvm::OnDiskChainedHashTable<IndexTableReaderTrait>;
+
+} // end anonymous namespace
+
+llvm::Error writeCrossTUIndexTable(const llvm::StringMap<std::string> &Index,
+                                   StringRef OutputPath) {
+  using namespace llvm::support;
+
+  // Number the files, so the paths are stored once rather than per USR.
+  llvm::StringMap<uint32_t> FileNumbers;
+  std::vector<StringRef> Files;
+  llvm::OnDiskChainedHashTableGenerator<IndexTableWriterTrait> Generator;
+  for (const auto &E : Index) {
+    auto Inserted = FileNumbers.try_emplace(E.second, Files.size());
+    if (Inserted.second)
+      Files.push_back(E.second);
+    Generator.insert(E.getKey(), Inserted.first->second);
+  }
+
+  SmallString<4096> Buffer;
+  llvm::raw_svector_ostream Out(Buffer);
+  endian::Writer LE(Out, little);
+  Out.write(IndexTableSignature, sizeof(IndexTableSignature));
+  LE.write<uint16_t>(IndexTableVersion);
+  // The offsets are filled in below.
+  LE.write<uint32_t>(0);
+  LE.write<uint32_t>(0);
+  uint32_t TableOffset = Generator.Emit(Out);
+
+  uint32_t FilesOffset = Buffer.size();
+  LE.write<uint32_t>(Files.size());
+  uint32_t NameOffset = FilesOffset + 4 + 4 * Files.size();
+  for (StringRef File : Files) {
+    LE.write<uint32_t>(NameOffset);
+    NameOffset += 4 + File.size();
+  }
+  for (StringRef File : Files) {
+    LE.write<uint32_t>(File.size());
+    Out << File;
+  }
+
+  endian::write32le(&Buffer[sizeof(IndexTableSignature) + 2], TableOffset);
+  endian::write32le(&Buffer[sizeof(IndexTableSignature) + 6], FilesOffset);
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(OutputPath, EC, llvm::sys::fs::F_None);
+  if (EC)
+    return llvm::errorCodeToError(EC);
+  OS << Buffer;
+  OS.close();
+  if (OS.has_error())
+    return llvm::errorCodeToError(OS.error());
+  return llvm::Error::success();
+}
+
+OnDiskCrossTUIndex::OnDiskCrossTUIndex(
+    std::unique_ptr<llvm::MemoryBuffer> Buffer, StringRef CrossTUDir)
+    : Buffer(std::move(Buffer)), CrossTUDir(CrossTUDir) {}
+
+OnDiskCrossTUIndex::~OnDiskCrossTUIndex() {
+  delete static_cast<IndexTable *>(Table);
+}
+
+bool OnDiskCrossTUIndex::isOnDiskIndex(StringRef IndexPath) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Header =
+      llvm::MemoryBuffer::getFileSlice(IndexPath, sizeof(IndexTableSignature),
+                                       0);
+  return Header && (*Header)->getBuffer() ==
+                       StringRef(IndexTableSignature,
+                                 sizeof(IndexTableSignature));
+}
+
+llvm::Expected<std::unique_ptr<OnDiskCrossTUIndex>>
+OnDiskCrossTUIndex::create(StringRef IndexPath, StringRef CrossTUDir) {
+  using namespace llvm::support;
+
+  // Large indexes are memory mapped.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(IndexPath, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return llvm::make_error<IndexError>(index_error_code::missing_index_file,
+                                        IndexPath.str());
+
+  std::unique_ptr<OnDiskCrossTUIndex> Result(
+      new OnDiskCrossTUIndex(std::move(*BufferOrErr), CrossTUDir));
+  StringRef Data = Result->Buffer->getBuffer();
+  auto InvalidFormat = [&]() {
+    return llvm::make_error<IndexError>(index_error_code::invalid_index_format,
+                                        IndexPath.str());
+  };
+  if (Data.size() < IndexTableHeaderSize ||
+      !Data.startswith(
+          StringRef(IndexTableSignature, sizeof(IndexTableSignature))))
+    return InvalidFormat();
+
+  const auto *Base = reinterpret_cast<const unsigned char *>(Data.data());
+  const unsigned char *Ptr = Base + sizeof(IndexTableSignature);
+  if (endian::readNext<uint16_t, little, unaligned>(Ptr) != IndexTableVersion)
+    return InvalidFormat();
+  uint32_t TableOffset = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  uint32_t FilesOffset = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if (TableOffset < IndexTableHeaderSize || TableOffset % 4 != 0 ||
+      TableOffset > FilesOffset || FilesOffset > Data.size() ||
+      Data.size() - FilesOffset < 4)
+    return InvalidFormat();
+
+  Ptr = Base + FilesOffset;
+  Result->NumFiles = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if ((Data.size() - FilesOffset - 4) / 4 < Result->NumFiles)
+    return InvalidFormat();
+  Result->FileOffsets = Ptr;
+  Result->Table = IndexTable::Create(Base + TableOffset, Base);
+  return std::move(Result);
+}
+
+llvm::Optional<std::string>
+OnDiskCrossTUIndex::lookup(StringRef LookupName) const {
+  using namespace llvm::support;
+
+  auto *Index = static_cast<IndexTable *>(Table);
+  auto It = Index->find(LookupName);
+  if (It == Index->end())
+    return None;
+  uint32_t FileNumber = *It;
+  if (FileNumber >= NumFiles)
+    return None;
+
+  StringRef Data = Buffer->getBuffer();
+  const unsigned char *Ptr = FileOffsets + 4 * FileNumber;
+  uint32_t NameOffset = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if (NameOffset > Data.size() || Data.size() - NameOffset < 4)
+    return None;
+  StringRef Name = Data.substr(NameOffset);
+  Ptr = reinterpret_cast<const unsigned char *>(Name.data());
+  uint32_t NameLength = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if (Name.size() - 4 < NameLength)
+    return None;
+  Name = Name.substr(4, NameLength);
+
+  SmallString<256> FilePath = StringRef(CrossTUDir);
+  llvm::sys::path::append(FilePath, Name);
+  return FilePath.str().str();
+}
+
 bool containsConst(const VarDecl *VD, const ASTContext &ACtx) {
   CanQualType CT = ACtx.getCanonicalType(VD->getType());
   if (!CT.isConstQualified()) {
@@ -189,7 +426,8 @@ template <typename T> static bool hasBodyOrInit(const T *D) {
 
 CrossTranslationUnitContext::CrossTranslationUnitContext(CompilerInstance &CI)
     : CI(CI), Context(CI.getASTContext()),
-      CTULoadThreshold(CI.getAnalyzerOpts()->CTUImportThreshold) {}
+      CTULoadThreshold(CI.getAnalyzerOpts()->CTUImportThreshold),
+      MemoryBudget(uint64_t(CI.getAnalyzerOpts()->CTUMemoryBudget) << 20) {}
 
 CrossTranslationUnitContext::~CrossTranslationUnitContext() {}
 
@@ -354,31 +592,52 @@ llvm::Expected<ASTUnit *> CrossTranslationUnitContext::loadExternalAST(
         index_error_code::load_threshold_reached);
   }
 
-  ASTUnit *Unit = nullptr;
+  LoadedASTUnit *Loaded = nullptr;
   auto NameUnitCacheEntry = NameASTUnitMap.find(LookupName);
-  if (NameUnitCacheEntry == NameASTUnitMap.end()) {
-    if (NameFileMap.empty()) {
+  if (NameUnitCacheEntry != NameASTUnitMap.end() &&
+      !NameUnitCacheEntry->second->Evicted) {
+    Loaded = NameUnitCacheEntry->second;
+    ++NumASTUnitCacheHits;
+  } else {
+    if (NameFileMap.empty() && !OnDiskIndex) {
       SmallString<256> IndexFile = CrossTUDir;
       if (llvm::sys::path::is_absolute(IndexName))
         IndexFile = IndexName;
       else
         llvm::sys::path::append(IndexFile, IndexName);
-      llvm::Expected<llvm::StringMap<std::string>> IndexOrErr =
-          parseCrossTUIndex(IndexFile, CrossTUDir);
-      if (IndexOrErr)
-        NameFileMap = *IndexOrErr;
-      else
-        return IndexOrErr.takeError();
+      if (OnDiskCrossTUIndex::isOnDiskIndex(IndexFile)) {
+        llvm::Expected<std::unique_ptr<OnDiskCrossTUIndex>> IndexOrErr =
+            OnDiskCrossTUIndex::create(IndexFile, CrossTUDir);
+        if (IndexOrErr)
+          OnDiskIndex = std::move(*IndexOrErr);
+        else
+          return IndexOrErr.takeError();
+      } else {
+        llvm::Expected<llvm::StringMap<std::string>> IndexOrErr =
+            parseCrossTUIndex(IndexFile, CrossTUDir);
+        if (IndexOrErr)
+          NameFileMap = *IndexOrErr;
+        else
+          return IndexOrErr.takeError();
+      }
     }
 
-    auto It = NameFileMap.find(LookupName);
-    if (It == NameFileMap.end()) {
+    std::string ASTFileName;
+    if (OnDiskIndex) {
+      if (llvm::Optional<std::string> FileName = OnDiskIndex->lookup(LookupName))
+        ASTFileName = std::move(*FileName);
+    } else {
+      auto It = NameFileMap.find(LookupName);
+      if (It != NameFileMap.end())
+        ASTFileName = It->second;
+    }
+    if (ASTFileName.empty()) {
       ++NumNotInOtherTU;
       return llvm::make_error<IndexError>(index_error_code::missing_definition);
     }
-    StringRef ASTFileName = It->second;
     auto ASTCacheEntry = FileASTUnitMap.find(ASTFileName);
-    if (ASTCacheEntry == FileASTUnitMap.end()) {
+    if (ASTCacheEntry == FileASTUnitMap.end() ||
+        ASTCacheEntry->second.Evicted) {
       IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
       TextDiagnosticPrinter *DiagClient =
           new TextDiagnosticPrinter(llvm::errs(), &*DiagOpts);
@@ -389,26 +648,101 @@ llvm::Expected<ASTUnit *> CrossTranslationUnitContext::loadExternalAST(
       std::unique_ptr<ASTUnit> LoadedUnit(ASTUnit::LoadFromASTFile(
           ASTFileName, CI.getPCHContainerOperations()->getRawReader(),
           ASTUnit::LoadEverything, Diags, CI.getFileSystemOpts()));
-      Unit = LoadedUnit.get();
-      FileASTUnitMap[ASTFileName] = std::move(LoadedUnit);
-      ++NumASTLoaded;
+      // An evicted AST has already been counted against the threshold.
+      if (ASTCacheEntry == FileASTUnitMap.end())
+        ++NumASTLoaded;
+      ++NumASTUnitsLoaded;
+      Loaded = &FileASTUnitMap[ASTFileName];
+      Loaded->Unit = std::move(LoadedUnit);
+      Loaded->Evicted = false;
       if (DisplayCTUProgress) {
         llvm::errs() << "CTU loaded AST file: "
                      << ASTFileName << "\n";
       }
     } else {
-      Unit = ASTCacheEntry->second.get();
+      Loaded = &ASTCacheEntry->second;
+      ++NumASTUnitCacheHits;
     }
-    NameASTUnitMap[LookupName] = Unit;
-  } else {
-    Unit = NameUnitCacheEntry->second;
+    NameASTUnitMap[LookupName] = Loaded;
   }
+  ASTUnit *Unit = Loaded->Unit.get();
   if (!Unit)
     return llvm::make_error<IndexError>(
         index_error_code::failed_to_get_external_ast);
+  Loaded->LastUse = ++ASTUseCounter;
+  enforceMemoryBudget(Unit, DisplayCTUProgress);
   return Unit;
 }
 
+/// Estimate the memory taken up by an AST loaded from a file, counting the
+/// same allocations as clang_getCXTUResourceUsage.
+static uint64_t getMemoryUsage(ASTUnit &Unit) {
+  const ASTContext &Ctx = Unit.getASTContext();
+  const SourceManager &SM = Unit.getSourceManager();
+  uint64_t Size = Ctx.getASTAllocatedMemory() +
+                  Ctx.getSideTableAllocatedMemory() +
+                  Ctx.Idents.getAllocator().getTotalMemory() +
+                  Ctx.Selectors.getTotalMemory() + SM.getContentCacheSize() +
+                  SM.getDataStructureSizes();
+  SourceManager::MemoryBufferSizes Buffers = SM.getMemoryBufferSizes();
+  Size += Buffers.malloc_bytes + Buffers.mmap_bytes;
+  if (const ExternalASTSource *Source = Ctx.getExternalSource()) {
+    ExternalASTSource::MemoryBufferSizes Sizes = Source->getMemoryBufferSizes();
+    Size += Sizes.malloc_bytes + Sizes.mmap_bytes;
+  }
+  const Preprocessor &PP = Unit.getPreprocessor();
+  Size += PP.getTotalMemory() + PP.getHeaderSearchInfo().getTotalMemory();
+  return Size;
+}
+
+void CrossTranslationUnitContext::enforceMemoryBudget(
+    const ASTUnit *InUse, bool DisplayCTUProgress) {
+  if (!MemoryBudget)
+    return;
+
+  // The ASTs grow as definitions are imported from them, so their sizes are
+  // recomputed rather than recorded at load time.
+  uint64_t MemoryUsed = 0;
+  for (const auto &E : FileASTUnitMap)
+    if (E.second.Unit)
+      MemoryUsed += getMemoryUsage(*E.second.Unit);
+
+  while (MemoryUsed > MemoryBudget) {
+    llvm::StringMapEntry<LoadedASTUnit> *LRU = nullptr;
+    for (auto &E : FileASTUnitMap) {
+      if (!E.second.Unit || E.second.Unit.get() == InUse)
+        continue;
+      if (!LRU || E.second.LastUse < LRU->second.LastUse)
+        LRU = &E;
+    }
+    if (!LRU)
+      break;
+    MemoryUsed -= getMemoryUsage(*LRU->second.Unit);
+    evictASTUnit(*LRU, DisplayCTUProgress);
+  }
+}
+
+void CrossTranslationUnitContext::evictASTUnit(
+    llvm::StringMapEntry<LoadedASTUnit> &Entry, bool DisplayCTUProgress) {
+  ASTUnit *Unit = Entry.second.Unit.get();
+  assert(Unit && "Evicting an AST that is not loaded");
+
+  // The imported declarations live in the ASTContext of this TU, the only
+  // references back into the evicted AST are held by its importer and by the
+  // map of imported FileIDs.
+  ASTUnitImporterMap.erase(Unit->getASTContext().getTranslationUnitDecl());
+  for (auto I = ImportedFileIDs.begin(), E = ImportedFileIDs.end(); I != E;
+       ++I)
+    if (I->second.second == Unit)
+      ImportedFileIDs.erase(I);
+
+  Entry.second.Unit.reset();
+  Entry.second.Evicted = true;
+  ++NumASTUnitsEvicted;
+  if (DisplayCTUProgress)
+    llvm::errs() << "CTU evicted AST file: " << Entry.getKey() << "\n";
+}
+
 template <typename T>
 llvm::Expected<const T *>
 CrossTranslationUnitContext::importDefinitionImpl(const T *D, ASTUnit *Unit) {
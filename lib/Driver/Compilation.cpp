@@ -17,14 +17,21 @@
 #include "clang/Driver/Util.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptSpecifier.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <utility>
@@ -148,11 +155,10 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand) const {
+bool Compilation::PrintCommand(const Command &C, raw_ostream &ErrOS) const {
   if ((getDriver().CCPrintOptions ||
        getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
-    raw_ostream *OS = &llvm::errs();
+    raw_ostream *OS = &ErrOS;
     std::unique_ptr<llvm::raw_fd_ostream> OwnedStream;
 
     // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
@@ -165,8 +171,7 @@ int Compilation::ExecuteCommand(const Command &C,
       if (EC) {
         getDriver().Diag(diag::err_drv_cc_print_options_failure)
             << EC.message();
-        FailingCommand = &C;
-        return 1;
+        return false;
       }
       OS = OwnedStream.get();
     }
@@ -176,6 +181,15 @@ int Compilation::ExecuteCommand(const Command &C,
 
     C.Print(*OS, "\n", /*Quote=*/getDriver().CCPrintOptions);
   }
+  return true;
+}
+
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand) const {
+  if (!PrintCommand(C, llvm::errs())) {
+    FailingCommand = &C;
+    return 1;
+  }
 
   std::string Error;
   bool ExecutionFailed;
@@ -220,8 +234,195 @@ static bool InputsOk(const Command &C,
   return !ActionFailed(&C.getSource(), FailingCommands);
 }
 
+namespace {
+/// The state of a job scheduled by Compilation::ExecuteJobsInParallel.
+struct ParallelJob {
+  enum StateKind { Pending, Running, Finished, Skipped };
+  StateKind State = Pending;
+
+  /// The jobs that produce the inputs of this job.
+  SmallVector<size_t, 4> Deps;
+
+  /// The -v output that is printed before the output of the job.
+  std::string Prefix;
+  /// The files the stdout and stderr of the job are redirected to.
+  SmallString<128> OutFile, ErrFile;
+
+  /// The results of Command::Execute, written by the thread that runs the job.
+  int Res = 0;
+  std::string Error;
+  bool ExecutionFailed = false;
+};
+} // end anonymous namespace
+
+/// Copy the contents of \p Path to \p OS and remove the file.
+static void replayOutput(StringRef Path, raw_ostream &OS) {
+  if (Path.empty())
+    return;
+  if (auto Buffer = llvm::MemoryBuffer::getFile(Path))
+    OS << (*Buffer)->getBuffer();
+  OS.flush();
+  llvm::sys::fs::remove(Path);
+}
+
+void Compilation::ExecuteJobsInParallel(const JobList &Jobs,
+                                        FailingCommandList &FailingCommands,
+                                        unsigned NumThreads) const {
+  SmallVector<const Command *, 16> Commands;
+  for (const auto &Job : Jobs)
+    Commands.push_back(&Job);
+  const size_t NumJobs = Commands.size();
+
+  // A job depends on the jobs whose action is reachable from its own action,
+  // and on the earlier jobs of its own action, which run in order. The job
+  // list is in topological order, so only earlier jobs are considered.
+  llvm::DenseMap<const Action *, SmallVector<size_t, 1>> JobsForAction;
+  for (size_t I = 0; I != NumJobs; ++I)
+    JobsForAction[&Commands[I]->getSource()].push_back(I);
+
+  std::vector<ParallelJob> State(NumJobs);
+  for (size_t I = 0; I != NumJobs; ++I) {
+    for (size_t J : JobsForAction[&Commands[I]->getSource()])
+      if (J < I)
+        State[I].Deps.push_back(J);
+    SmallVector<const Action *, 8> Worklist(
+        Commands[I]->getSource().input_begin(),
+        Commands[I]->getSource().input_end());
+    llvm::SmallPtrSet<const Action *, 16> Visited;
+    while (!Worklist.empty()) {
+      const Action *A = Worklist.pop_back_val();
+      if (!Visited.insert(A).second)
+        continue;
+      auto It = JobsForAction.find(A);
+      if (It != JobsForAction.end())
+        for (size_t J : It->second)
+          if (J < I)
+            State[I].Deps.push_back(J);
+      Worklist.append(A->input_begin(), A->input_end());
+    }
+  }
+
+  // The failures in the order they happen, and with the index of their job so
+  // that they are reported in the order of the job list.
+  SmallVector<std::pair<int, const Command *>, 4> FailedSoFar;
+  typedef std::pair<size_t, std::pair<int, const Command *>> IndexedFailure;
+  SmallVector<IndexedFailure, 4> Failures;
+
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::vector<size_t> Done;
+  llvm::ThreadPool Pool(NumThreads);
+
+  size_t NumRunning = 0;
+  size_t NextToReplay = 0;
+  while (true) {
+    // Start the jobs whose inputs are ready.
+    for (size_t I = NextToReplay; I != NumJobs; ++I) {
+      ParallelJob &Job = State[I];
+      if (Job.State != ParallelJob::Pending)
+        continue;
+      if (llvm::any_of(Job.Deps, [&](size_t D) {
+            return State[D].State == ParallelJob::Pending ||
+                   State[D].State == ParallelJob::Running;
+          }))
+        continue;
+      const Command &C = *Commands[I];
+      if (!InputsOk(C, FailedSoFar)) {
+        Job.State = ParallelJob::Skipped;
+        continue;
+      }
+
+      llvm::raw_string_ostream PrefixOS(Job.Prefix);
+      bool Printed = PrintCommand(C, PrefixOS);
+      PrefixOS.flush();
+      if (!Printed ||
+          llvm::sys::fs::createTemporaryFile("clang-job", "out", Job.OutFile) ||
+          llvm::sys::fs::createTemporaryFile("clang-job", "err", Job.ErrFile)) {
+        Job.State = ParallelJob::Finished;
+        Job.Res = 1;
+        FailedSoFar.push_back(std::make_pair(1, &C));
+        Failures.push_back(std::make_pair(I, FailedSoFar.back()));
+        continue;
+      }
+
+      Job.State = ParallelJob::Running;
+      ++NumRunning;
+      Pool.async([&, I]() {
+        ParallelJob &Job = State[I];
+        Optional<StringRef> JobRedirects[] = {None, StringRef(Job.OutFile),
+                                              StringRef(Job.ErrFile)};
+        Job.Res = Commands[I]->Execute(JobRedirects, &Job.Error,
+                                       &Job.ExecutionFailed);
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Done.push_back(I);
+        Cond.notify_one();
+      });
+    }
+
+    // Replay the output of the jobs in order, up to the first one that is not
+    // done yet.
+    while (NextToReplay != NumJobs &&
+           (State[NextToReplay].State == ParallelJob::Finished ||
+            State[NextToReplay].State == ParallelJob::Skipped)) {
+      ParallelJob &Job = State[NextToReplay++];
+      llvm::errs() << Job.Prefix;
+      replayOutput(Job.OutFile, llvm::outs());
+      replayOutput(Job.ErrFile, llvm::errs());
+      if (!Job.Error.empty()) {
+        assert(Job.Res && "Error string set with 0 result code!");
+        getDriver().Diag(diag::err_drv_command_failure) << Job.Error;
+      }
+    }
+    if (NextToReplay == NumJobs)
+      break;
+
+    // Wait for a running job to finish.
+    assert(NumRunning && "no job can make progress");
+    std::vector<size_t> Finished;
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      Cond.wait(Lock, [&] { return !Done.empty(); });
+      Finished.swap(Done);
+    }
+    for (size_t I : Finished) {
+      ParallelJob &Job = State[I];
+      Job.State = ParallelJob::Finished;
+      --NumRunning;
+      int Res = Job.ExecutionFailed ? 1 : Job.Res;
+      if (Res) {
+        FailedSoFar.push_back(std::make_pair(Res, Commands[I]));
+        Failures.push_back(std::make_pair(I, FailedSoFar.back()));
+      }
+    }
+  }
+  Pool.wait();
+
+  llvm::sort(Failures, [](const IndexedFailure &A, const IndexedFailure &B) {
+    return A.first < B.first;
+  });
+  for (const auto &F : Failures)
+    FailingCommands.push_back(F.second);
+}
+
 void Compilation::ExecuteJobs(const JobList &Jobs,
                               FailingCommandList &FailingCommands) const {
+  // Run the independent jobs in parallel if requested. The output of the
+  // commands is already redirected when generating crash diagnostics, and the
+  // cl driver mode stops at the first failure, so both run serially.
+  if (Arg *A = getArgs().getLastArg(options::OPT_parallel_jobs_EQ)) {
+    unsigned NumThreads;
+    if (StringRef(A->getValue()).getAsInteger(10, NumThreads))
+      getDriver().Diag(diag::err_drv_invalid_int_value)
+          << A->getAsString(getArgs()) << A->getValue();
+    else {
+      if (NumThreads == 0)
+        NumThreads = llvm::hardware_concurrency();
+      if (NumThreads > 1 && Jobs.size() > 1 && Redirects.empty() &&
+          !TheDriver.IsCLMode())
+        return ExecuteJobsInParallel(Jobs, FailingCommands, NumThreads);
+    }
+  }
+
   // According to UNIX standard, driver need to continue compiling all the
   // inputs on the command line even one of them failed.
   // In all but CLMode, execute all the jobs unless the necessary inputs for the
@@ -3447,6 +3447,11 @@ void Driver::BuildActions(Compilation &C, DerivedArgList &Args,
   // to non-CUDA compilations and should not trigger warnings there.
   Args.ClaimAllArgs(options::OPT_cuda_host_only);
   Args.ClaimAllArgs(options::OPT_cuda_compile_host_device);
+
+  // Claim -f[no-]integrated-cc1, which only matter when there is a compile
+  // job and should not trigger warnings otherwise.
+  Args.ClaimAllArgs(options::OPT_fintegrated_cc1);
+  Args.ClaimAllArgs(options::OPT_fno_integrated_cc1);
 }
 
 Action *Driver::ConstructPhaseAction(
@@ -3600,6 +3605,15 @@ void Driver::BuildJobs(Compilation &C) const {
                        /*TargetDeviceOffloadKind*/ Action::OFK_None);
   }
 
+  // The frontend leaks memory and global state on purpose, so only the
+  // compilations with a single job run it in-process.
+  if (C.getJobs().size() > 1)
+    for (auto &J : C.getJobs())
+      J.InProcess = false;
+
+  // -parallel-jobs= is read when the jobs are executed.
+  C.getArgs().ClaimAllArgs(options::OPT_parallel_jobs_EQ);
+
   // If the user passed -Qunused-arguments or there were errors, don't warn
   // about any unused arguments.
   if (Diags.hasErrorOccurred() ||
@@ -1246,6 +1246,7 @@ void Clang::AddPreprocessingOptions(Compilation &C, const JobAction &JA,
   Args.AddAllArgs(CmdArgs,
                   {options::OPT_D, options::OPT_U, options::OPT_I_Group,
                    options::OPT_F, options::OPT_index_header_map});
+  Args.AddLastArg(CmdArgs, options::OPT_fheader_lookup_cache_path_EQ);
 
   // Add -Wp, and -Xpreprocessor if using the preprocessor.
 
@@ -4378,6 +4379,20 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   if (std::binary_search(wasmFeatures.begin(), wasmFeatures.end(), cheerp::ANYREF)) {
     CmdArgs.push_back("-cheerp-wasm-externref");
   }
+  // Pass cheerp-wasm-return-calls if returncalls feature enabled, it is needed
+  // to check guaranteed tail calls
+  if (std::binary_search(wasmFeatures.begin(), wasmFeatures.end(), cheerp::RETURNCALLS)) {
+    CmdArgs.push_back("-cheerp-wasm-return-calls");
+  }
+  // Forward cheerp-cached-closures argument
+  Args.AddLastArg(CmdArgs, options::OPT_cheerp_cached_closures);
+  // Forward cheerp-dual-section-functions argument
+  Args.AddLastArg(CmdArgs, options::OPT_cheerp_dual_section_functions);
+  // Forward cheerp-stable-shapes argument
+  Args.AddLastArg(CmdArgs, options::OPT_cheerp_stable_shapes);
+  // The object shape optimization needs to know how fields are accessed
+  if (Args.hasArg(options::OPT_cheerp_optimize_object_shapes))
+    CmdArgs.push_back("-cheerp-field-access-info");
 
   // GCC's behavior for -Wwrite-strings is a bit strange:
   //  * In C, this "warning flag" changes the types of string literals from
@@ -5500,10 +5515,59 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(Args.MakeArgString(Str));
   }
 
+  // With -fparallel-codegen, the frontend writes the object of each partition
+  // of the module to a temporary file, and a relocatable link combines them.
+  // This needs an ELF object written to a file; otherwise the option is
+  // dropped with a warning.
+  SmallVector<const char *, 4> PartitionOutputs;
+  if (Arg *A = Args.getLastArg(options::OPT_fparallel_codegen_EQ)) {
+    unsigned NumPartitions;
+    if (StringRef(A->getValue()).getAsInteger(10, NumPartitions) ||
+        NumPartitions == 0) {
+      D.Diag(diag::err_drv_invalid_int_value)
+          << A->getAsString(Args) << A->getValue();
+    } else if (NumPartitions == 1 ||
+               !(isa<CompileJobAction>(JA) || isa<BackendJobAction>(JA)) ||
+               (D.isSaveTempsEnabled() && isa<CompileJobAction>(JA) &&
+                Output.getType() == types::TY_LLVM_BC)) {
+      // Nothing to split, or the code is generated by another job.
+    } else if (!Triple.isOSBinFormatELF()) {
+      D.Diag(diag::warn_drv_unsupported_opt_for_target)
+          << A->getAsString(Args) << TC.getTripleString();
+    } else if (Output.getType() != types::TY_Object) {
+      D.Diag(diag::warn_drv_parallel_codegen_ignored)
+          << A->getAsString(Args) << 0;
+    } else if (SplitDWARF) {
+      D.Diag(diag::warn_drv_parallel_codegen_ignored)
+          << A->getAsString(Args) << 1;
+    } else if (!Output.isFilename() ||
+               StringRef(Output.getFilename()) == "-") {
+      D.Diag(diag::warn_drv_parallel_codegen_ignored)
+          << A->getAsString(Args) << 2;
+    } else {
+      CmdArgs.push_back(
+          Args.MakeArgString("-fparallel-codegen=" + Twine(NumPartitions)));
+      StringRef Stem = llvm::sys::path::stem(Output.getFilename());
+      for (unsigned I = 0; I != NumPartitions; ++I) {
+        std::string TmpName =
+            D.GetTemporaryPath((Stem + "-part" + Twine(I)).str(), "o");
+        PartitionOutputs.push_back(
+            C.addTempFile(Args.MakeArgString(TmpName)));
+        if (I != 0) {
+          CmdArgs.push_back("-parallel-codegen-output");
+          CmdArgs.push_back(PartitionOutputs.back());
+        }
+      }
+    }
+  }
+
   // Add the "-o out -x type src.c" flags last. This is done primarily to make
   // the -cc1 command easier to edit when reproducing compiler crashes.
   if (Output.getType() == types::TY_Dependencies) {
     // Handled with other dependency code.
+  } else if (!PartitionOutputs.empty()) {
+    CmdArgs.push_back("-o");
+    CmdArgs.push_back(PartitionOutputs.front());
   } else if (Output.isFilename()) {
     CmdArgs.push_back("-o");
     CmdArgs.push_back(Output.getFilename());
@@ -5540,6 +5604,12 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     // fails, so that the main compilation's fallback to cl.exe runs.
     C.addCommand(llvm::make_unique<ForceSuccessCommand>(JA, *this, Exec,
                                                         CmdArgs, Inputs));
+  } else if (Args.hasFlag(options::OPT_fintegrated_cc1,
+                          options::OPT_fno_integrated_cc1, false) &&
+             D.CC1Main && !D.CCGenDiagnostics) {
+    // Run the frontend in the driver process.
+    C.addCommand(
+        llvm::make_unique<CC1Command>(JA, *this, Exec, CmdArgs, Inputs));
   } else {
     C.addCommand(llvm::make_unique<Command>(JA, *this, Exec, CmdArgs, Inputs));
   }
@@ -5551,6 +5621,19 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     C.getJobs().getJobs().back()->setPrintInputFilenames(true);
   }
 
+  // Combine the objects of the partitions, in order.
+  if (!PartitionOutputs.empty()) {
+    ArgStringList LinkArgs;
+    LinkArgs.push_back("-r");
+    LinkArgs.push_back("-o");
+    LinkArgs.push_back(Output.getFilename());
+    LinkArgs.append(PartitionOutputs.begin(), PartitionOutputs.end());
+    InputInfo II(types::TY_Object, PartitionOutputs.front(),
+                 PartitionOutputs.front());
+    C.addCommand(llvm::make_unique<Command>(
+        JA, *this, Args.MakeArgString(TC.GetLinkerPath()), LinkArgs, II));
+  }
+
   if (Arg *A = Args.getLastArg(options::OPT_pg))
     if (FPKeepKind == CodeGenOptions::FramePointerKind::None)
       D.Diag(diag::err_drv_argument_not_allowed_with) << "-fomit-frame-pointer"
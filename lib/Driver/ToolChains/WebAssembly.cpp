@@ -378,6 +378,11 @@ void cheerp::CheerpOptimizer::ConstructJob(Compilation &C, const JobAction &JA,
     cheerpFixFuncCasts->render(Args, CmdArgs);
   if(Arg* cheerpUseBigInts = Args.getLastArg(options::OPT_cheerp_use_bigints))
     cheerpUseBigInts->render(Args, CmdArgs);
+  // The pass consuming the field access information is not part of the
+  // Cheerp optimizer yet, which would reject the option
+  if(Arg* cheerpOptimizeObjectShapes = Args.getLastArg(options::OPT_cheerp_optimize_object_shapes))
+    D.Diag(diag::warn_drv_cheerp_object_shapes_unavailable)
+        << cheerpOptimizeObjectShapes->getAsString(Args);
 
   if(Arg* cheerpLinearOutput = Args.getLastArg(options::OPT_cheerp_linear_output_EQ))
     cheerpLinearOutput->render(Args, CmdArgs);
@@ -80,6 +80,8 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/DJB.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
@@ -1020,6 +1022,10 @@ public:
 
   std::vector<Decl *> takeTopLevelDecls() { return std::move(TopLevelDecls); }
 
+  ArrayRef<serialization::DeclID> getTopLevelDeclIDs() const {
+    return TopLevelDeclIDs;
+  }
+
   std::vector<serialization::DeclID> takeTopLevelDeclIDs() {
     return std::move(TopLevelDeclIDs);
   }
@@ -1060,6 +1066,40 @@ private:
 
 } // namespace
 
+/// Encode what ASTUnitPreambleCallbacks collected while building a preamble,
+/// to be stored along with it in a PreambleStore.
+static std::string
+encodePreambleClientData(unsigned TopLevelHash,
+                         ArrayRef<serialization::DeclID> TopLevelDeclIDs) {
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  llvm::support::endian::Writer Writer(OS, llvm::support::little);
+  Writer.write<uint32_t>(TopLevelHash);
+  Writer.write<uint32_t>(TopLevelDeclIDs.size());
+  for (serialization::DeclID ID : TopLevelDeclIDs)
+    Writer.write<uint32_t>(ID);
+  return OS.str();
+}
+
+static bool
+decodePreambleClientData(StringRef Data, unsigned &TopLevelHash,
+                         std::vector<serialization::DeclID> &TopLevelDeclIDs) {
+  using namespace llvm::support;
+  if (Data.size() < 2 * sizeof(uint32_t))
+    return false;
+  const unsigned char *Ptr = Data.bytes_begin();
+  TopLevelHash = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  uint32_t NumDecls = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if (Data.size() != (2 + uint64_t(NumDecls)) * sizeof(uint32_t))
+    return false;
+  TopLevelDeclIDs.clear();
+  TopLevelDeclIDs.reserve(NumDecls);
+  for (; NumDecls; --NumDecls)
+    TopLevelDeclIDs.push_back(
+        endian::readNext<uint32_t, little, unaligned>(Ptr));
+  return true;
+}
+
 static bool isNonDriverDiag(const StoredDiagnostic &StoredDiag) {
   return StoredDiag.getLocation().isValid();
 }
@@ -1339,6 +1379,13 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     }
   }
 
+  // Loading a preamble that another translation unit or process built is
+  // cheap, so it is tried even when we are not ready to build one ourselves.
+  if (SharedPreambles && loadPreambleFromStore(PreambleInvocationIn,
+                                               MainFileBuffer.get(), Bounds,
+                                               *VFS))
+    return MainFileBuffer;
+
   // If the preamble rebuild counter > 1, it's because we previously
   // failed to build a preamble and we're not yet ready to try
   // again. Decrement the counter and return a failure.
@@ -1377,6 +1424,16 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
         PreambleInvocationIn, MainFileBuffer.get(), Bounds, *Diagnostics, VFS,
         PCHContainerOps, /*StoreInMemory=*/false, Callbacks);
 
+    // The diagnostics emitted while building a preamble are not stored along
+    // with it, so only preambles built without any are shared. Failing to
+    // publish the preamble is not an error, it is still used here.
+    if (NewPreamble && SharedPreambles && NewPreambleDiags.empty() &&
+        !Diagnostics->hasErrorOccurred() && !Diagnostics->getNumWarnings())
+      NewPreamble->Publish(*SharedPreambles, PreambleInvocationIn, *VFS,
+                           encodePreambleClientData(
+                               Callbacks.getHash(),
+                               Callbacks.getTopLevelDeclIDs()));
+
     PreambleInvocationIn.getFrontendOpts().SkipFunctionBodies =
         PreviousSkipFunctionBodies;
 
@@ -1424,6 +1481,54 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   return MainFileBuffer;
 }
 
+bool ASTUnit::loadPreambleFromStore(CompilerInvocation &PreambleInvocationIn,
+                                    const llvm::MemoryBuffer *MainFileBuffer,
+                                    PreambleBounds Bounds,
+                                    llvm::vfs::FileSystem &VFS) {
+  // Preambles are stored under the options they were built with.
+  const bool PreviousSkipFunctionBodies =
+      PreambleInvocationIn.getFrontendOpts().SkipFunctionBodies;
+  if (SkipFunctionBodies == SkipFunctionBodiesScope::Preamble)
+    PreambleInvocationIn.getFrontendOpts().SkipFunctionBodies = true;
+
+  std::string ClientData;
+  llvm::Optional<PrecompiledPreamble> StoredPreamble =
+      PrecompiledPreamble::LoadFromStore(*SharedPreambles,
+                                         PreambleInvocationIn, MainFileBuffer,
+                                         Bounds, VFS, &ClientData);
+
+  PreambleInvocationIn.getFrontendOpts().SkipFunctionBodies =
+      PreviousSkipFunctionBodies;
+
+  unsigned TopLevelHash;
+  std::vector<serialization::DeclID> TopLevelDeclIDs;
+  if (!StoredPreamble ||
+      !decodePreambleClientData(ClientData, TopLevelHash, TopLevelDeclIDs))
+    return false;
+
+  Preamble = std::move(*StoredPreamble);
+  PreambleRebuildCountdown = 1;
+
+  TopLevelDecls.clear();
+  TopLevelDeclsInPreamble = std::move(TopLevelDeclIDs);
+  PreambleTopLevelHashValue = TopLevelHash;
+
+  // Only preambles built without diagnostics are stored. Set the state of the
+  // diagnostic object to mimic its state after parsing such a preamble.
+  getDiagnostics().Reset();
+  ProcessWarningOptions(getDiagnostics(),
+                        PreambleInvocationIn.getDiagnosticOpts());
+  NumWarningsInPreamble = 0;
+  checkAndRemoveNonDriverDiags(StoredDiagnostics);
+  PreambleDiagnostics.clear();
+
+  if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
+    CompletionCacheTopLevelHashValue = 0;
+    PreambleTopLevelHashValue = CurrentTopLevelHashValue;
+  }
+  return true;
+}
+
 void ASTUnit::RealizeTopLevelDeclsFromPreamble() {
   assert(Preamble && "Should only be called when preamble was built");
 
@@ -1694,7 +1799,7 @@ std::unique_ptr<ASTUnit> ASTUnit::LoadFromCompilerInvocation(
     bool OnlyLocalDecls, CaptureDiagsKind CaptureDiagnostics,
     unsigned PrecompilePreambleAfterNParses, TranslationUnitKind TUKind,
     bool CacheCodeCompletionResults, bool IncludeBriefCommentsInCodeCompletion,
-    bool UserFilesAreVolatile) {
+    bool UserFilesAreVolatile, std::shared_ptr<PreambleStore> Preambles) {
   // Create the AST unit.
   std::unique_ptr<ASTUnit> AST(new ASTUnit(false));
   ConfigureDiags(Diags, *AST, CaptureDiagnostics);
@@ -1709,6 +1814,7 @@ std::unique_ptr<ASTUnit> ASTUnit::LoadFromCompilerInvocation(
   AST->FileSystemOpts = FileMgr->getFileSystemOpts();
   AST->FileMgr = FileMgr;
   AST->UserFilesAreVolatile = UserFilesAreVolatile;
+  AST->SharedPreambles = std::move(Preambles);
 
   // Recover resources if we crash before exiting this method.
   llvm::CrashRecoveryContextCleanupRegistrar<ASTUnit>
@@ -1735,7 +1841,8 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
     bool AllowPCHWithCompilerErrors, SkipFunctionBodiesScope SkipFunctionBodies,
     bool SingleFileParse, bool UserFilesAreVolatile, bool ForSerialization,
     llvm::Optional<StringRef> ModuleFormat, std::unique_ptr<ASTUnit> *ErrAST,
-    IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS) {
+    IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS,
+    std::shared_ptr<PreambleStore> Preambles) {
   assert(Diags.get() && "no DiagnosticsEngine was provided");
 
   SmallVector<StoredDiagnostic, 4> StoredDiagnostics;
@@ -1793,6 +1900,7 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
   AST->UserFilesAreVolatile = UserFilesAreVolatile;
   AST->Invocation = CI;
   AST->SkipFunctionBodies = SkipFunctionBodies;
+  AST->SharedPreambles = std::move(Preambles);
   if (ForSerialization)
     AST->WriterData.reset(new ASTWriterData(*AST->ModuleCache));
   // Zero out now to ease cleanup during crash recovery.
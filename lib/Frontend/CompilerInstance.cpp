@@ -13,6 +13,7 @@
 #include "clang/Basic/CharInfo.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/Stack.h"
 #include "clang/Basic/TargetInfo.h"
@@ -637,12 +638,29 @@ void CompilerInstance::clearOutputFiles(bool EraseFiles) {
         // If '-working-directory' was passed, the output filename should be
         // relative to that.
         FileMgr->FixupRelativePath(NewOutFile);
+
+        // Replace the in-memory copy of a module built by this instance with
+        // a read-only mapping of the file, which shares its pages with the
+        // other processes importing the module. The temporary file is mapped
+        // before it is renamed, so the mapping has the contents written here
+        // even if another process replaces the module file in the meantime.
+        if (getModuleCache().isPCMWritten(OF.Filename)) {
+          llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Mapped =
+              llvm::MemoryBuffer::getFile(OF.TempFilename, /*FileSize=*/-1,
+                                          /*RequiresNullTerminator=*/false);
+          if (Mapped)
+            getModuleCache().replaceWrittenPCM(OF.Filename, std::move(*Mapped));
+        }
+
         if (std::error_code ec =
                 llvm::sys::fs::rename(OF.TempFilename, NewOutFile)) {
           getDiagnostics().Report(diag::err_unable_to_rename_temp)
             << OF.TempFilename << OF.Filename << ec.message();
 
           llvm::sys::fs::remove(OF.TempFilename);
+        } else if (SharedFileSystemCache *Cache = FileMgr->getSharedCache()) {
+          // Other threads must not keep using the stat of the file replaced.
+          Cache->invalidate(NewOutFile);
         }
       }
     } else if (!OF.Filename.empty() && EraseFiles)
@@ -957,6 +957,25 @@ static bool ParseCodeGenArgs(CodeGenOptions &Opts, ArgList &Args, InputKind IK,
 
   Opts.ThinLinkBitcodeFile = Args.getLastArgValue(OPT_fthin_link_bitcode_EQ);
 
+  if (Arg *A = Args.getLastArg(OPT_fparallel_codegen_EQ)) {
+    Opts.ParallelCodeGen = getLastArgIntValue(Args, OPT_fparallel_codegen_EQ,
+                                              1, Diags);
+    Opts.ParallelCodeGenOutputs =
+        Args.getAllArgValues(OPT_parallel_codegen_output);
+    if (Opts.ParallelCodeGen == 0) {
+      Diags.Report(diag::err_drv_invalid_int_value)
+          << A->getAsString(Args) << A->getValue();
+      Opts.ParallelCodeGen = 1;
+    } else if (Opts.ParallelCodeGenOutputs.size() !=
+               Opts.ParallelCodeGen - 1) {
+      Diags.Report(diag::err_drv_parallel_codegen_outputs)
+          << A->getAsString(Args) << Opts.ParallelCodeGen - 1;
+    } else if (Opts.ParallelCodeGen > 1 && !Opts.SplitDwarfOutput.empty()) {
+      Diags.Report(diag::err_drv_argument_not_allowed_with)
+          << A->getAsString(Args) << "-split-dwarf-output";
+    }
+  }
+
   Opts.MSVolatile = Args.hasArg(OPT_fms_volatile);
 
   Opts.VectorizeLoop = Args.hasArg(OPT_vectorize_loops);
@@ -2012,6 +2031,8 @@ static void ParseHeaderSearchArgs(HeaderSearchOptions &Opts, ArgList &Args,
   Opts.ModuleCachePath = P.str();
 
   Opts.ModuleUserBuildPath = Args.getLastArgValue(OPT_fmodules_user_build_path);
+  Opts.HeaderLookupCachePath =
+      Args.getLastArgValue(OPT_fheader_lookup_cache_path_EQ);
   // Only the -fmodule-file=<name>=<file> form.
   for (const auto *A : Args.filtered(OPT_fmodule_file)) {
     StringRef Val = A->getValue();
@@ -2022,6 +2043,10 @@ static void ParseHeaderSearchArgs(HeaderSearchOptions &Opts, ArgList &Args,
     Opts.AddPrebuiltModulePath(A->getValue());
   Opts.DisableModuleHash = Args.hasArg(OPT_fdisable_module_hash);
   Opts.ModulesHashContent = Args.hasArg(OPT_fmodules_hash_content);
+  Opts.ModulesCompressLookupTables =
+      Args.hasArg(OPT_fmodules_compress_lookup_tables);
+  Opts.ModulesCompressDeclsAndTypes =
+      Args.hasArg(OPT_fmodules_compress_decls_and_types);
   Opts.ModulesValidateDiagnosticOptions =
       !Args.hasArg(OPT_fmodules_disable_diagnostic_validation);
   Opts.ImplicitModuleMaps = Args.hasArg(OPT_fimplicit_module_maps);
@@ -2406,6 +2431,16 @@ static void ParseCheerpArgs(LangOptions &Opts, ArgList &Args,
   if (const Arg *A = Args.getLastArg(OPT_cheerp_wasm_anyref)) {
     Opts.CheerpAnyref = 1;
   }
+  if (Args.hasArg(OPT_cheerp_wasm_return_calls))
+    Opts.CheerpWasmReturnCalls = 1;
+  if (Args.hasArg(OPT_cheerp_cached_closures))
+    Opts.CheerpCachedClosures = 1;
+  if (Args.hasArg(OPT_cheerp_field_access_info))
+    Opts.CheerpFieldAccessInfo = 1;
+  if (Args.hasArg(OPT_cheerp_dual_section_functions))
+    Opts.CheerpDualSectionFunctions = 1;
+  if (Args.hasArg(OPT_cheerp_stable_shapes))
+    Opts.CheerpStableShapes = 1;
 
 }
 
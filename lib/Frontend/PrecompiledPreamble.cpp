@@ -25,11 +25,17 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
 #include <limits>
 #include <utility>
 
@@ -217,6 +223,90 @@ PrecompilePreambleAction::CreateASTConsumer(CompilerInstance &CI,
       *this, CI.getPreprocessor(), CI.getModuleCache(), Sysroot, std::move(OS));
 }
 
+/// Preamble store entries start with this signature, followed by the version of
+/// the entry format.
+const char PreambleStoreSignature[] = {'C', 'L', 'P', 'R', 'E', 'A', 'M', 'B'};
+const uint32_t PreambleStoreVersion = 1;
+
+/// Temporary files older than this are left behind by processes that crashed
+/// while publishing a preamble.
+const std::chrono::hours StalePreambleStoreTempFileAge(1);
+
+/// Compute the key of the preamble \p PreambleText for \p Invocation in a
+/// preamble store. The module hash covers most of the options that change how
+/// the headers in the preamble are parsed; the others are the options that the
+/// module hash leaves out because modules are validated in other ways.
+std::string getPreambleStoreKey(const CompilerInvocation &Invocation,
+                                StringRef PreambleText,
+                                bool PreambleEndsAtStartOfLine,
+                                llvm::vfs::FileSystem &VFS) {
+  llvm::MD5 Hash;
+  // Every string is prefixed with its length, so that different lists of
+  // strings never hash the same.
+  auto AddString = [&Hash](StringRef Str) {
+    uint8_t Size[sizeof(uint64_t)];
+    llvm::support::endian::write64le(Size, Str.size());
+    Hash.update(Size);
+    Hash.update(Str);
+  };
+  auto AddFlag = [&AddString](bool Flag) { AddString(Flag ? "1" : "0"); };
+
+  AddString(Invocation.getModuleHash());
+
+  const FrontendOptions &FrontendOpts = Invocation.getFrontendOpts();
+  AddString(FrontendOpts.Inputs[0].getFile());
+  AddFlag(FrontendOpts.SkipFunctionBodies);
+  AddFlag(FrontendOpts.RelocatablePCH);
+
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  for (const auto &Macro : PPOpts.Macros) {
+    AddString(Macro.first);
+    AddFlag(Macro.second);
+  }
+  for (const std::string &Include : PPOpts.Includes)
+    AddString(Include);
+  for (const std::string &Include : PPOpts.MacroIncludes)
+    AddString(Include);
+  AddString(PPOpts.ImplicitPCHInclude);
+
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  for (const HeaderSearchOptions::Entry &Entry : HSOpts.UserEntries) {
+    AddString(Entry.Path);
+    AddString(llvm::utostr(Entry.Group));
+    AddFlag(Entry.IsFramework);
+    AddFlag(Entry.IgnoreSysRoot);
+  }
+  for (const HeaderSearchOptions::SystemHeaderPrefix &Prefix :
+       HSOpts.SystemHeaderPrefixes) {
+    AddString(Prefix.Prefix);
+    AddFlag(Prefix.IsSystemHeader);
+  }
+
+  const DiagnosticOptions &DiagOpts = Invocation.getDiagnosticOpts();
+  for (const std::string &Warning : DiagOpts.Warnings)
+    AddString(Warning);
+  for (const std::string &Remark : DiagOpts.Remarks)
+    AddString(Remark);
+
+  AddString(Invocation.getFileSystemOpts().WorkingDir);
+  if (llvm::ErrorOr<std::string> CWD = VFS.getCurrentWorkingDirectory())
+    AddString(*CWD);
+
+  AddString(PreambleText);
+  AddFlag(PreambleEndsAtStartOfLine);
+
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().str();
+}
+
+std::string getPreambleStoreEntryPath(const PreambleStore &Store,
+                                      StringRef Key) {
+  SmallString<256> Path(Store.getDirectory());
+  llvm::sys::path::append(Path, Key + ".preamble");
+  return Path.str();
+}
+
 template <class T> bool moveOnNoError(llvm::ErrorOr<T> Val, T &Output) {
   if (!Val)
     return false;
@@ -232,6 +322,57 @@ PreambleBounds clang::ComputePreambleBounds(const LangOptions &LangOpts,
   return Lexer::ComputePreamble(Buffer->getBuffer(), LangOpts, MaxLines);
 }
 
+PreambleStore::PreambleStore(StringRef Directory, uint64_t SizeLimit)
+    : Directory(Directory), SizeLimit(SizeLimit) {}
+
+void PreambleStore::collectGarbage() {
+  struct StoreEntry {
+    std::string Path;
+    uint64_t Size;
+    llvm::sys::TimePoint<> LastUse;
+  };
+  std::vector<StoreEntry> Entries;
+  uint64_t TotalSize = 0;
+  llvm::sys::TimePoint<> Now = std::chrono::system_clock::now();
+
+  // Errors are ignored: another process may be collecting garbage, or
+  // publishing and loading preambles, at the same time.
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator File(Directory, EC), End;
+       File != End && !EC; File.increment(EC)) {
+    StringRef Extension = llvm::sys::path::extension(File->path());
+    if (Extension != ".preamble" && Extension != ".tmp")
+      continue;
+    llvm::ErrorOr<llvm::sys::fs::basic_file_status> Status = File->status();
+    if (!Status)
+      continue;
+    // Reusing a preamble updates its modification time, access times are not
+    // reliable on relatime and noatime mounts.
+    llvm::sys::TimePoint<> LastUse = Status->getLastModificationTime();
+    if (Extension == ".tmp") {
+      if (Now - LastUse > StalePreambleStoreTempFileAge)
+        llvm::sys::fs::remove(File->path());
+      continue;
+    }
+    Entries.push_back({File->path(), Status->getSize(), LastUse});
+    TotalSize += Status->getSize();
+  }
+
+  if (!SizeLimit || TotalSize <= SizeLimit)
+    return;
+
+  // Remove the least recently used preambles first.
+  llvm::sort(Entries, [](const StoreEntry &LHS, const StoreEntry &RHS) {
+    return LHS.LastUse < RHS.LastUse;
+  });
+  for (const StoreEntry &Entry : Entries) {
+    if (TotalSize <= SizeLimit)
+      break;
+    if (!llvm::sys::fs::remove(Entry.Path))
+      TotalSize -= Entry.Size;
+  }
+}
+
 llvm::ErrorOr<PrecompiledPreamble> PrecompiledPreamble::Build(
     const CompilerInvocation &Invocation,
     const llvm::MemoryBuffer *MainFileBuffer, PreambleBounds Bounds,
@@ -388,6 +529,185 @@ llvm::ErrorOr<PrecompiledPreamble> PrecompiledPreamble::Build(
                              std::move(FilesInPreamble));
 }
 
+llvm::Optional<PrecompiledPreamble> PrecompiledPreamble::LoadFromStore(
+    PreambleStore &Store, const CompilerInvocation &Invocation,
+    const llvm::MemoryBuffer *MainFileBuffer, PreambleBounds Bounds,
+    llvm::vfs::FileSystem &VFS, std::string *ClientData) {
+  using namespace llvm::support;
+
+  assert(
+      Bounds.Size <= MainFileBuffer->getBufferSize() &&
+      "Buffer is too large. Bounds were calculated from a different buffer?");
+  StringRef PreambleText = MainFileBuffer->getBuffer().take_front(Bounds.Size);
+  std::string EntryPath = getPreambleStoreEntryPath(
+      Store, getPreambleStoreKey(Invocation, PreambleText,
+                                 Bounds.PreambleEndsAtStartOfLine, VFS));
+
+  // Other processes may replace or remove the entry at any time, but the
+  // mapping keeps the contents we read alive.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Entry =
+      llvm::MemoryBuffer::getFile(EntryPath, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!Entry)
+    return None;
+
+  const unsigned char *Start = (*Entry)->getBuffer().bytes_begin();
+  const unsigned char *Ptr = Start;
+  const unsigned char *End = (*Entry)->getBuffer().bytes_end();
+  auto HasBytes = [&](uint64_t Size) { return uint64_t(End - Ptr) >= Size; };
+
+  if (!HasBytes(sizeof(PreambleStoreSignature) + 2 * sizeof(uint32_t)) ||
+      memcmp(Ptr, PreambleStoreSignature, sizeof(PreambleStoreSignature)))
+    return None;
+  Ptr += sizeof(PreambleStoreSignature);
+  if (endian::readNext<uint32_t, little, unaligned>(Ptr) !=
+      PreambleStoreVersion)
+    return None;
+
+  llvm::StringMap<PreambleFileHash> FilesInPreamble;
+  for (uint32_t NumFiles = endian::readNext<uint32_t, little, unaligned>(Ptr);
+       NumFiles; --NumFiles) {
+    if (!HasBytes(sizeof(uint32_t)))
+      return None;
+    uint32_t NameSize = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    PreambleFileHash Hash;
+    if (!HasBytes(uint64_t(NameSize) + 2 * sizeof(int64_t) +
+                  Hash.MD5.Bytes.size()))
+      return None;
+    StringRef Name(reinterpret_cast<const char *>(Ptr), NameSize);
+    Ptr += NameSize;
+    Hash.Size = endian::readNext<int64_t, little, unaligned>(Ptr);
+    Hash.ModTime = endian::readNext<int64_t, little, unaligned>(Ptr);
+    std::copy(Ptr, Ptr + Hash.MD5.Bytes.size(), Hash.MD5.Bytes.begin());
+    Ptr += Hash.MD5.Bytes.size();
+    FilesInPreamble[Name] = Hash;
+  }
+
+  if (!HasBytes(sizeof(uint32_t)))
+    return None;
+  uint32_t ClientDataSize = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if (!HasBytes(uint64_t(ClientDataSize) + sizeof(uint64_t)))
+    return None;
+  StringRef StoredClientData(reinterpret_cast<const char *>(Ptr),
+                             ClientDataSize);
+  Ptr += ClientDataSize;
+
+  uint64_t PCHSize = endian::readNext<uint64_t, little, unaligned>(Ptr);
+  uint64_t Padding = llvm::alignTo(Ptr - Start, 8) - (Ptr - Start);
+  if (!HasBytes(Padding))
+    return None;
+  Ptr += Padding;
+  // The PCH is followed by a null terminator, which the FileManager requires.
+  if (uint64_t(End - Ptr) <= PCHSize || Ptr[PCHSize] != '\0')
+    return None;
+
+  StoredPreamble Stored;
+  Stored.PCH = StringRef(reinterpret_cast<const char *>(Ptr), PCHSize);
+  Stored.Entry = std::move(*Entry);
+  PrecompiledPreamble Preamble(
+      std::move(Stored),
+      std::vector<char>(PreambleText.begin(), PreambleText.end()),
+      Bounds.PreambleEndsAtStartOfLine, std::move(FilesInPreamble));
+  if (!Preamble.CanReuse(Invocation, MainFileBuffer, Bounds, &VFS))
+    return None;
+
+  // Mark the entry as recently used for collectGarbage. This is best effort:
+  // the entry may have been replaced or removed in the meantime.
+  int FD;
+  if (!llvm::sys::fs::openFileForRead(EntryPath, FD)) {
+    llvm::sys::TimePoint<> Now = std::chrono::system_clock::now();
+    llvm::sys::fs::setLastAccessAndModificationTime(FD, Now, Now);
+    llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+
+  if (ClientData)
+    *ClientData = StoredClientData;
+  return std::move(Preamble);
+}
+
+std::error_code PrecompiledPreamble::Publish(
+    PreambleStore &Store, const CompilerInvocation &Invocation,
+    llvm::vfs::FileSystem &VFS, StringRef ClientData) const {
+  std::unique_ptr<llvm::MemoryBuffer> PCHFile;
+  StringRef PCH;
+  switch (Storage.getKind()) {
+  case PCHStorage::Kind::Empty:
+    assert(false && "Calling Publish() on invalid PrecompiledPreamble. "
+                    "Was it std::moved?");
+    return std::make_error_code(std::errc::invalid_argument);
+  case PCHStorage::Kind::Stored:
+    // The preamble was loaded from a store, there is nothing to publish.
+    return std::error_code();
+  case PCHStorage::Kind::InMemory:
+    PCH = Storage.asMemory().Data;
+    break;
+  case PCHStorage::Kind::TempFile: {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+        llvm::MemoryBuffer::getFile(Storage.asFile().getFilePath());
+    if (!Buffer)
+      return Buffer.getError();
+    PCHFile = std::move(*Buffer);
+    PCH = PCHFile->getBuffer();
+    break;
+  }
+  }
+
+  std::string Key = getPreambleStoreKey(
+      Invocation, StringRef(PreambleBytes.data(), PreambleBytes.size()),
+      PreambleEndsAtStartOfLine, VFS);
+  if (std::error_code EC =
+          llvm::sys::fs::create_directories(Store.getDirectory()))
+    return EC;
+
+  // Write the entry to a temporary file and rename it into place, so that
+  // other processes never see a partially written entry.
+  SmallString<256> TempPath(Store.getDirectory());
+  llvm::sys::path::append(TempPath, Key + "-%%%%%%%%.tmp");
+  int FD;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueFile(TempPath, FD, TempPath))
+    return EC;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    llvm::support::endian::Writer Writer(OS, llvm::support::little);
+    OS.write(PreambleStoreSignature, sizeof(PreambleStoreSignature));
+    Writer.write<uint32_t>(PreambleStoreVersion);
+    Writer.write<uint32_t>(FilesInPreamble.size());
+    for (const auto &F : FilesInPreamble) {
+      Writer.write<uint32_t>(F.first().size());
+      OS << F.first();
+      Writer.write<int64_t>(F.second.Size);
+      Writer.write<int64_t>(F.second.ModTime);
+      OS.write(reinterpret_cast<const char *>(F.second.MD5.Bytes.data()),
+               F.second.MD5.Bytes.size());
+    }
+    Writer.write<uint32_t>(ClientData.size());
+    OS << ClientData;
+    Writer.write<uint64_t>(PCH.size());
+    // Align the PCH, so that ASTReader can use it in place.
+    for (uint64_t Padding = llvm::alignTo(OS.tell(), 8) - OS.tell(); Padding;
+         --Padding)
+      OS << '\0';
+    OS << PCH << '\0';
+    OS.close();
+    if (OS.has_error()) {
+      std::error_code EC = OS.error();
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return EC;
+    }
+  }
+
+  if (std::error_code EC = llvm::sys::fs::rename(
+          TempPath, getPreambleStoreEntryPath(Store, Key))) {
+    llvm::sys::fs::remove(TempPath);
+    return EC;
+  }
+
+  Store.collectGarbage();
+  return std::error_code();
+}
+
 PreambleBounds PrecompiledPreamble::getBounds() const {
   return PreambleBounds(PreambleBytes.size(), PreambleEndsAtStartOfLine);
 }
@@ -409,6 +729,8 @@ std::size_t PrecompiledPreamble::getSize() const {
            "file size did not fit into size_t");
     return Result;
   }
+  case PCHStorage::Kind::Stored:
+    return Storage.asStored().PCH.size();
   }
   llvm_unreachable("Unhandled storage kind");
 }
@@ -603,6 +925,11 @@ PrecompiledPreamble::PCHStorage::PCHStorage(InMemoryPreamble Memory)
   new (&asMemory()) InMemoryPreamble(std::move(Memory));
 }
 
+PrecompiledPreamble::PCHStorage::PCHStorage(StoredPreamble Stored)
+    : StorageKind(Kind::Stored) {
+  new (&asStored()) StoredPreamble(std::move(Stored));
+}
+
 PrecompiledPreamble::PCHStorage::PCHStorage(PCHStorage &&Other) : PCHStorage() {
   *this = std::move(Other);
 }
@@ -622,6 +949,9 @@ operator=(PCHStorage &&Other) {
   case Kind::InMemory:
     new (&asMemory()) InMemoryPreamble(std::move(Other.asMemory()));
     break;
+  case Kind::Stored:
+    new (&asStored()) StoredPreamble(std::move(Other.asStored()));
+    break;
   }
 
   Other.setEmpty();
@@ -656,6 +986,17 @@ PrecompiledPreamble::PCHStorage::asMemory() const {
   return const_cast<PCHStorage *>(this)->asMemory();
 }
 
+PrecompiledPreamble::StoredPreamble &
+PrecompiledPreamble::PCHStorage::asStored() {
+  assert(getKind() == Kind::Stored);
+  return *reinterpret_cast<StoredPreamble *>(Storage.buffer);
+}
+
+const PrecompiledPreamble::StoredPreamble &
+PrecompiledPreamble::PCHStorage::asStored() const {
+  return const_cast<PCHStorage *>(this)->asStored();
+}
+
 void PrecompiledPreamble::PCHStorage::destroy() {
   switch (StorageKind) {
   case Kind::Empty:
@@ -666,6 +1007,9 @@ void PrecompiledPreamble::PCHStorage::destroy() {
   case Kind::InMemory:
     asMemory().~InMemoryPreamble();
     return;
+  case Kind::Stored:
+    asStored().~StoredPreamble();
+    return;
   }
 }
 
@@ -744,13 +1088,17 @@ void PrecompiledPreamble::setupPreambleStorage(
     // read files, but the PCH was generated in the real file system.
     VFS = createVFSOverlayForPreamblePCH(PCHPath, std::move(*Buf), VFS);
   } else {
-    assert(Storage.getKind() == PCHStorage::Kind::InMemory);
-    // For in-memory preamble, we have to provide a VFS overlay that makes it
-    // accessible.
+    assert(Storage.getKind() == PCHStorage::Kind::InMemory ||
+           Storage.getKind() == PCHStorage::Kind::Stored);
+    // For in-memory and stored preambles, we have to provide a VFS overlay
+    // that makes them accessible.
     StringRef PCHPath = getInMemoryPreamblePath();
     PreprocessorOpts.ImplicitPCHInclude = PCHPath;
 
-    auto Buf = llvm::MemoryBuffer::getMemBuffer(Storage.asMemory().Data);
+    auto Buf = llvm::MemoryBuffer::getMemBuffer(
+        Storage.getKind() == PCHStorage::Kind::InMemory
+            ? StringRef(Storage.asMemory().Data)
+            : Storage.asStored().PCH);
     VFS = createVFSOverlayForPreamblePCH(PCHPath, std::move(Buf), VFS);
   }
 }
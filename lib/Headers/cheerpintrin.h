@@ -24,6 +24,8 @@
 #ifndef __CHEERPINTRIN_H
 #define __CHEERPINTRIN_H
 
+#include <stddef.h>
+
 namespace [[cheerp::genericjs]] {
 
 template<class R, class P>
@@ -35,7 +37,8 @@ size_t __builtin_cheerp_pointer_offset(const P* ptr);
 template<class P>
 bool __builtin_cheerp_is_linear_heap(const P* ptr);
 /* This method returns a closure. When it is invoked it will execute func with obj as the first argument
-   and its own argument as the second one
+   and its own argument as the second one.
+   With -cheerp-cached-closures the closure is reused when requested again for the same func and obj
 */
 template<class R,class T,class O>
 R* __builtin_cheerp_create_closure(T* func, O* obj);
@@ -54,5 +57,119 @@ int __builtin_cheerp_grow_memory(int bytes);
 void* __buitin_cheerp_stack_save();
 
 void __buitin_cheerp_stack_restore(void*);
+
+template<class T>
+T* __builtin_cheerp_externref_table_get(int index);
+
+template<class T>
+void __builtin_cheerp_externref_table_set(int index, T* obj);
+
+int __builtin_cheerp_externref_table_grow(int delta);
+}
+
+namespace [[cheerp::genericjs]] client {
+class Object;
+}
+
+#ifdef __CHEERP_EXTERNREF__
+namespace cheerp {
+/* The externref table keeps client objects alive in a Wasm table of externref
+   and maps them to compact integer handles, which can be stored in linear
+   memory. The table and its free list are [[cheerp::wasm]] code and data, so
+   no operation crosses into genericjs code. It is only available with
+   -cheerp-wasm-enable=externref.
+*/
+class [[cheerp::wasm]] externref_table {
+public:
+  static int insert(client::Object* obj) {
+    externref_table& t = instance();
+    if (t.freeHead < 0)
+      t.grow();
+    int index = t.freeHead;
+    t.freeHead = t.nextFree[index];
+    t.nextFree[index] = inUse;
+    __builtin_cheerp_externref_table_set(index, obj);
+    return index;
+  }
+  template<class T>
+  static T* get(int index, unsigned generation) {
+    instance().check(index, generation);
+    return __builtin_cheerp_externref_table_get<T>(index);
+  }
+  static void remove(int index, unsigned generation) {
+    externref_table& t = instance();
+    t.check(index, generation);
+    __builtin_cheerp_externref_table_set(index,
+                                         static_cast<client::Object*>(nullptr));
+    /* Handles to the old object do not match the slot anymore */
+    t.generations[index]++;
+    t.nextFree[index] = t.freeHead;
+    t.freeHead = index;
+  }
+  static unsigned generation(int index) {
+    return instance().generations[index];
+  }
+private:
+  /* The nextFree value of the slots holding an object */
+  static const int inUse = -2;
+  /* Free slots are linked through this array, starting from freeHead */
+  int* nextFree = nullptr;
+  /* Incremented every time a slot is freed, to detect stale handles */
+  unsigned* generations = nullptr;
+  int capacity = 0;
+  int freeHead = -1;
+  static externref_table& instance() {
+    static externref_table table;
+    return table;
+  }
+  /* Trap on handles which were already released, or were never inserted */
+  void check(int index, unsigned generation) const {
+    if (index < 0 || index >= capacity || nextFree[index] != inUse ||
+        generations[index] != generation)
+      __builtin_trap();
+  }
+  void grow() {
+    int newCapacity = capacity ? capacity * 2 : 16;
+    if (__builtin_cheerp_externref_table_grow(newCapacity - capacity) != capacity)
+      __builtin_trap();
+    int* newNextFree = new int[newCapacity];
+    unsigned* newGenerations = new unsigned[newCapacity];
+    for (int i = 0; i < capacity; i++) {
+      newNextFree[i] = nextFree[i];
+      newGenerations[i] = generations[i];
+    }
+    for (int i = capacity; i < newCapacity; i++) {
+      newNextFree[i] = i + 1 < newCapacity ? i + 1 : -1;
+      newGenerations[i] = 0;
+    }
+    delete[] nextFree;
+    delete[] generations;
+    nextFree = newNextFree;
+    generations = newGenerations;
+    freeHead = capacity;
+    capacity = newCapacity;
+  }
+};
+
+/* A reference to a client object that can be a member of [[cheerp::wasm]]
+   types. The object stays alive until release() is called, using the handle
+   after that, or releasing it twice, traps.
+*/
+template<class T>
+struct [[cheerp::wasm]] externref_handle {
+  int index;
+  unsigned generation;
+  static externref_handle make(T* obj) {
+    int index = externref_table::insert(obj);
+    return externref_handle{index, externref_table::generation(index)};
+  }
+  T* get() const {
+    return externref_table::get<T>(index, generation);
+  }
+  void release() {
+    externref_table::remove(index, generation);
+  }
+};
 }
+#endif /* __CHEERP_EXTERNREF__ */
 #endif /* __CHEERPINTRIN_H */
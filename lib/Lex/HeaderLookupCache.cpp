@@ -0,0 +1,176 @@
+//===- HeaderLookupCache.cpp - Persistent header lookup results -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the HeaderLookupCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderLookupCache.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Lex/DirectoryLookup.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+/// The first line of a cache file, which changes with its format.
+static const char HeaderLookupCacheSignature[] =
+    "clang-header-lookup-cache 1\n";
+
+HeaderLookupCache::HeaderLookupCache(StringRef CacheDir,
+                                     ArrayRef<DirectoryLookup> SearchDirs,
+                                     unsigned AngledDirIdx,
+                                     unsigned SystemDirIdx,
+                                     FileManager &FileMgr)
+    : NumSearchDirs(SearchDirs.size()) {
+  // The results only depend on the search directories, in order, and on where
+  // the angled and the system ones start.
+  std::string Key;
+  llvm::raw_string_ostream KeyOS(Key);
+  KeyOS << AngledDirIdx << ' ' << SystemDirIdx << '\n';
+  for (const DirectoryLookup &DL : SearchDirs)
+    KeyOS << DL.getLookupType() << ' ' << DL.getDirCharacteristic() << ' '
+          << DL.isIndexHeaderMap() << ' ' << DL.getName() << '\n';
+  llvm::MD5 Hash;
+  Hash.update(KeyOS.str());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+
+  SmallString<128> CachePath(CacheDir);
+  llvm::sys::path::append(CachePath, Result.digest());
+  CachePath += ".hlc";
+  Path = CachePath.str();
+
+  // Adding or removing a header in a directory changes its modification time,
+  // a header map is rewritten when it changes.
+  llvm::raw_string_ostream StampsOS(Stamps);
+  for (const DirectoryLookup &DL : SearchDirs) {
+    llvm::vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(DL.getName(), Status))
+      StampsOS << "-\n";
+    else
+      StampsOS << Status.getLastModificationTime().time_since_epoch().count()
+               << '\n';
+  }
+  StampsOS.flush();
+
+  read();
+}
+
+void HeaderLookupCache::read() {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return;
+
+  // The results of search directories that changed are discarded.
+  StringRef Contents = (*Buffer)->getBuffer();
+  if (!Contents.consume_front(HeaderLookupCacheSignature) ||
+      !Contents.consume_front(Stamps))
+    return;
+
+  while (!Contents.empty()) {
+    StringRef Line, Start, Hit;
+    std::tie(Line, Contents) = Contents.split('\n');
+    std::tie(Start, Line) = Line.split(' ');
+    std::tie(Hit, Line) = Line.split(' ');
+    unsigned StartIdx, HitIdx;
+    if (Start.getAsInteger(10, StartIdx) || Hit.getAsInteger(10, HitIdx) ||
+        StartIdx > HitIdx || HitIdx >= NumSearchDirs || Line.empty())
+      return;
+
+    // Keep the lookups of this compile, which are more recent.
+    auto &Entries = Lookups[Line];
+    if (llvm::none_of(Entries, [&](const std::pair<unsigned, unsigned> &E) {
+          return E.first == StartIdx;
+        }))
+      Entries.push_back({StartIdx, HitIdx});
+  }
+}
+
+Optional<unsigned> HeaderLookupCache::lookup(StringRef Filename,
+                                             unsigned StartIdx) const {
+  auto It = Lookups.find(Filename);
+  if (It == Lookups.end())
+    return None;
+  for (const auto &Entry : It->second)
+    if (Entry.first == StartIdx)
+      return Entry.second;
+  return None;
+}
+
+void HeaderLookupCache::add(StringRef Filename, unsigned StartIdx,
+                            unsigned HitIdx) {
+  // The cache is line based. The stamps only cover the search directories
+  // themselves, so a header with a directory component could be shadowed
+  // without them changing.
+  if (Filename.empty() || Filename.find('\n') != StringRef::npos ||
+      Filename.find_first_of("/\\") != StringRef::npos)
+    return;
+
+  auto &Entries = Lookups[Filename];
+  for (auto &Entry : Entries) {
+    if (Entry.first != StartIdx)
+      continue;
+    if (Entry.second != HitIdx) {
+      Entry.second = HitIdx;
+      Modified = true;
+    }
+    return;
+  }
+  Entries.push_back({StartIdx, HitIdx});
+  Modified = true;
+}
+
+std::error_code HeaderLookupCache::save() {
+  if (!Modified)
+    return std::error_code();
+
+  read();
+
+  StringRef CacheDir = llvm::sys::path::parent_path(Path);
+  if (std::error_code EC = llvm::sys::fs::create_directories(CacheDir))
+    return EC;
+
+  // Write a temporary file and rename it over the cache, so that concurrent
+  // compiles never see a partially written cache.
+  SmallString<128> TempPath(Path);
+  TempPath += "-%%%%%%%%.tmp";
+  int FD;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueFile(TempPath, FD, TempPath))
+    return EC;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << HeaderLookupCacheSignature << Stamps;
+    for (const auto &Entry : Lookups)
+      for (const auto &Lookup : Entry.second)
+        OS << Lookup.first << ' ' << Lookup.second << ' ' << Entry.getKey()
+           << '\n';
+    OS.close();
+    if (OS.has_error()) {
+      std::error_code EC = OS.error();
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return EC;
+    }
+  }
+
+  if (std::error_code EC = llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+    return EC;
+  }
+
+  Modified = false;
+  return std::error_code();
+}
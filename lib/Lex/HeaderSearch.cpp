@@ -25,6 +25,7 @@
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -94,6 +95,25 @@ void HeaderSearch::PrintStats() {
 
   fprintf(stderr, "%d framework lookups.\n", NumFrameworkLookups);
   fprintf(stderr, "%d subframework lookups.\n", NumSubFrameworkLookups);
+  fprintf(stderr, "%d lookups shortened by the persistent lookup cache.\n",
+          NumPersistentLookupCacheHits);
+}
+
+HeaderLookupCache *HeaderSearch::getPersistentLookupCache() {
+  if (!PersistentLookupCacheLoaded) {
+    PersistentLookupCacheLoaded = true;
+    if (!HSOpts->HeaderLookupCachePath.empty())
+      PersistentLookupCache = llvm::make_unique<HeaderLookupCache>(
+          HSOpts->HeaderLookupCachePath, SearchDirs, AngledDirIdx,
+          SystemDirIdx, FileMgr);
+  }
+  return PersistentLookupCache.get();
+}
+
+void HeaderSearch::savePersistentLookupCache() {
+  // The cache is only an optimization, failing to write it is not an error.
+  if (PersistentLookupCache)
+    PersistentLookupCache->save();
 }
 
 /// CreateHeaderMap - This method returns a HeaderMap for the specified
@@ -849,6 +869,24 @@ const FileEntry *HeaderSearch::LookupFile(
     // our search start.  We will fill in our found location below, so prime the
     // start point value.
     CacheLookup.reset(/*StartIdx=*/i+1);
+
+    // Skip the directories in which previous compiles with the same search
+    // directories did not find the file, if it is still where they found it.
+    if (!SkipCache)
+      if (HeaderLookupCache *Persistent = getPersistentLookupCache())
+        if (Optional<unsigned> HitIdx = Persistent->lookup(Filename, i)) {
+          const DirectoryLookup &HitDir = SearchDirs[*HitIdx];
+          SmallString<128> HitPath;
+          if (HitDir.isNormalDir()) {
+            HitPath = HitDir.getDir()->getName();
+            llvm::sys::path::append(HitPath, Filename);
+          }
+          if (!HitPath.empty() &&
+              FileMgr.getFile(HitPath, /*OpenFile=*/false)) {
+            i = *HitIdx;
+            ++NumPersistentLookupCacheHits;
+          }
+        }
   }
 
   SmallString<64> MappedName;
@@ -922,6 +960,11 @@ const FileEntry *HeaderSearch::LookupFile(
 
     // Remember this location for the next lookup we do.
     CacheLookup.HitIdx = i;
+    // Lookups through header maps depend on the name they were mapped to,
+    // and only the hits in normal directories can be checked again.
+    if (!CacheLookup.MappedName && CurDir->isNormalDir())
+      if (HeaderLookupCache *Persistent = getPersistentLookupCache())
+        Persistent->add(Filename, CacheLookup.StartIdx - 1, i);
     return FE;
   }
 
@@ -19,6 +19,7 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TokenKinds.h"
 #include "clang/Lex/LexDiagnostic.h"
+#include "clang/Lex/LexerScanners.h"
 #include "clang/Lex/LiteralSupport.h"
 #include "clang/Lex/MultipleIncludeOpt.h"
 #include "clang/Lex/Preprocessor.h"
@@ -1628,11 +1629,8 @@ bool Lexer::tryConsumeIdentifierUTF8Char(const char *&CurPtr) {
 bool Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr;   // Back up over the skipped character.
+  CurPtr = lexer_scan::skipIdentifierBody(CurPtr, BufferEnd);
+  unsigned char C = *CurPtr;
 
   // Fast path, no $,\,? in identifier found.  '\' might be an escaped newline
   // or UCN, and ? might be a trigraph for '\', an escaped newline or UCN.
@@ -1906,6 +1904,8 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
            ? diag::warn_cxx98_compat_unicode_literal
            : diag::warn_c99_compat_unicode_literal);
 
+  // Skip the characters that need no processing in bulk before each step.
+  CurPtr = lexer_scan::skipStringLiteralBody(CurPtr, BufferEnd);
   char C = getAndAdvanceChar(CurPtr, Result);
   while (C != '"') {
     // Skip escaped characters.  Escaped newlines will already be processed by
@@ -1934,6 +1934,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = lexer_scan::skipStringLiteralBody(CurPtr, BufferEnd);
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -2004,6 +2005,8 @@ bool Lexer::LexRawStringLiteral(Token &Result, const char *CurPtr,
   CurPtr += PrefixLen + 1; // skip over prefix and '('
 
   while (true) {
+    // Only a ')' or the end of the buffer can end the literal.
+    CurPtr = lexer_scan::skipRawStringLiteralBody(CurPtr, BufferEnd);
     char C = *CurPtr++;
 
     if (C == ')') {
@@ -2183,8 +2186,8 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
   // Skip consecutive spaces efficiently.
   while (true) {
     // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
+    CurPtr = lexer_scan::skipHorizontalWhitespace(CurPtr, BufferEnd);
+    Char = *CurPtr;
 
     // Otherwise if we have something other than whitespace, we're done.
     if (!isVerticalWhitespace(Char))
@@ -2252,11 +2255,10 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // character that ends the line comment.
   char C;
   while (true) {
+    // Skip over characters in the fast loop, up to a newline, a DOS-style
+    // newline or a potential EOF.
+    CurPtr = lexer_scan::skipLineCommentBody(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&                // Potentially EOF.
-           C != '\n' && C != '\r')  // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
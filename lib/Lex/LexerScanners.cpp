@@ -0,0 +1,358 @@
+//===--- LexerScanners.cpp - Vectorized scanners for the lexer ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the scalar, SSE2 and AVX2 versions of the lexer
+// scanners, and the runtime selection between them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/LexerScanners.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include <atomic>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define CLANG_LEXER_SCAN_SSE2 1
+#endif
+
+// The AVX2 scanners are compiled with the target attribute, so that they are
+// available even when the rest of the compiler is built for baseline x86-64.
+#if defined(__SSE2__) && defined(__GNUC__) &&                                  \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLANG_LEXER_SCAN_AVX2 1
+#endif
+
+using namespace clang;
+using namespace lexer_scan;
+
+//===----------------------------------------------------------------------===//
+// Scalar scanners
+//===----------------------------------------------------------------------===//
+
+static const char *lineCommentScalar(const char *Ptr, const char *) {
+  while (*Ptr != 0 && *Ptr != '\n' && *Ptr != '\r')
+    ++Ptr;
+  return Ptr;
+}
+
+static const char *horizontalWhitespaceScalar(const char *Ptr, const char *) {
+  while (isHorizontalWhitespace(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+static const char *identifierBodyScalar(const char *Ptr, const char *) {
+  while (isIdentifierBody(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+static const char *stringLiteralBodyScalar(const char *Ptr, const char *) {
+  while (true) {
+    switch (*Ptr) {
+    case '"': case '\\': case '?': case '\n': case '\r': case 0:
+      return Ptr;
+    default:
+      ++Ptr;
+    }
+  }
+}
+
+static const char *rawStringLiteralBodyScalar(const char *Ptr, const char *) {
+  while (*Ptr != ')' && *Ptr != 0)
+    ++Ptr;
+  return Ptr;
+}
+
+// The vector scanners compute, for each block of characters, the mask of the
+// characters that stop the scan, and leave the final partial block to the
+// scalar scanners. Reading whole blocks before \p End never touches memory past
+// the buffer.
+
+//===----------------------------------------------------------------------===//
+// SSE2 scanners
+//===----------------------------------------------------------------------===//
+
+#ifdef CLANG_LEXER_SCAN_SSE2
+static inline __m128i loadSSE2(const char *Ptr) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+}
+
+static inline __m128i eqSSE2(__m128i V, char C) {
+  return _mm_cmpeq_epi8(V, _mm_set1_epi8(C));
+}
+
+/// The lanes of \p V in the range [Lo, Hi], using unsigned saturation.
+static inline __m128i inRangeSSE2(__m128i V, char Lo, char Hi) {
+  __m128i Off = _mm_sub_epi8(V, _mm_set1_epi8(Lo));
+  return _mm_cmpeq_epi8(_mm_subs_epu8(Off, _mm_set1_epi8(Hi - Lo)),
+                        _mm_setzero_si128());
+}
+
+static const char *lineCommentSSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = loadSSE2(Ptr);
+    __m128i Stop = _mm_or_si128(_mm_or_si128(eqSSE2(V, '\n'), eqSSE2(V, '\r')),
+                                eqSSE2(V, 0));
+    if (unsigned Mask = _mm_movemask_epi8(Stop))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return lineCommentScalar(Ptr, End);
+}
+
+static const char *horizontalWhitespaceSSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = loadSSE2(Ptr);
+    __m128i Space = _mm_or_si128(_mm_or_si128(eqSSE2(V, ' '), eqSSE2(V, '\t')),
+                                 _mm_or_si128(eqSSE2(V, '\f'), eqSSE2(V, '\v')));
+    if (unsigned Mask = ~_mm_movemask_epi8(Space) & 0xFFFFu)
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return horizontalWhitespaceScalar(Ptr, End);
+}
+
+static const char *identifierBodySSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = loadSSE2(Ptr);
+    // Setting bit 5 maps 'A'-'Z' onto 'a'-'z', and nothing else onto 'a'-'z'.
+    __m128i Lower = _mm_or_si128(V, _mm_set1_epi8(0x20));
+    __m128i Body = _mm_or_si128(
+        _mm_or_si128(inRangeSSE2(Lower, 'a', 'z'), inRangeSSE2(V, '0', '9')),
+        eqSSE2(V, '_'));
+    if (unsigned Mask = ~_mm_movemask_epi8(Body) & 0xFFFFu)
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return identifierBodyScalar(Ptr, End);
+}
+
+static const char *stringLiteralBodySSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = loadSSE2(Ptr);
+    __m128i Stop = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(eqSSE2(V, '"'), eqSSE2(V, '\\')),
+                     _mm_or_si128(eqSSE2(V, '?'), eqSSE2(V, 0))),
+        _mm_or_si128(eqSSE2(V, '\n'), eqSSE2(V, '\r')));
+    if (unsigned Mask = _mm_movemask_epi8(Stop))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return stringLiteralBodyScalar(Ptr, End);
+}
+
+static const char *rawStringLiteralBodySSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = loadSSE2(Ptr);
+    __m128i Stop = _mm_or_si128(eqSSE2(V, ')'), eqSSE2(V, 0));
+    if (unsigned Mask = _mm_movemask_epi8(Stop))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return rawStringLiteralBodyScalar(Ptr, End);
+}
+#endif
+
+//===----------------------------------------------------------------------===//
+// AVX2 scanners
+//===----------------------------------------------------------------------===//
+
+#ifdef CLANG_LEXER_SCAN_AVX2
+// Every function that uses AVX2 intrinsics, including the inline helpers, must
+// carry the target attribute, or the intrinsics cannot be inlined into it.
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+
+AVX2_FUNCTION static inline __m256i loadAVX2(const char *Ptr) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Ptr));
+}
+
+AVX2_FUNCTION static inline __m256i eqAVX2(__m256i V, char C) {
+  return _mm256_cmpeq_epi8(V, _mm256_set1_epi8(C));
+}
+
+AVX2_FUNCTION static inline __m256i inRangeAVX2(__m256i V, char Lo, char Hi) {
+  __m256i Off = _mm256_sub_epi8(V, _mm256_set1_epi8(Lo));
+  return _mm256_cmpeq_epi8(_mm256_subs_epu8(Off, _mm256_set1_epi8(Hi - Lo)),
+                           _mm256_setzero_si256());
+}
+
+AVX2_FUNCTION static const char *lineCommentAVX2(const char *Ptr,
+                                                 const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = loadAVX2(Ptr);
+    __m256i Stop = _mm256_or_si256(
+        _mm256_or_si256(eqAVX2(V, '\n'), eqAVX2(V, '\r')), eqAVX2(V, 0));
+    if (unsigned Mask = _mm256_movemask_epi8(Stop))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return lineCommentSSE2(Ptr, End);
+}
+
+AVX2_FUNCTION static const char *horizontalWhitespaceAVX2(const char *Ptr,
+                                                          const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = loadAVX2(Ptr);
+    __m256i Space = _mm256_or_si256(
+        _mm256_or_si256(eqAVX2(V, ' '), eqAVX2(V, '\t')),
+        _mm256_or_si256(eqAVX2(V, '\f'), eqAVX2(V, '\v')));
+    if (unsigned Mask = ~unsigned(_mm256_movemask_epi8(Space)))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return horizontalWhitespaceSSE2(Ptr, End);
+}
+
+AVX2_FUNCTION static const char *identifierBodyAVX2(const char *Ptr,
+                                                    const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = loadAVX2(Ptr);
+    __m256i Lower = _mm256_or_si256(V, _mm256_set1_epi8(0x20));
+    __m256i Body = _mm256_or_si256(
+        _mm256_or_si256(inRangeAVX2(Lower, 'a', 'z'), inRangeAVX2(V, '0', '9')),
+        eqAVX2(V, '_'));
+    if (unsigned Mask = ~unsigned(_mm256_movemask_epi8(Body)))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return identifierBodySSE2(Ptr, End);
+}
+
+AVX2_FUNCTION static const char *stringLiteralBodyAVX2(const char *Ptr,
+                                                       const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = loadAVX2(Ptr);
+    __m256i Stop = _mm256_or_si256(
+        _mm256_or_si256(_mm256_or_si256(eqAVX2(V, '"'), eqAVX2(V, '\\')),
+                        _mm256_or_si256(eqAVX2(V, '?'), eqAVX2(V, 0))),
+        _mm256_or_si256(eqAVX2(V, '\n'), eqAVX2(V, '\r')));
+    if (unsigned Mask = _mm256_movemask_epi8(Stop))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return stringLiteralBodySSE2(Ptr, End);
+}
+
+AVX2_FUNCTION static const char *rawStringLiteralBodyAVX2(const char *Ptr,
+                                                          const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = loadAVX2(Ptr);
+    __m256i Stop = _mm256_or_si256(eqAVX2(V, ')'), eqAVX2(V, 0));
+    if (unsigned Mask = _mm256_movemask_epi8(Stop))
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+  return rawStringLiteralBodySSE2(Ptr, End);
+}
+
+#undef AVX2_FUNCTION
+#endif
+
+//===----------------------------------------------------------------------===//
+// Runtime selection
+//===----------------------------------------------------------------------===//
+
+namespace {
+typedef const char *(*ScannerFn)(const char *Ptr, const char *End);
+
+struct ScannerTable {
+  ScannerKind Kind;
+  ScannerFn LineComment;
+  ScannerFn HorizontalWhitespace;
+  ScannerFn IdentifierBody;
+  ScannerFn StringLiteralBody;
+  ScannerFn RawStringLiteralBody;
+};
+} // end anonymous namespace
+
+static const ScannerTable ScalarScanners = {
+    ScannerKind::Scalar,      lineCommentScalar,
+    horizontalWhitespaceScalar, identifierBodyScalar,
+    stringLiteralBodyScalar,  rawStringLiteralBodyScalar};
+
+#ifdef CLANG_LEXER_SCAN_SSE2
+static const ScannerTable SSE2Scanners = {
+    ScannerKind::SSE2,      lineCommentSSE2,       horizontalWhitespaceSSE2,
+    identifierBodySSE2,     stringLiteralBodySSE2, rawStringLiteralBodySSE2};
+#endif
+
+#ifdef CLANG_LEXER_SCAN_AVX2
+static const ScannerTable AVX2Scanners = {
+    ScannerKind::AVX2,      lineCommentAVX2,       horizontalWhitespaceAVX2,
+    identifierBodyAVX2,     stringLiteralBodyAVX2, rawStringLiteralBodyAVX2};
+#endif
+
+static const ScannerTable *getScannerTable(ScannerKind Kind) {
+  switch (Kind) {
+  case ScannerKind::Scalar:
+    return &ScalarScanners;
+  case ScannerKind::SSE2:
+#ifdef CLANG_LEXER_SCAN_SSE2
+    return &SSE2Scanners;
+#else
+    return nullptr;
+#endif
+  case ScannerKind::AVX2:
+#ifdef CLANG_LEXER_SCAN_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return &AVX2Scanners;
+#endif
+    return nullptr;
+  }
+  llvm_unreachable("unknown scanner kind");
+}
+
+/// Pick the widest implementation supported by the host CPU.
+static const ScannerTable *detectScanners() {
+  for (ScannerKind Kind : {ScannerKind::AVX2, ScannerKind::SSE2})
+    if (const ScannerTable *Table = getScannerTable(Kind))
+      return Table;
+  return &ScalarScanners;
+}
+
+static std::atomic<const ScannerTable *> &getSelectedScanners() {
+  static std::atomic<const ScannerTable *> Selected(detectScanners());
+  return Selected;
+}
+
+static const ScannerTable &getScanners() {
+  return *getSelectedScanners().load(std::memory_order_relaxed);
+}
+
+ScannerKind lexer_scan::getScannerKind() { return getScanners().Kind; }
+
+bool lexer_scan::isScannerKindAvailable(ScannerKind Kind) {
+  return getScannerTable(Kind) != nullptr;
+}
+
+bool lexer_scan::setScannerKind(ScannerKind Kind) {
+  const ScannerTable *Table = getScannerTable(Kind);
+  if (!Table)
+    return false;
+  getSelectedScanners().store(Table, std::memory_order_relaxed);
+  return true;
+}
+
+const char *lexer_scan::detail::skipLineCommentBody(const char *Ptr,
+                                                    const char *End) {
+  return getScanners().LineComment(Ptr, End);
+}
+
+const char *lexer_scan::detail::skipHorizontalWhitespace(const char *Ptr,
+                                                         const char *End) {
+  return getScanners().HorizontalWhitespace(Ptr, End);
+}
+
+const char *lexer_scan::detail::skipIdentifierBody(const char *Ptr,
+                                                   const char *End) {
+  return getScanners().IdentifierBody(Ptr, End);
+}
+
+const char *lexer_scan::detail::skipStringLiteralBody(const char *Ptr,
+                                                      const char *End) {
+  return getScanners().StringLiteralBody(Ptr, End);
+}
+
+const char *lexer_scan::detail::skipRawStringLiteralBody(const char *Ptr,
+                                                         const char *End) {
+  return getScanners().RawStringLiteralBody(Ptr, End);
+}
@@ -1523,6 +1523,11 @@ Sema::CheckBuiltinFunctionCall(FunctionDecl *FDecl, unsigned BuiltinID,
   }
 
   bool asmjs = FDecl->hasAttr<AsmJSAttr>();
+  // The externref table is usable from both genericjs and asmjs code
+  if (Context.getTargetInfo().getTriple().getArch()==llvm::Triple::cheerp) {
+    if (CheckCheerpExternRefTableCall(BuiltinID, TheCall))
+      return ExprError();
+  }
   // Some builtins need special handling on generic Cheerp
   if (!asmjs && Context.getTargetInfo().getTriple().getArch()==llvm::Triple::cheerp) {
     if (CheckCheerpBuiltinFunctionCall(BuiltinID, TheCall))
@@ -4041,6 +4046,45 @@ bool Sema::CheckCheerpBuiltinFunctionCall(unsigned BuiltinID, CallExpr *TheCall)
     return false;
 }
 
+bool Sema::CheckCheerpExternRefTableCall(unsigned BuiltinID, CallExpr *TheCall) {
+  const Expr* ClientPtr = nullptr;
+  QualType ClientPtrTy;
+  bool isLoad = false;
+  switch (BuiltinID) {
+  case Cheerp::BI__builtin_cheerp_externref_table_get:
+    ClientPtr = TheCall;
+    ClientPtrTy = TheCall->getType();
+    isLoad = true;
+    break;
+  case Cheerp::BI__builtin_cheerp_externref_table_set:
+    if (TheCall->getNumArgs() != 2)
+      return false;
+    ClientPtr = TheCall->getArg(1);
+    ClientPtrTy = ClientPtr->getType();
+    break;
+  case Cheerp::BI__builtin_cheerp_externref_table_grow:
+    break;
+  default:
+    return false;
+  }
+  // The table is a Wasm table of externref
+  if (!getLangOpts().CheerpAnyref) {
+    Diag(TheCall->getBeginLoc(), diag::err_cheerp_externref_table_no_externref)
+      << TheCall->getDirectCallee();
+    return true;
+  }
+  if (!ClientPtr)
+    return false;
+  const CXXRecordDecl* RD = ClientPtrTy->isPointerType() ?
+      ClientPtrTy->getPointeeCXXRecordDecl() : nullptr;
+  if (!RD || !RD->getDeclContext()->isClientNamespace()) {
+    Diag(ClientPtr->getBeginLoc(), diag::err_cheerp_externref_table_not_client)
+      << isLoad << ClientPtr->getSourceRange();
+    return true;
+  }
+  return false;
+}
+
 /// Given a FunctionDecl's FormatAttr, attempts to populate the FomatStringInfo
 /// parameter with the FormatAttr's correct format_idx and firstDataArg.
 /// Returns true when the format fits the function and the FormatStringInfo has
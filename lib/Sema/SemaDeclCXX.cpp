@@ -6473,12 +6473,27 @@ void Sema::CheckCompletedCXXClass(CXXRecordDecl *Record) {
         Diag(f->getLocation(), diag::err_cheerp_incompatible_attributes)
           << getGenericJSAttr(f->getType()) << "field" << f
           << Record->getAttr<AsmJSAttr>() << "class" << Record;
+        // Client objects can still be referenced through the externref table
+        if (getLangOpts().CheerpAnyref && isAsmJSCompatible(f->getType(), true))
+          Diag(f->getLocation(), diag::note_cheerp_externref_handle);
       }
     }
   }
   // CHEERP: If the record type is genericjs, disallow asmjs value fields (pointers allowed)
   // and client namespace type values (pointers allowed)
   else if (Record->hasAttr<GenericJSAttr>()) {
+    // CHEERP: Report the classes which -cheerp-stable-shapes cannot handle
+    if (getLangOpts().CheerpStableShapes && !Record->isUnion() &&
+        !Record->isByteLayout()) {
+      if (Record->getNumVBases())
+        Diag(Record->getLocation(), diag::warn_cheerp_unstable_shape)
+          << Record << 0;
+      for (const auto* f: Record->fields()) {
+        if (f->getType()->isUnionType())
+          Diag(f->getLocation(), diag::warn_cheerp_unstable_shape)
+            << Record << 1 << f;
+      }
+    }
     for (const auto* f: Record->fields()) {
       if (isAsmJSValue(f->getType())) {
         Diag(f->getLocation(), diag::err_cheerp_incompatible_attributes)
@@ -12,6 +12,7 @@
 
 #include "clang/Sema/SemaInternal.h"
 #include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Sema/DelayedDiagnostic.h"
 #include "clang/Sema/Lookup.h"
@@ -51,6 +52,161 @@ static Attr *handleFallThroughAttr(Sema &S, Stmt *St, const ParsedAttr &A,
   return ::new (S.Context) auto(Attr);
 }
 
+/// Get the prototype of the function called by \p CE for the purpose of a
+/// guaranteed tail call, or null if the kind of call is not supported.
+static const FunctionProtoType *getMustTailCalleeType(Sema &S,
+                                                      const CallExpr *CE,
+                                                      const MustTailAttr &Attr) {
+  const Expr *Callee = CE->getCallee()->IgnoreParens();
+  if (isa<CXXMemberCallExpr>(CE) || isa<CXXOperatorCallExpr>(CE)) {
+    if (const CXXMethodDecl *MD =
+            dyn_cast_or_null<CXXMethodDecl>(CE->getCalleeDecl()))
+      return MD->getType()->castAs<FunctionProtoType>();
+  }
+  if (Callee->getType()->isSpecificPlaceholderType(BuiltinType::BoundMember) ||
+      Callee->getType()->isMemberFunctionPointerType()) {
+    S.Diag(CE->getBeginLoc(), diag::err_musttail_unsupported_callee)
+        << Attr.getSpelling() << 0;
+    return nullptr;
+  }
+  if (Callee->getType()->isBlockPointerType()) {
+    S.Diag(CE->getBeginLoc(), diag::err_musttail_unsupported_callee)
+        << Attr.getSpelling() << 2;
+    return nullptr;
+  }
+  QualType CalleeTy = Callee->getType();
+  if (const PointerType *PT = CalleeTy->getAs<PointerType>())
+    CalleeTy = PT->getPointeeType();
+  const FunctionProtoType *FPT = CalleeTy->getAs<FunctionProtoType>();
+  if (!FPT)
+    S.Diag(CE->getBeginLoc(), diag::err_musttail_unsupported_callee)
+        << Attr.getSpelling() << 1;
+  return FPT;
+}
+
+/// Check that the return statement \p St can be turned into a guaranteed
+/// tail call: it must return the result of a call to a function with the
+/// same signature as the current one.
+static bool checkMustTailAttr(Sema &S, Stmt *St, const MustTailAttr &Attr) {
+  ReturnStmt *RS = dyn_cast<ReturnStmt>(St);
+  if (!RS) {
+    S.Diag(St->getBeginLoc(), diag::err_musttail_needs_return)
+        << Attr.getSpelling();
+    return false;
+  }
+  const Expr *RetVal = RS->getRetValue();
+  if (RetVal && isa<ExprWithCleanups>(RetVal)) {
+    S.Diag(RetVal->getBeginLoc(), diag::err_musttail_temporaries)
+        << Attr.getSpelling();
+    return false;
+  }
+  // Implicit conversions of the result are diagnosed as a return type mismatch
+  const CallExpr *CE =
+      RetVal ? dyn_cast<CallExpr>(RetVal->IgnoreParenImpCasts()) : nullptr;
+  if (!CE || isa<CUDAKernelCallExpr>(CE)) {
+    S.Diag(RetVal ? RetVal->getBeginLoc() : St->getBeginLoc(),
+           diag::err_musttail_needs_call)
+        << Attr.getSpelling();
+    return false;
+  }
+
+  const FunctionDecl *Caller = S.getCurFunctionDecl();
+  if (!Caller || isa<BlockDecl>(S.CurContext)) {
+    S.Diag(CE->getBeginLoc(), diag::err_musttail_unsupported_callee)
+        << Attr.getSpelling() << 2;
+    return false;
+  }
+  // Signatures are checked again by TreeTransform once the template is
+  // instantiated
+  if (CE->isTypeDependent() || CE->isValueDependent() ||
+      S.CurContext->isDependentContext())
+    return true;
+  const FunctionProtoType *CalleeType = getMustTailCalleeType(S, CE, Attr);
+  if (!CalleeType)
+    return false;
+  const FunctionProtoType *CallerType =
+      Caller->getType()->getAs<FunctionProtoType>();
+  if (!CallerType) {
+    S.Diag(CE->getBeginLoc(), diag::err_musttail_unsupported_callee)
+        << Attr.getSpelling() << 1;
+    return false;
+  }
+
+  // Both functions must agree on the implicit object parameter, if any
+  const CXXMethodDecl *CallerMD = dyn_cast<CXXMethodDecl>(Caller);
+  const CXXMethodDecl *CalleeMD =
+      dyn_cast_or_null<CXXMethodDecl>(CE->getCalleeDecl());
+  bool CallerIsInstance = CallerMD && CallerMD->isInstance();
+  bool CalleeIsInstance = CalleeMD && CalleeMD->isInstance();
+  int Mismatch = -1;
+  if (CallerIsInstance != CalleeIsInstance)
+    Mismatch = 4;
+  else if (CallerIsInstance &&
+           CallerMD->getParent()->getCanonicalDecl() !=
+               CalleeMD->getParent()->getCanonicalDecl())
+    Mismatch = 5;
+  else if (!S.Context.hasSameUnqualifiedType(CallerType->getReturnType(),
+                                             CalleeType->getReturnType()))
+    Mismatch = 0;
+  else if (CallerType->getNumParams() != CalleeType->getNumParams())
+    Mismatch = 2;
+  else if (CallerType->isVariadic() != CalleeType->isVariadic())
+    Mismatch = 3;
+  else {
+    for (unsigned I = 0, E = CallerType->getNumParams(); I != E; ++I) {
+      if (!S.Context.hasSameUnqualifiedType(CallerType->getParamType(I),
+                                            CalleeType->getParamType(I))) {
+        Mismatch = 1;
+        break;
+      }
+    }
+  }
+  if (Mismatch >= 0) {
+    const FunctionDecl *CalleeFD = CE->getDirectCallee();
+    S.Diag(CE->getBeginLoc(), diag::err_musttail_mismatch)
+        << (CalleeFD == nullptr) << CalleeFD << CE->getSourceRange();
+    S.Diag(CE->getBeginLoc(), diag::note_musttail_mismatch) << Mismatch;
+    return false;
+  }
+
+  // CHEERP: Tail calls are only available in wasm, and only when the engine
+  // supports return_call/return_call_indirect
+  if (S.Context.getTargetInfo().getTriple().getArch() == llvm::Triple::cheerp) {
+    if (!Caller->hasAttr<AsmJSAttr>() ||
+        S.getLangOpts().getCheerpLinearOutput() !=
+            LangOptions::CHEERP_LINEAR_OUTPUT_Wasm) {
+      S.Diag(St->getBeginLoc(), diag::err_cheerp_musttail_not_wasm);
+      return false;
+    }
+    if (!S.getLangOpts().CheerpWasmReturnCalls) {
+      S.Diag(St->getBeginLoc(), diag::err_cheerp_musttail_no_return_calls);
+      return false;
+    }
+    const FunctionDecl *CalleeFD =
+        dyn_cast_or_null<FunctionDecl>(CE->getCalleeDecl());
+    if (CalleeFD && CalleeFD->hasAttr<GenericJSAttr>()) {
+      S.Diag(CE->getBeginLoc(), diag::err_cheerp_musttail_cross_section)
+          << CalleeFD << CalleeFD->getAttr<GenericJSAttr>() << Caller
+          << Caller->getAttr<AsmJSAttr>();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Sema::CheckMustTailAttr(Stmt *St, const MustTailAttr &MTA) {
+  return checkMustTailAttr(*this, St, MTA);
+}
+
+static Attr *handleMustTailAttr(Sema &S, Stmt *St, const ParsedAttr &A,
+                                SourceRange Range) {
+  MustTailAttr Attr(A.getRange(), S.Context,
+                    A.getAttributeSpellingListIndex());
+  if (!checkMustTailAttr(S, St, Attr))
+    return nullptr;
+  return ::new (S.Context) auto(Attr);
+}
+
 static Attr *handleSuppressAttr(Sema &S, Stmt *St, const ParsedAttr &A,
                                 SourceRange Range) {
   if (A.getNumArgs() < 1) {
@@ -336,6 +492,8 @@ static Attr *ProcessStmtAttribute(Sema &S, Stmt *St, const ParsedAttr &A,
     return handleFallThroughAttr(S, St, A, Range);
   case ParsedAttr::AT_LoopHint:
     return handleLoopHintAttr(S, St, A, Range);
+  case ParsedAttr::AT_MustTail:
+    return handleMustTailAttr(S, St, A, Range);
   case ParsedAttr::AT_OpenCLUnrollHint:
     return handleOpenCLUnrollHint(S, St, A, Range);
   case ParsedAttr::AT_Suppress:
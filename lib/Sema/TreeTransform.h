@@ -6783,6 +6783,20 @@ TreeTransform<Derived>::TransformAttributedStmt(AttributedStmt *S,
   if (SubStmt.isInvalid())
     return StmtError();
 
+  // The musttail checks that depend on template arguments could only be done
+  // now, drop the attribute if the transformed statement does not pass them
+  // so that CodeGen only sees valid guaranteed tail calls.
+  for (auto I = Attrs.begin(); I != Attrs.end();) {
+    const auto *MTA = dyn_cast<MustTailAttr>(*I);
+    if (MTA && !SemaRef.CheckMustTailAttr(SubStmt.get(), *MTA)) {
+      I = Attrs.erase(I);
+      AttrsChanged = true;
+    } else
+      ++I;
+  }
+  if (Attrs.empty())
+    return SubStmt;
+
   if (SubStmt.get() == S->getSubStmt() && !AttrsChanged)
     return S;
 
@@ -121,6 +121,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <iterator>
 #include <limits>
@@ -1141,6 +1142,142 @@ void ASTDeclContextNameLookupTrait::ReadDataInto(internal_key_type,
   }
 }
 
+bool ASTReader::decompressLookupTable(ModuleFile &M, uint64_t Size,
+                                      StringRef &Blob) {
+  if (!Size)
+    return false;
+  if (!llvm::zlib::isAvailable()) {
+    Error("zlib is not available");
+    return true;
+  }
+
+  // The lookup structures point into the table, so it lives as long as the
+  // module file.
+  std::unique_ptr<llvm::WritableMemoryBuffer> Buffer =
+      llvm::WritableMemoryBuffer::getNewUninitMemBuffer(Size);
+  size_t UncompressedSize = Size;
+  if (llvm::Error E = llvm::zlib::uncompress(Blob, Buffer->getBufferStart(),
+                                             UncompressedSize)) {
+    Error("could not decompress declaration lookup table: " +
+          llvm::toString(std::move(E)));
+    return true;
+  }
+  if (UncompressedSize != Size) {
+    Error("malformed declaration lookup table");
+    return true;
+  }
+
+  ++NumCompressedLookupTablesRead;
+  LookupTablesSizeRead += Size;
+  Blob = StringRef(Buffer->getBufferStart(), Size);
+  M.DecompressedBlobs.push_back(std::move(Buffer));
+  return false;
+}
+
+bool ASTReader::ReadDeclTypesChunks(ModuleFile &F, const RecordData &Record,
+                                    StringRef Blob) {
+  if (!llvm::zlib::isAvailable()) {
+    Error("zlib is not available");
+    return true;
+  }
+
+  unsigned NumChunks = Record[0];
+  uint64_t BlockEnd = Record[1];
+  if (!F.DeclTypesChunks.empty() || !NumChunks ||
+      Blob.size() < NumChunks * 12) {
+    Error("malformed DECLTYPES_CHUNKS record in AST file");
+    return true;
+  }
+
+  using namespace llvm::support;
+  const unsigned char *Table = Blob.bytes_begin();
+  StringRef Chunks = Blob.substr(NumChunks * 12);
+  for (unsigned I = 0; I != NumChunks; ++I) {
+    ModuleFile::DeclTypesChunk Chunk;
+    Chunk.StartBit = endian::readNext<uint64_t, little, unaligned>(Table);
+    Chunk.Begin = Chunk.StartBit / 8;
+    uint32_t Size = endian::readNext<uint32_t, little, unaligned>(Table);
+    Chunk.Compressed = Chunks.substr(0, Size);
+    Chunks = Chunks.substr(Size);
+    F.DeclTypesChunks.push_back(Chunk);
+  }
+  // A chunk ends with the byte the next one starts in.
+  for (unsigned I = 0; I + 1 != NumChunks; ++I)
+    F.DeclTypesChunks[I].End = (F.DeclTypesChunks[I + 1].StartBit + 7) / 8;
+  F.DeclTypesChunks.back().End = BlockEnd;
+
+  uint64_t BodyStart = F.DeclTypesChunks.front().Begin;
+  uint64_t HeaderStart = F.DeclsCursorStart / 8;
+  auto IsMalformed = [](const ModuleFile::DeclTypesChunk &Chunk) {
+    return Chunk.End <= Chunk.Begin;
+  };
+  if (HeaderStart > BodyStart || BodyStart > F.Data.size() ||
+      llvm::any_of(F.DeclTypesChunks, IsMalformed)) {
+    Error("malformed DECLTYPES_CHUNKS record in AST file");
+    return true;
+  }
+
+  // Offsets into the block are those of the uncompressed file, which can be
+  // larger than the file.
+  F.DeclTypesBuffer = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(
+      BlockEnd, F.FileName);
+  F.SizeInBits = std::max(F.SizeInBits, BlockEnd * 8);
+  for (const ModuleFile::DeclTypesChunk &Chunk : F.DeclTypesChunks) {
+    ++TotalDeclTypesChunks;
+    TotalDeclTypesChunksSize += Chunk.End - Chunk.Begin;
+    TotalCompressedDeclTypesChunksSize += Chunk.Compressed.size();
+  }
+
+  // Clone the cursor again, into the buffer, from the header of the empty
+  // block left in the file.
+  std::memcpy(F.DeclTypesBuffer->getBufferStart() + HeaderStart,
+              F.Data.data() + HeaderStart, BodyStart - HeaderStart);
+  F.DeclsCursor = BitstreamCursor(F.DeclTypesBuffer->getMemBufferRef());
+  // The abbreviations are at the start of the first chunk.
+  if (llvm::Error Err = JumpToDeclsOffset(F, F.DeclTypesChunks[0].StartBit)) {
+    Error(std::move(Err));
+    return true;
+  }
+  if (llvm::Error Err = F.DeclsCursor.JumpToBit(F.DeclsCursorStart)) {
+    Error(std::move(Err));
+    return true;
+  }
+  if (ReadBlockAbbrevs(F.DeclsCursor, DECLTYPES_BLOCK_ID)) {
+    Error("malformed block record in AST file");
+    return true;
+  }
+  return false;
+}
+
+llvm::Error ASTReader::JumpToDeclsOffset(ModuleFile &F, uint64_t Offset) {
+  // Everything read from an offset is in the chunk the offset points into.
+  auto Chunk = std::upper_bound(
+      F.DeclTypesChunks.begin(), F.DeclTypesChunks.end(), Offset,
+      [](uint64_t Offset, const ModuleFile::DeclTypesChunk &Chunk) {
+        return Offset < Chunk.StartBit;
+      });
+  if (Chunk == F.DeclTypesChunks.begin())
+    return F.DeclsCursor.JumpToBit(Offset);
+
+  // The cursor also reads the bytes around the chunk, which may not be
+  // decompressed yet, but never uses their bits.
+  --Chunk;
+  if (!Chunk->Loaded) {
+    size_t Size = Chunk->End - Chunk->Begin;
+    if (llvm::Error E = llvm::zlib::uncompress(
+            Chunk->Compressed,
+            F.DeclTypesBuffer->getBufferStart() + Chunk->Begin, Size))
+      return E;
+    if (Size != Chunk->End - Chunk->Begin)
+      return llvm::createStringError(std::errc::illegal_byte_sequence,
+                                     "malformed declaration and type chunk");
+    Chunk->Loaded = true;
+    ++NumDeclTypesChunksRead;
+    DeclTypesChunksSizeRead += Size;
+  }
+  return F.DeclsCursor.JumpToBit(Offset);
+}
+
 bool ASTReader::ReadLexicalDeclContextStorage(ModuleFile &M,
                                               BitstreamCursor &Cursor,
                                               uint64_t Offset,
@@ -1148,7 +1285,7 @@ bool ASTReader::ReadLexicalDeclContextStorage(ModuleFile &M,
   assert(Offset != 0);
 
   SavedStreamPosition SavedPosition(Cursor);
-  if (llvm::Error Err = Cursor.JumpToBit(Offset)) {
+  if (llvm::Error Err = JumpToDeclsOffset(M, Offset)) {
     Error(std::move(Err));
     return true;
   }
@@ -1172,6 +1309,8 @@ bool ASTReader::ReadLexicalDeclContextStorage(ModuleFile &M,
     Error("Expected lexical block");
     return true;
   }
+  if (decompressLookupTable(M, Record[0], Blob))
+    return true;
 
   assert(!isa<TranslationUnitDecl>(DC) &&
          "expected a TU_UPDATE_LEXICAL record for TU");
@@ -1198,7 +1337,7 @@ bool ASTReader::ReadVisibleDeclContextStorage(ModuleFile &M,
   assert(Offset != 0);
 
   SavedStreamPosition SavedPosition(Cursor);
-  if (llvm::Error Err = Cursor.JumpToBit(Offset)) {
+  if (llvm::Error Err = JumpToDeclsOffset(M, Offset)) {
     Error(std::move(Err));
     return true;
   }
@@ -1222,6 +1361,8 @@ bool ASTReader::ReadVisibleDeclContextStorage(ModuleFile &M,
     Error("Expected visible lookup table block");
     return true;
   }
+  if (decompressLookupTable(M, Record[0], Blob))
+    return true;
 
   // We can't safely determine the primary context yet, so delay attaching the
   // lookup table until we're done with recursive deserialization.
@@ -2898,6 +3039,7 @@ ASTReader::ReadASTBlock(ModuleFile &F, unsigned ClientLoadCapabilities) {
         // cursor to it, enter the block and read the abbrevs in that block.
         // With the main cursor, we just skip over it.
         F.DeclsCursor = Stream;
+        F.DeclsCursorStart = Stream.GetCurrentBitNo();
         if (llvm::Error Err = Stream.SkipBlock()) {
           Error(std::move(Err));
           return Failure;
@@ -3047,6 +3189,11 @@ ASTReader::ReadASTBlock(ModuleFile &F, unsigned ClientLoadCapabilities) {
       break;
     }
 
+    case DECLTYPES_CHUNKS:
+      if (ReadDeclTypesChunks(F, Record, Blob))
+        return Failure;
+      break;
+
     case DECL_OFFSET: {
       if (F.LocalNumDecls != 0) {
         Error("duplicate DECL_OFFSET record in AST file");
@@ -3187,6 +3334,9 @@ ASTReader::ReadASTBlock(ModuleFile &F, unsigned ClientLoadCapabilities) {
       TotalNumMacros += Record[1];
       TotalLexicalDeclContexts += Record[2];
       TotalVisibleDeclContexts += Record[3];
+      TotalCompressedLookupTables += Record[4];
+      TotalLookupTablesSize += Record[5];
+      TotalCompressedLookupTablesSize += Record[6];
       break;
 
     case UNUSED_FILESCOPED_DECLS:
@@ -6259,7 +6409,7 @@ QualType ASTReader::readTypeRecord(unsigned Index) {
   Deserializing AType(this);
 
   unsigned Idx = 0;
-  if (llvm::Error Err = DeclsCursor.JumpToBit(Loc.Offset)) {
+  if (llvm::Error Err = JumpToDeclsOffset(*Loc.F, Loc.Offset)) {
     Error(std::move(Err));
     return QualType();
   }
@@ -7581,7 +7731,7 @@ ASTReader::GetExternalCXXCtorInitializers(uint64_t Offset) {
   RecordLocation Loc = getLocalBitOffset(Offset);
   BitstreamCursor &Cursor = Loc.F->DeclsCursor;
   SavedStreamPosition SavedPosition(Cursor);
-  if (llvm::Error Err = Cursor.JumpToBit(Loc.Offset)) {
+  if (llvm::Error Err = JumpToDeclsOffset(*Loc.F, Loc.Offset)) {
     Error(std::move(Err));
     return nullptr;
   }
@@ -7616,7 +7766,7 @@ CXXBaseSpecifier *ASTReader::GetExternalCXXBaseSpecifiers(uint64_t Offset) {
   RecordLocation Loc = getLocalBitOffset(Offset);
   BitstreamCursor &Cursor = Loc.F->DeclsCursor;
   SavedStreamPosition SavedPosition(Cursor);
-  if (llvm::Error Err = Cursor.JumpToBit(Loc.Offset)) {
+  if (llvm::Error Err = JumpToDeclsOffset(*Loc.F, Loc.Offset)) {
     Error(std::move(Err));
     return nullptr;
   }
@@ -7844,7 +7994,7 @@ Stmt *ASTReader::GetExternalDeclStmt(uint64_t Offset) {
 
   // Offset here is a global offset across the entire chain.
   RecordLocation Loc = getLocalBitOffset(Offset);
-  if (llvm::Error Err = Loc.F->DeclsCursor.JumpToBit(Loc.Offset)) {
+  if (llvm::Error Err = JumpToDeclsOffset(*Loc.F, Loc.Offset)) {
     Error(std::move(Err));
     return nullptr;
   }
@@ -8122,6 +8272,35 @@ void ASTReader::PrintStats() {
                  NumVisibleDeclContextsRead, TotalVisibleDeclContexts,
                  ((float)NumVisibleDeclContextsRead/TotalVisibleDeclContexts
                   * 100));
+  if (TotalCompressedLookupTables) {
+    std::fprintf(stderr,
+                 "  %u/%u compressed lookup tables decompressed (%f%%)\n",
+                 NumCompressedLookupTablesRead, TotalCompressedLookupTables,
+                 ((float)NumCompressedLookupTablesRead /
+                  TotalCompressedLookupTables * 100));
+    std::fprintf(stderr, "  %llu bytes of lookup tables compressed to %llu\n",
+                 (unsigned long long)TotalLookupTablesSize,
+                 (unsigned long long)TotalCompressedLookupTablesSize);
+    std::fprintf(stderr, "  %llu bytes decompressed, %llu bytes skipped\n",
+                 (unsigned long long)LookupTablesSizeRead,
+                 (unsigned long long)(TotalLookupTablesSize -
+                                      std::min(LookupTablesSizeRead,
+                                               TotalLookupTablesSize)));
+  }
+  if (TotalDeclTypesChunks) {
+    std::fprintf(stderr,
+                 "  %u/%u declaration and type chunks decompressed (%f%%)\n",
+                 NumDeclTypesChunksRead, TotalDeclTypesChunks,
+                 ((float)NumDeclTypesChunksRead / TotalDeclTypesChunks * 100));
+    std::fprintf(stderr,
+                 "  %llu bytes of declarations and types compressed to %llu\n",
+                 (unsigned long long)TotalDeclTypesChunksSize,
+                 (unsigned long long)TotalCompressedDeclTypesChunksSize);
+    std::fprintf(stderr, "  %llu bytes decompressed, %llu bytes skipped\n",
+                 (unsigned long long)DeclTypesChunksSizeRead,
+                 (unsigned long long)(TotalDeclTypesChunksSize -
+                                      DeclTypesChunksSizeRead));
+  }
   if (TotalNumMethodPoolEntries)
     std::fprintf(stderr, "  %u/%u method pool entries read (%f%%)\n",
                  NumMethodPoolEntriesRead, TotalNumMethodPoolEntries,
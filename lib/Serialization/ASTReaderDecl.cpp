@@ -3691,7 +3691,7 @@ Decl *ASTReader::ReadDeclRecord(DeclID ID) {
                              ": " + toString(std::move(Err)));
   };
 
-  if (llvm::Error JumpFailed = DeclsCursor.JumpToBit(Loc.Offset))
+  if (llvm::Error JumpFailed = JumpToDeclsOffset(*Loc.F, Loc.Offset))
     Fail("jumping", std::move(JumpFailed));
   ASTRecordReader Record(*this, *Loc.F);
   ASTDeclReader Reader(*this, Record, Loc, ID, DeclLoc);
@@ -4049,7 +4049,7 @@ void ASTReader::loadDeclUpdateRecords(PendingUpdateRecord &Record) {
       uint64_t Offset = FileAndOffset.second;
       llvm::BitstreamCursor &Cursor = F->DeclsCursor;
       SavedStreamPosition SavedPosition(Cursor);
-      if (llvm::Error JumpFailed = Cursor.JumpToBit(Offset))
+      if (llvm::Error JumpFailed = JumpToDeclsOffset(*F, Offset))
         // FIXME don't do a fatal error.
         llvm::report_fatal_error(
             "ASTReader::loadDeclUpdateRecords failed jumping: " +
@@ -4131,7 +4131,7 @@ void ASTReader::loadPendingDeclChain(Decl *FirstLocal, uint64_t LocalOffset) {
 
   llvm::BitstreamCursor &Cursor = M->DeclsCursor;
   SavedStreamPosition SavedPosition(Cursor);
-  if (llvm::Error JumpFailed = Cursor.JumpToBit(LocalOffset))
+  if (llvm::Error JumpFailed = JumpToDeclsOffset(*M, LocalOffset))
     llvm::report_fatal_error(
         "ASTReader::loadPendingDeclChain failed jumping: " +
         toString(std::move(JumpFailed)));
@@ -3181,6 +3181,102 @@ void ASTWriter::WriteType(QualType T) {
 // Declaration Serialization
 //===----------------------------------------------------------------------===//
 
+/// Compress a lookup table of a DeclContext, if lookup table compression is
+/// enabled and the table is large enough to be worth it.
+///
+/// \returns the size of the table if it was compressed into \p Compressed,
+/// or 0 if it should be written as is.
+uint64_t ASTWriter::compressLookupTable(StringRef Blob,
+                                        SmallVectorImpl<char> &Compressed) {
+  // Small tables are not worth a separate zlib stream, and the tables are
+  // compressed along with the rest of the DECLTYPES_BLOCK when it is.
+  if (!PP->getHeaderSearchInfo().getHeaderSearchOpts()
+           .ModulesCompressLookupTables ||
+      !DeclTypesChunkStarts.empty() || Blob.size() < 1024 ||
+      !llvm::zlib::isAvailable())
+    return 0;
+
+  if (llvm::Error E = llvm::zlib::compress(Blob, Compressed)) {
+    llvm::consumeError(std::move(E));
+    return 0;
+  }
+  if (Compressed.size() >= Blob.size())
+    return 0;
+
+  ++NumCompressedLookupTables;
+  LookupTablesSize += Blob.size();
+  CompressedLookupTablesSize += Compressed.size();
+  return Blob.size();
+}
+
+/// Start a new chunk of the DECLTYPES_BLOCK before the next type,
+/// declaration or group of update records, if the DECLTYPES_BLOCK is
+/// compressed and the current chunk is large enough.
+///
+/// The reader reads everything written for one of them once it has jumped to
+/// any of its offsets, so they never straddle two chunks.
+void ASTWriter::startDeclTypesChunk() {
+  const uint64_t ChunkSize = 64 * 1024;
+  if (DeclTypesChunkStarts.empty())
+    return;
+
+  uint64_t Offset = Stream.GetCurrentBitNo();
+  if (Offset - DeclTypesChunkStarts.back() >= ChunkSize * 8)
+    DeclTypesChunkStarts.push_back(Offset);
+}
+
+/// Replace the contents of the DECLTYPES_BLOCK, which start at the byte
+/// \p BodyStart of the buffer, by a DECLTYPES_CHUNKS record with its chunks
+/// compressed one by one.
+///
+/// The offsets of the types, declarations and statements are left as they
+/// are: the reader decompresses the chunks in place, in a buffer laid out
+/// like the uncompressed file.
+void ASTWriter::compressDeclTypesBlock(uint64_t BodyStart) {
+  uint64_t BodyEnd = Buffer.size();
+  SmallString<256> Table;
+  SmallString<0> Chunks;
+  for (unsigned I = 0, N = DeclTypesChunkStarts.size(); I != N; ++I) {
+    // A chunk ends with the byte the next one starts in, so that each of
+    // them can be decompressed on its own.
+    uint64_t Begin = DeclTypesChunkStarts[I] / 8;
+    uint64_t End =
+        I + 1 == N ? BodyEnd : (DeclTypesChunkStarts[I + 1] + 7) / 8;
+    SmallString<0> Compressed;
+    if (llvm::Error E = llvm::zlib::compress(
+            StringRef(Buffer.data() + Begin, End - Begin), Compressed)) {
+      // Leave the block uncompressed.
+      llvm::consumeError(std::move(E));
+      return;
+    }
+
+    llvm::raw_svector_ostream Out(Table);
+    using namespace llvm::support;
+    endian::Writer LE(Out, little);
+    LE.write<uint64_t>(DeclTypesChunkStarts[I]);
+    LE.write<uint32_t>(Compressed.size());
+    Chunks += Compressed;
+  }
+
+  // Leave an empty block behind: an END_BLOCK padded to a word, one word
+  // long.
+  Buffer.resize(BodyStart);
+  Buffer.append(4, 0);
+  llvm::support::endian::write32le(Buffer.data() + BodyStart - 4, 1);
+
+  auto Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(DECLTYPES_CHUNKS));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // # of chunks
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // end of the block
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+  unsigned ChunksAbbrev = Stream.EmitAbbrev(std::move(Abbrev));
+
+  RecordData::value_type Record[] = {DECLTYPES_CHUNKS,
+                                     DeclTypesChunkStarts.size(), BodyEnd};
+  Table += Chunks;
+  Stream.EmitRecordWithBlob(ChunksAbbrev, Record, Table);
+}
+
 /// Write the block containing all of the declaration IDs
 /// lexically declared within the given DeclContext.
 ///
@@ -3199,9 +3295,11 @@ uint64_t ASTWriter::WriteDeclContextLexicalBlock(ASTContext &Context,
   }
 
   ++NumLexicalDeclContexts;
-  RecordData::value_type Record[] = {DECL_CONTEXT_LEXICAL};
+  SmallString<0> Compressed;
+  uint64_t Size = compressLookupTable(bytes(KindDeclPairs), Compressed);
+  RecordData::value_type Record[] = {DECL_CONTEXT_LEXICAL, Size};
   Stream.EmitRecordWithBlob(DeclContextLexicalAbbrev, Record,
-                            bytes(KindDeclPairs));
+                            Size ? StringRef(Compressed) : bytes(KindDeclPairs));
   return Offset;
 }
 
@@ -4230,9 +4328,12 @@ uint64_t ASTWriter::WriteDeclContextVisibleBlock(ASTContext &Context,
   GenerateNameLookupTable(DC, LookupTable);
 
   // Write the lookup table
-  RecordData::value_type Record[] = {DECL_CONTEXT_VISIBLE};
+  SmallString<0> Compressed;
+  uint64_t Size = compressLookupTable(LookupTable, Compressed);
+  RecordData::value_type Record[] = {DECL_CONTEXT_VISIBLE, Size};
   Stream.EmitRecordWithBlob(DeclContextVisibleLookupAbbrev, Record,
-                            LookupTable);
+                            Size ? StringRef(Compressed)
+                                 : StringRef(LookupTable));
   ++NumVisibleDeclContexts;
   return Offset;
 }
@@ -4670,10 +4771,12 @@ ASTFileSignature ASTWriter::WriteAST(Sema &SemaRef,
 
   WritingAST = false;
   if (ShouldCacheASTInMemory) {
-    // Construct MemoryBuffer and update buffer manager.
-    ModuleCache.addBuiltPCM(OutputFile,
-                            llvm::MemoryBuffer::getMemBufferCopy(
-                                StringRef(Buffer.begin(), Buffer.size())));
+    // Construct MemoryBuffer and update buffer manager. Once the output file
+    // is committed, the CompilerInstance replaces the copy with a mapping of
+    // the file.
+    ModuleCache.addWrittenPCM(OutputFile,
+                              llvm::MemoryBuffer::getMemBufferCopy(
+                                  StringRef(Buffer.begin(), Buffer.size())));
   }
   return Signature;
 }
@@ -5030,13 +5133,20 @@ ASTFileSignature ASTWriter::WriteASTCore(Sema &SemaRef, StringRef isysroot,
   // Keep writing types, declarations, and declaration update records
   // until we've emitted all of them.
   Stream.EnterSubblock(DECLTYPES_BLOCK_ID, /*bits for abbreviations*/5);
+  uint64_t DeclTypesBodyStart = Buffer.size();
+  if (PP.getHeaderSearchInfo().getHeaderSearchOpts()
+          .ModulesCompressDeclsAndTypes &&
+      llvm::zlib::isAvailable())
+    DeclTypesChunkStarts.push_back(Stream.GetCurrentBitNo());
   WriteTypeAbbrevs();
   WriteDeclAbbrevs();
   do {
+    startDeclTypesChunk();
     WriteDeclUpdatesBlocks(DeclUpdatesOffsetsRecord);
     while (!DeclTypesToEmit.empty()) {
       DeclOrType DOT = DeclTypesToEmit.front();
       DeclTypesToEmit.pop();
+      startDeclTypesChunk();
       if (DOT.isType())
         WriteType(DOT.getType());
       else
@@ -5044,6 +5154,8 @@ ASTFileSignature ASTWriter::WriteASTCore(Sema &SemaRef, StringRef isysroot,
     }
   } while (!DeclUpdates.empty());
   Stream.ExitBlock();
+  if (!DeclTypesChunkStarts.empty())
+    compressDeclTypesBlock(DeclTypesBodyStart);
 
   DoneWritingDeclsAndTypes = true;
 
@@ -5189,7 +5301,10 @@ ASTFileSignature ASTWriter::WriteASTCore(Sema &SemaRef, StringRef isysroot,
 
   // Some simple statistics
   RecordData::value_type Record[] = {
-      NumStatements, NumMacros, NumLexicalDeclContexts, NumVisibleDeclContexts};
+      NumStatements,          NumMacros,
+      NumLexicalDeclContexts, NumVisibleDeclContexts,
+      NumCompressedLookupTables, LookupTablesSize,
+      CompressedLookupTablesSize};
   Stream.EmitRecord(STATISTICS, Record);
   Stream.ExitBlock();
 
@@ -21,6 +21,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Bitstream/BitstreamReader.h"
 #include "llvm/Bitstream/BitstreamWriter.h"
 #include "llvm/Support/DJB.h"
@@ -29,11 +30,22 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
 using namespace clang;
 using namespace serialization;
 
+#define DEBUG_TYPE "global-module-index"
+
+STATISTIC(NumModuleFilesReused,
+          "The # of module files whose entry in the previous index is reused");
+STATISTIC(NumModuleFilesSameSignature,
+          "The # of rewritten module files with the signature the previous "
+          "index knows about");
+STATISTIC(NumModuleFilesRead, "The # of module files read to build the index");
+
 //----------------------------------------------------------------------------//
 // Shared constants
 //----------------------------------------------------------------------------//
@@ -59,7 +71,7 @@ namespace {
 static const char * const IndexFileName = "modules.idx";
 
 /// The global index file version.
-static const unsigned CurrentVersion = 1;
+static const unsigned CurrentVersion = 2;
 
 //----------------------------------------------------------------------------//
 // Global module index reader.
@@ -204,6 +216,10 @@ GlobalModuleIndex::GlobalModuleIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
       Modules[ID].Size = Record[Idx++];
       Modules[ID].ModTime = Record[Idx++];
 
+      // Signature of this module file at the time the global index was built.
+      for (uint32_t &Word : Modules[ID].Signature)
+        Word = Record[Idx++];
+
       // File name.
       unsigned NameLen = Record[Idx++];
       Modules[ID].FileName.assign(Record.begin() + Idx,
@@ -406,10 +422,24 @@ namespace {
         : StoredSize(Size), StoredModTime(ModTime), StoredSignature(Sig) {}
   };
 
+  /// The information the index needs about a module file, either read from
+  /// the module file or carried over from the previous index.
+  struct ModuleFileContents {
+    /// The signature of the module file, if it has one.
+    ASTFileSignature Signature;
+
+    /// The names of the module files imported by this module file, with what
+    /// it recorded about each of them.
+    std::vector<std::pair<std::string, ImportedModuleFileInfo>> Imports;
+
+    /// The identifiers known to this module file, and whether each of them
+    /// is interesting.
+    std::vector<std::pair<std::string, bool>> Identifiers;
+  };
+
   /// Builder that generates the global module index file.
   class GlobalModuleIndexBuilder {
     FileManager &FileMgr;
-    const PCHContainerReader &PCHContainerRdr;
 
     /// Mapping from files to module file information.
     typedef llvm::MapVector<const FileEntry *, ModuleFileInfo> ModuleFilesMap;
@@ -450,12 +480,12 @@ namespace {
     }
 
   public:
-    explicit GlobalModuleIndexBuilder(
-        FileManager &FileMgr, const PCHContainerReader &PCHContainerRdr)
-        : FileMgr(FileMgr), PCHContainerRdr(PCHContainerRdr) {}
+    explicit GlobalModuleIndexBuilder(FileManager &FileMgr)
+        : FileMgr(FileMgr) {}
 
-    /// Load the contents of the given module file into the builder.
-    llvm::Error loadModuleFile(const FileEntry *File);
+    /// Add the given module file, with the given contents, to the index.
+    llvm::Error addModuleFile(const FileEntry *File,
+                              const ModuleFileContents &Contents);
 
     /// Write the index to the given bitstream.
     /// \returns true if an error occurred, false otherwise.
@@ -526,16 +556,17 @@ namespace {
   };
 }
 
-llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
-  // Open the module file.
-
-  auto Buffer = FileMgr.getBufferForFile(File, /*isVolatile=*/true);
-  if (!Buffer)
-    return llvm::createStringError(Buffer.getError(),
-                                   "failed getting buffer for module file");
-
+/// Read the information the index needs out of the given module file. If
+/// \p SignatureOnly is true, only read its signature.
+///
+/// This does not touch any state shared with other threads, so that module
+/// files can be read concurrently.
+static llvm::Error readModuleFile(const PCHContainerReader &PCHContainerRdr,
+                                  const llvm::MemoryBuffer &Buffer,
+                                  ModuleFileContents &Contents,
+                                  bool SignatureOnly) {
   // Initialize the input stream
-  llvm::BitstreamCursor InStream(PCHContainerRdr.ExtractPCH(**Buffer));
+  llvm::BitstreamCursor InStream(PCHContainerRdr.ExtractPCH(Buffer));
 
   // Sniff for the signature.
   for (unsigned char C : {'C', 'P', 'C', 'H'})
@@ -546,10 +577,6 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
     } else
       return Res.takeError();
 
-  // Record this module file and assign it a unique ID (if it doesn't have
-  // one already).
-  unsigned ID = getModuleFileInfo(File).ID;
-
   // Search for the blocks and records we care about.
   enum { Other, ControlBlock, ASTBlock, DiagnosticOptionsBlock } State = Other;
   bool Done = false;
@@ -577,7 +604,7 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
       break;
 
     case llvm::BitstreamEntry::SubBlock:
-      if (Entry.ID == CONTROL_BLOCK_ID) {
+      if (Entry.ID == CONTROL_BLOCK_ID && !SignatureOnly) {
         if (llvm::Error Err = InStream.EnterSubBlock(CONTROL_BLOCK_ID))
           return Err;
 
@@ -586,7 +613,7 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
         continue;
       }
 
-      if (Entry.ID == AST_BLOCK_ID) {
+      if (Entry.ID == AST_BLOCK_ID && !SignatureOnly) {
         if (llvm::Error Err = InStream.EnterSubBlock(AST_BLOCK_ID))
           return Err;
 
@@ -652,29 +679,14 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
 
         // Retrieve the imported file name.
         unsigned Length = Record[Idx++];
-        SmallString<128> ImportedFile(Record.begin() + Idx,
-                                      Record.begin() + Idx + Length);
+        std::string ImportedFile(Record.begin() + Idx,
+                                 Record.begin() + Idx + Length);
         Idx += Length;
 
-        // Find the imported module file.
-        const FileEntry *DependsOnFile
-          = FileMgr.getFile(ImportedFile, /*OpenFile=*/false,
-                            /*CacheFailure=*/false);
-
-        if (!DependsOnFile)
-          return llvm::createStringError(std::errc::bad_file_descriptor,
-                                         "imported file \"%s\" not found",
-                                         ImportedFile.c_str());
-
-        // Save the information in ImportedModuleFileInfo so we can verify after
-        // loading all pcms.
-        ImportedModuleFiles.insert(std::make_pair(
-            DependsOnFile, ImportedModuleFileInfo(StoredSize, StoredModTime,
-                                                  StoredSignature)));
-
-        // Record the dependency.
-        unsigned DependsOnID = getModuleFileInfo(DependsOnFile).ID;
-        getModuleFileInfo(File).Dependencies.push_back(DependsOnID);
+        Contents.Imports.push_back(std::make_pair(
+            std::move(ImportedFile),
+            ImportedModuleFileInfo(StoredSize, StoredModTime,
+                                   StoredSignature)));
       }
 
       continue;
@@ -693,18 +705,19 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
                                                      DEnd = Table->data_end();
            D != DEnd; ++D) {
         std::pair<StringRef, bool> Ident = *D;
-        if (Ident.second)
-          InterestingIdentifiers[Ident.first].push_back(ID);
-        else
-          (void)InterestingIdentifiers[Ident.first];
+        Contents.Identifiers.push_back(
+            std::make_pair(Ident.first.str(), Ident.second));
       }
     }
 
     // Get Signature.
-    if (State == DiagnosticOptionsBlock && Code == SIGNATURE)
-      getModuleFileInfo(File).Signature = {
+    if (State == DiagnosticOptionsBlock && Code == SIGNATURE) {
+      Contents.Signature = {
           {{(uint32_t)Record[0], (uint32_t)Record[1], (uint32_t)Record[2],
             (uint32_t)Record[3], (uint32_t)Record[4]}}};
+      if (SignatureOnly)
+        break;
+    }
 
     // We don't care about this record.
   }
@@ -712,6 +725,46 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
   return llvm::Error::success();
 }
 
+llvm::Error
+GlobalModuleIndexBuilder::addModuleFile(const FileEntry *File,
+                                        const ModuleFileContents &Contents) {
+  // Record this module file and assign it a unique ID (if it doesn't have
+  // one already).
+  unsigned ID = getModuleFileInfo(File).ID;
+  getModuleFileInfo(File).Signature = Contents.Signature;
+
+  // Handle module dependencies.
+  for (const auto &Import : Contents.Imports) {
+    // Find the imported module file.
+    const FileEntry *DependsOnFile
+      = FileMgr.getFile(Import.first, /*OpenFile=*/false,
+                        /*CacheFailure=*/false);
+
+    if (!DependsOnFile)
+      return llvm::createStringError(std::errc::bad_file_descriptor,
+                                     "imported file \"%s\" not found",
+                                     Import.first.c_str());
+
+    // Save the information in ImportedModuleFileInfo so we can verify after
+    // loading all pcms.
+    ImportedModuleFiles.insert(std::make_pair(DependsOnFile, Import.second));
+
+    // Record the dependency.
+    unsigned DependsOnID = getModuleFileInfo(DependsOnFile).ID;
+    getModuleFileInfo(File).Dependencies.push_back(DependsOnID);
+  }
+
+  // Handle the identifier table
+  for (const auto &Ident : Contents.Identifiers) {
+    if (Ident.second)
+      InterestingIdentifiers[Ident.first].push_back(ID);
+    else
+      (void)InterestingIdentifiers[Ident.first];
+  }
+
+  return llvm::Error::success();
+}
+
 namespace {
 
 /// Trait used to generate the identifier index as an on-disk hash
@@ -796,6 +849,7 @@ bool GlobalModuleIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
     Record.push_back(M->second.ID);
     Record.push_back(M->first->getSize());
     Record.push_back(M->first->getModificationTime());
+    Record.append(M->second.Signature.begin(), M->second.Signature.end());
 
     // File name
     StringRef Name(M->first->getName());
@@ -873,10 +927,46 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
                                    "someone else is building the index");
   }
 
-  // The module index builder.
-  GlobalModuleIndexBuilder Builder(FileMgr, PCHContainerRdr);
+  // The previous index, if any. What it knows about the module files that did
+  // not change since it was built is reused rather than read again.
+  std::unique_ptr<GlobalModuleIndex> OldIndex;
+  {
+    std::pair<GlobalModuleIndex *, llvm::Error> Result = readIndex(Path);
+    consumeError(std::move(Result.second));
+    OldIndex.reset(Result.first);
+  }
+  llvm::StringMap<unsigned> OldModuleIDs;
+  if (OldIndex) {
+    for (unsigned I = 0, N = OldIndex->Modules.size(); I != N; ++I)
+      if (!OldIndex->Modules[I].FileName.empty())
+        OldModuleIDs[OldIndex->Modules[I].FileName] = I;
+  }
+
+  // The module files to index, in the order of the directory.
+  struct ModuleFileToIndex {
+    const FileEntry *File;
+
+    /// The ID of the module file in the previous index, if it has one.
+    Optional<unsigned> OldID;
+
+    /// Whether the module file is the one the previous index knows about.
+    bool Unchanged = false;
+
+    /// Whether the module file was rewritten with the same signature.
+    bool SameSignature = false;
+
+    /// The contents of the module file, while it is being read.
+    std::unique_ptr<llvm::MemoryBuffer> Buffer;
+
+    /// The contents read from the module file, unless it is unchanged.
+    ModuleFileContents Contents;
+
+    /// The error which occurred while reading the module file, if any.
+    std::string Error;
+  };
+  std::vector<ModuleFileToIndex> ModuleFilesToIndex;
 
-  // Load each of the module files.
+  // Find each of the module files.
   std::error_code EC;
   for (llvm::sys::fs::directory_iterator D(Path, EC), DEnd;
        D != DEnd && !EC;
@@ -898,11 +988,128 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
     if (!ModuleFile)
       continue;
 
-    // Load this module file.
-    if (llvm::Error Err = Builder.loadModuleFile(ModuleFile))
+    ModuleFilesToIndex.emplace_back();
+    ModuleFileToIndex &M = ModuleFilesToIndex.back();
+    M.File = ModuleFile;
+    auto Known = OldModuleIDs.find(ModuleFile->getName());
+    if (Known != OldModuleIDs.end()) {
+      M.OldID = Known->second;
+      const ModuleInfo &Info = OldIndex->Modules[Known->second];
+      M.Unchanged = Info.Size == ModuleFile->getSize() &&
+                    Info.ModTime == ModuleFile->getModificationTime();
+    }
+  }
+
+  // Open the module files that changed, or that the previous index does not
+  // know about. The file manager and its file system are not thread-safe, so
+  // this is done serially, and only the parsing is done in parallel.
+  unsigned NumToRead = 0;
+  for (ModuleFileToIndex &M : ModuleFilesToIndex) {
+    if (M.Unchanged) {
+      ++NumModuleFilesReused;
+      continue;
+    }
+    auto Buffer = FileMgr.getBufferForFile(M.File, /*isVolatile=*/true);
+    if (!Buffer)
+      return llvm::createStringError(Buffer.getError(),
+                                     "failed getting buffer for module file");
+    M.Buffer = std::move(*Buffer);
+    ++NumToRead;
+  }
+
+  // Read them in parallel. A module file that was rewritten with the same
+  // signature did not change.
+  auto ReadModuleFile = [&](ModuleFileToIndex &M) {
+    if (M.OldID) {
+      if (ASTFileSignature OldSignature =
+              OldIndex->Modules[*M.OldID].Signature) {
+        if (llvm::Error Err = readModuleFile(PCHContainerRdr, *M.Buffer,
+                                             M.Contents,
+                                             /*SignatureOnly=*/true)) {
+          M.Error = llvm::toString(std::move(Err));
+          M.Buffer.reset();
+          return;
+        }
+        if (M.Contents.Signature == OldSignature) {
+          M.Unchanged = M.SameSignature = true;
+          M.Buffer.reset();
+          return;
+        }
+      }
+    }
+
+    M.Contents = ModuleFileContents();
+    if (llvm::Error Err = readModuleFile(PCHContainerRdr, *M.Buffer,
+                                         M.Contents, /*SignatureOnly=*/false))
+      M.Error = llvm::toString(std::move(Err));
+    M.Buffer.reset();
+  };
+  if (NumToRead) {
+    llvm::ThreadPool Pool(std::min(llvm::hardware_concurrency(), NumToRead));
+    for (ModuleFileToIndex &M : ModuleFilesToIndex)
+      if (M.Buffer)
+        Pool.async([&ReadModuleFile, &M] { ReadModuleFile(M); });
+    Pool.wait();
+  }
+
+  for (ModuleFileToIndex &M : ModuleFilesToIndex) {
+    if (!M.Error.empty())
+      return llvm::createStringError(std::errc::illegal_byte_sequence,
+                                     M.Error.c_str());
+    if (M.SameSignature)
+      ++NumModuleFilesSameSignature;
+    else if (!M.Unchanged)
+      ++NumModuleFilesRead;
+  }
+
+  // The interesting identifiers of the module files which are still present
+  // and unchanged, by previous module ID. The previous index does not say
+  // which module files know about the other identifiers, so they are dropped,
+  // which does not change the result of any lookup.
+  std::vector<std::vector<StringRef>> OldIdentifiers;
+  bool ReusedOldIndex = llvm::any_of(
+      ModuleFilesToIndex, [](const ModuleFileToIndex &M) {
+        return M.Unchanged;
+      });
+  if (ReusedOldIndex && OldIndex->IdentifierIndex) {
+    OldIdentifiers.resize(OldIndex->Modules.size());
+    IdentifierIndexTable &Table =
+        *static_cast<IdentifierIndexTable *>(OldIndex->IdentifierIndex);
+    auto Key = Table.key_begin();
+    for (auto Data = Table.data_begin(), DataEnd = Table.data_end();
+         Data != DataEnd; ++Data, ++Key)
+      for (unsigned ID : *Data)
+        if (ID < OldIdentifiers.size())
+          OldIdentifiers[ID].push_back(*Key);
+  }
+
+  // Add the module files to the index in the order of the directory, so that
+  // their IDs do not depend on the order in which they were read.
+  GlobalModuleIndexBuilder Builder(FileMgr);
+  for (ModuleFileToIndex &M : ModuleFilesToIndex) {
+    if (M.Unchanged) {
+      const ModuleInfo &Info = OldIndex->Modules[*M.OldID];
+      M.Contents = ModuleFileContents();
+      M.Contents.Signature = Info.Signature;
+      for (unsigned DepID : Info.Dependencies) {
+        const ModuleInfo &Dep = OldIndex->Modules[DepID];
+        M.Contents.Imports.push_back(std::make_pair(
+            Dep.FileName,
+            ImportedModuleFileInfo(Dep.Size, Dep.ModTime, Dep.Signature)));
+      }
+      if (*M.OldID < OldIdentifiers.size())
+        for (StringRef Name : OldIdentifiers[*M.OldID])
+          M.Contents.Identifiers.push_back(std::make_pair(Name.str(), true));
+    }
+
+    if (llvm::Error Err = Builder.addModuleFile(M.File, M.Contents))
       return Err;
+    M.Contents = ModuleFileContents();
   }
 
+  OldIdentifiers.clear();
+  OldIndex.reset();
+
   // The output buffer, into which the global index will be written.
   SmallVector<char, 16> OutputBuffer;
   {
@@ -931,10 +1138,8 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
   if (Out.has_error())
     return llvm::createStringError(Out.error(), "failed writing to stream");
 
-  // Remove the old index file. It isn't relevant any more.
-  llvm::sys::fs::remove(IndexPath);
-
-  // Rename the newly-written index file to the proper name.
+  // Rename the newly-written index file over the old one. The rename is
+  // atomic, so readers see either the old index or the new one.
   if (std::error_code Err = llvm::sys::fs::rename(IndexTmpPath, IndexPath)) {
     // Remove the file on failure, don't check whether removal succeeded.
     llvm::sys::fs::remove(IndexTmpPath);
@@ -40,6 +40,32 @@ InMemoryModuleCache::addBuiltPCM(llvm::StringRef Filename,
   return *PCM.Buffer;
 }
 
+void InMemoryModuleCache::addWrittenPCM(
+    llvm::StringRef Filename, std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  addBuiltPCM(Filename, std::move(Buffer));
+  PCMs[Filename].IsWritten = true;
+}
+
+bool InMemoryModuleCache::isPCMWritten(llvm::StringRef Filename) const {
+  auto I = PCMs.find(Filename);
+  return I != PCMs.end() && I->second.IsWritten;
+}
+
+bool InMemoryModuleCache::replaceWrittenPCM(
+    llvm::StringRef Filename, std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  auto I = PCMs.find(Filename);
+  if (I == PCMs.end() || !I->second.IsWritten)
+    return false;
+
+  auto &PCM = I->second;
+  assert(PCM.IsFinal && PCM.Buffer && "Written PCM was dropped?");
+  if (PCM.Buffer->getBuffer() != Buffer->getBuffer())
+    return false;
+  PCM.Buffer = std::move(Buffer);
+  PCM.IsWritten = false;
+  return true;
+}
+
 llvm::MemoryBuffer *
 InMemoryModuleCache::lookupPCM(llvm::StringRef Filename) const {
   auto I = PCMs.find(Filename);
@@ -183,9 +183,12 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
       Buf = llvm::MemoryBuffer::getSTDIN();
     } else {
       // Get a buffer of the file and close the file descriptor when done.
+      // Module files need no null terminator, so they are always mapped and
+      // their pages are shared with the other processes importing them.
       Buf = FileMgr.getBufferForFile(NewModule->File,
                                      /*isVolatile=*/false,
-                                     /*ShouldClose=*/true);
+                                     /*ShouldClose=*/true,
+                                     /*RequiresNullTerminator=*/false);
     }
 
     if (!Buf) {
@@ -0,0 +1,239 @@
+//== CheerpPerformanceChecker.cpp ------------------------------ -*- C++ -*--=//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the cheerp.performance checkers, which find code patterns
+// that are expensive with the Cheerp memory model: byte layout unions,
+// calls between genericjs and wasm code, closure creation, dynamic_cast and
+// allocation of genericjs objects inside loops.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/TargetBuiltins.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/StaticAnalyzer/Checkers/BuiltinCheckerRegistration.h"
+#include "clang/StaticAnalyzer/Core/BugReporter/BugReporter.h"
+#include "clang/StaticAnalyzer/Core/Checker.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/AnalysisManager.h"
+#include "llvm/ADT/SmallString.h"
+
+using namespace clang;
+using namespace ento;
+
+namespace {
+
+class CheerpPerformanceChecker : public Checker<check::ASTCodeBody> {
+public:
+  enum CheckKind {
+    CK_ByteLayoutUnion,
+    CK_CrossSectionCallInLoop,
+    CK_ClosureInLoop,
+    CK_DynamicCastInLoop,
+    CK_GenericJSNewInLoop,
+    CK_NumCheckKinds
+  };
+
+  DefaultBool ChecksEnabled[CK_NumCheckKinds];
+  CheckName CheckNames[CK_NumCheckKinds];
+
+  void checkASTCodeBody(const Decl *D, AnalysisManager &AM,
+                        BugReporter &BR) const;
+
+  void report(CheckKind Kind, const Stmt *S, StringRef Name, StringRef Msg,
+              AnalysisDeclContext *ADC, BugReporter &BR) const;
+};
+
+/// Walks a function body, keeping track of how deep inside loops the current
+/// statement is.
+class LoopWalker : public RecursiveASTVisitor<LoopWalker> {
+  const CheerpPerformanceChecker &Checker;
+  BugReporter &BR;
+  AnalysisDeclContext *ADC;
+  bool CallerAsmJS;
+  unsigned LoopDepth = 0;
+
+  typedef CheerpPerformanceChecker CPC;
+
+  bool isEnabled(CPC::CheckKind Kind) const {
+    return Checker.ChecksEnabled[Kind] && LoopDepth > 0;
+  }
+
+public:
+  LoopWalker(const CheerpPerformanceChecker &Checker, BugReporter &BR,
+             AnalysisDeclContext *ADC, bool CallerAsmJS)
+      : Checker(Checker), BR(BR), ADC(ADC), CallerAsmJS(CallerAsmJS) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool TraverseForStmt(ForStmt *S) {
+    ++LoopDepth;
+    bool Ret = RecursiveASTVisitor<LoopWalker>::TraverseForStmt(S);
+    --LoopDepth;
+    return Ret;
+  }
+  bool TraverseWhileStmt(WhileStmt *S) {
+    ++LoopDepth;
+    bool Ret = RecursiveASTVisitor<LoopWalker>::TraverseWhileStmt(S);
+    --LoopDepth;
+    return Ret;
+  }
+  bool TraverseDoStmt(DoStmt *S) {
+    ++LoopDepth;
+    bool Ret = RecursiveASTVisitor<LoopWalker>::TraverseDoStmt(S);
+    --LoopDepth;
+    return Ret;
+  }
+  bool TraverseCXXForRangeStmt(CXXForRangeStmt *S) {
+    ++LoopDepth;
+    bool Ret = RecursiveASTVisitor<LoopWalker>::TraverseCXXForRangeStmt(S);
+    --LoopDepth;
+    return Ret;
+  }
+  // The body of a lambda does not run once per iteration of the loop that
+  // contains it, it is analyzed as a function of its own
+  bool TraverseLambdaExpr(LambdaExpr *E) {
+    for (Expr *Init : E->capture_inits())
+      if (Init && !TraverseStmt(Init))
+        return false;
+    return true;
+  }
+
+  bool VisitMemberExpr(MemberExpr *E);
+  bool VisitCallExpr(CallExpr *E);
+  bool VisitCXXDynamicCastExpr(CXXDynamicCastExpr *E);
+  bool VisitCXXNewExpr(CXXNewExpr *E);
+};
+
+} // end anonymous namespace
+
+bool LoopWalker::VisitMemberExpr(MemberExpr *E) {
+  if (!isEnabled(CPC::CK_ByteLayoutUnion) || CallerAsmJS)
+    return true;
+  const auto *FD = dyn_cast<FieldDecl>(E->getMemberDecl());
+  if (!FD)
+    return true;
+  const RecordDecl *RD = FD->getParent();
+  if (!RD->isUnion() && !RD->isByteLayout())
+    return true;
+  SmallString<128> Buf;
+  llvm::raw_svector_ostream OS(Buf);
+  OS << "Member '" << FD->getName() << "' of "
+     << (RD->isUnion() ? "union" : "byte layout type") << " '"
+     << RD->getName()
+     << "' is accessed inside a loop; byte layout types are backed by typed "
+        "arrays in genericjs code";
+  Checker.report(CPC::CK_ByteLayoutUnion, E, "Byte layout access in loop",
+                 OS.str(), ADC, BR);
+  return true;
+}
+
+bool LoopWalker::VisitCallExpr(CallExpr *E) {
+  if (LoopDepth == 0)
+    return true;
+  const FunctionDecl *Callee = E->getDirectCallee();
+  if (!Callee)
+    return true;
+
+  if (unsigned BuiltinID = Callee->getBuiltinID()) {
+    if (BuiltinID == Cheerp::BI__builtin_cheerp_create_closure &&
+        isEnabled(CPC::CK_ClosureInLoop))
+      Checker.report(CPC::CK_ClosureInLoop, E, "Closure creation in loop",
+                     "A new closure is created on every iteration of the loop",
+                     ADC, BR);
+    return true;
+  }
+
+  if (!isEnabled(CPC::CK_CrossSectionCallInLoop))
+    return true;
+  bool CalleeAsmJS = Callee->hasAttr<AsmJSAttr>();
+  if (CalleeAsmJS == CallerAsmJS)
+    return true;
+  SmallString<128> Buf;
+  llvm::raw_svector_ostream OS(Buf);
+  OS << "Call to " << (CalleeAsmJS ? "wasm" : "genericjs") << " function '"
+     << Callee->getName() << "' from " << (CallerAsmJS ? "wasm" : "genericjs")
+     << " code inside a loop crosses the JavaScript/WebAssembly boundary";
+  Checker.report(CPC::CK_CrossSectionCallInLoop, E, "Cross-section call in loop",
+                 OS.str(), ADC, BR);
+  return true;
+}
+
+bool LoopWalker::VisitCXXDynamicCastExpr(CXXDynamicCastExpr *E) {
+  if (isEnabled(CPC::CK_DynamicCastInLoop))
+    Checker.report(CPC::CK_DynamicCastInLoop, E, "dynamic_cast in loop",
+                   "dynamic_cast inside a loop walks the type information on "
+                   "every iteration",
+                   ADC, BR);
+  return true;
+}
+
+bool LoopWalker::VisitCXXNewExpr(CXXNewExpr *E) {
+  if (!isEnabled(CPC::CK_GenericJSNewInLoop) || CallerAsmJS)
+    return true;
+  QualType T = E->getAllocatedType();
+  if (const TagDecl *TD = T->getAsTagDecl())
+    if (TD->hasAttr<AsmJSAttr>())
+      return true;
+  Checker.report(CPC::CK_GenericJSNewInLoop, E, "genericjs allocation in loop",
+                 "A new JavaScript object is allocated on every iteration of "
+                 "the loop",
+                 ADC, BR);
+  return true;
+}
+
+void CheerpPerformanceChecker::report(CheckKind Kind, const Stmt *S,
+                                      StringRef Name, StringRef Msg,
+                                      AnalysisDeclContext *ADC,
+                                      BugReporter &BR) const {
+  PathDiagnosticLocation Location = PathDiagnosticLocation::createBegin(
+      S, BR.getSourceManager(), ADC);
+  BR.EmitBasicReport(ADC->getDecl(), CheckNames[Kind], Name,
+                     "Cheerp performance", Msg, Location,
+                     S->getSourceRange());
+}
+
+void CheerpPerformanceChecker::checkASTCodeBody(const Decl *D,
+                                                AnalysisManager &AM,
+                                                BugReporter &BR) const {
+  // These patterns are only expensive with the genericjs memory model
+  const TargetInfo &TI = AM.getASTContext().getTargetInfo();
+  if (TI.getTriple().getArch() != llvm::Triple::cheerp ||
+      TI.isByteAddressable())
+    return;
+
+  LoopWalker Walker(*this, BR, AM.getAnalysisDeclContext(D),
+                    D->hasAttr<AsmJSAttr>());
+  Walker.TraverseStmt(D->getBody());
+}
+
+void ento::registerCheerpPerformanceBase(CheckerManager &Mgr) {
+  Mgr.registerChecker<CheerpPerformanceChecker>();
+}
+
+bool ento::shouldRegisterCheerpPerformanceBase(const LangOptions &LO) {
+  return LO.CPlusPlus;
+}
+
+#define REGISTER_CHECKER(name)                                                 \
+  void ento::register##name##Checker(CheckerManager &Mgr) {                    \
+    CheerpPerformanceChecker *Checker =                                        \
+        Mgr.getChecker<CheerpPerformanceChecker>();                            \
+    Checker->ChecksEnabled[CheerpPerformanceChecker::CK_##name] = true;        \
+    Checker->CheckNames[CheerpPerformanceChecker::CK_##name] =                 \
+        Mgr.getCurrentCheckName();                                             \
+  }                                                                            \
+                                                                               \
+  bool ento::shouldRegister##name##Checker(const LangOptions &LO) {            \
+    return true;                                                               \
+  }
+
+REGISTER_CHECKER(ByteLayoutUnion)
+REGISTER_CHECKER(CrossSectionCallInLoop)
+REGISTER_CHECKER(ClosureInLoop)
+REGISTER_CHECKER(DynamicCastInLoop)
+REGISTER_CHECKER(GenericJSNewInLoop)
@@ -7,7 +7,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/AllTUsExecution.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Tooling/ToolExecutorPluginRegistry.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/VirtualFileSystem.h"
 
@@ -51,6 +54,20 @@ private:
   std::mutex Mutex;
 };
 
+/// The state a worker keeps between the TUs it processes, so that the headers
+/// shared by the TUs are only looked up once per worker.
+struct WorkerState {
+  /// The physical file system, with its own working directory, overlaid with
+  /// the mapped files.
+  IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> FS;
+  IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> MappedFS;
+  /// The directories the relative mapped files were added for.
+  llvm::StringSet<> MappedDirectories;
+  IntrusiveRefCntPtr<FileManager> Files;
+  /// The directory of the compile commands that Files was used for.
+  std::string FilesDirectory;
+};
+
 } // namespace
 
 llvm::cl::opt<std::string>
@@ -112,6 +129,42 @@ llvm::Error AllTUsToolExecutor::execute(
 
   auto &Action = Actions.front();
 
+  // Idle worker states. A task takes one, or creates one if there is none, and
+  // puts it back when done, so there are at most as many as threads.
+  std::mutex StatesMutex;
+  std::vector<std::unique_ptr<WorkerState>> IdleStates;
+  // The stats and contents of the files the workers have in common, which are
+  // the same for all of them, are only looked up and read once.
+  IntrusiveRefCntPtr<SharedFileSystemCache> SharedFiles =
+      new SharedFileSystemCache;
+  auto AcquireState = [&]() {
+    {
+      std::unique_lock<std::mutex> LockGuard(StatesMutex);
+      if (!IdleStates.empty()) {
+        std::unique_ptr<WorkerState> State = std::move(IdleStates.back());
+        IdleStates.pop_back();
+        return State;
+      }
+    }
+    auto State = llvm::make_unique<WorkerState>();
+    // Each worker gets an independent copy of a VFS to allow different
+    // concurrent working directories.
+    State->FS = new llvm::vfs::OverlayFileSystem(
+        llvm::vfs::createPhysicalFileSystem().release());
+    State->MappedFS = new llvm::vfs::InMemoryFileSystem;
+    State->FS->pushOverlay(State->MappedFS);
+    for (const auto &FileAndContent : OverlayFiles)
+      if (llvm::sys::path::is_absolute(FileAndContent.first()))
+        State->MappedFS->addFile(
+            FileAndContent.first(), 0,
+            llvm::MemoryBuffer::getMemBuffer(FileAndContent.second));
+    return State;
+  };
+  auto ReleaseState = [&](std::unique_ptr<WorkerState> State) {
+    std::unique_lock<std::mutex> LockGuard(StatesMutex);
+    IdleStates.push_back(std::move(State));
+  };
+
   {
     llvm::ThreadPool Pool(ThreadCount == 0 ? llvm::hardware_concurrency()
                                            : ThreadCount);
@@ -120,20 +173,41 @@ llvm::Error AllTUsToolExecutor::execute(
           [&](std::string Path) {
             Log("[" + std::to_string(Count()) + "/" + TotalNumStr +
                 "] Processing file " + Path);
-            // Each thread gets an indepent copy of a VFS to allow different
-            // concurrent working directories.
-            IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS =
-                llvm::vfs::createPhysicalFileSystem().release();
+            std::unique_ptr<WorkerState> State = AcquireState();
+            std::vector<CompileCommand> Commands =
+                Compilations.getCompileCommands(Path);
+            // The relative mapped files are relative to the directory of the
+            // compile command, like in ClangTool::run.
+            for (const CompileCommand &Command : Commands) {
+              if (State->MappedDirectories.count(Command.Directory) ||
+                  State->FS->setCurrentWorkingDirectory(Command.Directory))
+                continue;
+              State->MappedDirectories.insert(Command.Directory);
+              for (const auto &FileAndContent : OverlayFiles)
+                if (!llvm::sys::path::is_absolute(FileAndContent.first()))
+                  State->MappedFS->addFile(
+                      FileAndContent.first(), 0,
+                      llvm::MemoryBuffer::getMemBuffer(FileAndContent.second));
+            }
+            // The file manager caches the files by the path they were looked
+            // up with, which may be relative to the directory of the compile
+            // command. Only reuse it for commands in the same directory.
+            StringRef Directory =
+                Commands.empty() ? StringRef() : Commands.front().Directory;
+            if (!State->Files || State->FilesDirectory != Directory) {
+              State->Files = new FileManager(FileSystemOptions(), State->FS);
+              State->Files->setSharedCache(SharedFiles);
+              State->FilesDirectory = Directory;
+            }
             ClangTool Tool(Compilations, {Path},
-                           std::make_shared<PCHContainerOperations>(), FS);
+                           std::make_shared<PCHContainerOperations>(),
+                           State->FS, State->Files);
             Tool.appendArgumentsAdjuster(Action.second);
             Tool.appendArgumentsAdjuster(getDefaultArgumentsAdjusters());
-            for (const auto &FileAndContent : OverlayFiles)
-              Tool.mapVirtualFile(FileAndContent.first(),
-                                  FileAndContent.second);
             if (Tool.run(Action.first.get()))
               AppendError(llvm::Twine("Failed to run action on ") + Path +
                           "\n");
+            ReleaseState(std::move(State));
           },
           File);
     }
@@ -141,12 +215,27 @@ llvm::Error AllTUsToolExecutor::execute(
     Pool.wait();
   }
 
+  if (DiskResults)
+    if (llvm::Error Err = DiskResults->flush())
+      return Err;
+
   if (!ErrorMsg.empty())
     return make_string_error(ErrorMsg);
 
   return llvm::Error::success();
 }
 
+llvm::Error AllTUsToolExecutor::setResultsDirectory(StringRef Dir,
+                                                    unsigned NumShards) {
+  auto DiskResultsOrErr = OnDiskToolResults::create(Dir, NumShards);
+  if (!DiskResultsOrErr)
+    return DiskResultsOrErr.takeError();
+  DiskResults = DiskResultsOrErr->get();
+  Results = std::move(*DiskResultsOrErr);
+  Context = ExecutionContext(Results.get());
+  return llvm::Error::success();
+}
+
 static llvm::cl::opt<unsigned> ExecutorConcurrency(
     "execute-concurrency",
     llvm::cl::desc("The number of threads used to process all files in "
@@ -154,6 +243,13 @@ static llvm::cl::opt<unsigned> ExecutorConcurrency(
                    "This flag only applies to all-TUs."),
     llvm::cl::init(0));
 
+static llvm::cl::opt<std::string> ResultsDirectory(
+    "execute-results-dir",
+    llvm::cl::desc("Stream the tool results to files in this directory, one "
+                   "per thread, instead of keeping them in memory. "
+                   "This flag only applies to all-TUs."),
+    llvm::cl::init(""));
+
 class AllTUsToolExecutorPlugin : public ToolExecutorPlugin {
 public:
   llvm::Expected<std::unique_ptr<ToolExecutor>>
@@ -162,14 +258,24 @@ public:
       return make_string_error(
           "[AllTUsToolExecutorPlugin] Please provide a directory/file path in "
           "the compilation database.");
-    return llvm::make_unique<AllTUsToolExecutor>(std::move(OptionsParser),
-                                                 ExecutorConcurrency);
+    auto Executor = llvm::make_unique<AllTUsToolExecutor>(
+        std::move(OptionsParser), ExecutorConcurrency);
+    if (!ResultsDirectory.empty()) {
+      unsigned NumShards = ExecutorConcurrency == 0
+                               ? llvm::hardware_concurrency()
+                               : unsigned(ExecutorConcurrency);
+      if (llvm::Error Err =
+              Executor->setResultsDirectory(ResultsDirectory, NumShards))
+        return std::move(Err);
+    }
+    return std::move(Executor);
   }
 };
 
 static ToolExecutorPluginRegistry::Add<AllTUsToolExecutorPlugin>
     X("all-TUs", "Runs FrontendActions on all TUs in the compilation database. "
-                 "Tool results are stored in memory.");
+                 "Tool results are stored in memory, or streamed to disk "
+                 "with -execute-results-dir.");
 
 // This anchor is used to force the linker to link in the generated object file
 // and thus register the plugin.
@@ -0,0 +1,167 @@
+//===- ModuleDepCollector.cpp - Callbacks to collect deps -----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Tooling/DependencyScanning/ModuleDepCollector.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Serialization/ASTReader.h"
+#include "clang/Tooling/DependencyScanning/DependencyScanningWorker.h"
+#include "llvm/Support/Path.h"
+
+using namespace clang;
+using namespace tooling;
+using namespace dependencies;
+
+void ModuleDepCollectorPP::FileChanged(SourceLocation Loc,
+                                       FileChangeReason Reason,
+                                       SrcMgr::CharacteristicKind FileType,
+                                       FileID PrevFID) {
+  if (Reason != PPCallbacks::EnterFile)
+    return;
+
+  SourceManager &SM = Instance.getSourceManager();
+
+  // Dependency generation really does want to go all the way to the file entry
+  // for a source location to find out what is depended on. We do not want
+  // #line markers to affect dependency generation!
+  const FileEntry *File =
+      SM.getFileEntryForID(SM.getFileID(SM.getExpansionLoc(Loc)));
+  if (!File)
+    return;
+
+  StringRef FileName =
+      llvm::sys::path::remove_leading_dotslash(File->getName());
+
+  MDC.MainDeps.push_back(FileName);
+}
+
+void ModuleDepCollectorPP::InclusionDirective(
+    SourceLocation HashLoc, const Token &IncludeTok, StringRef FileName,
+    bool IsAngled, CharSourceRange FilenameRange, const FileEntry *File,
+    StringRef SearchPath, StringRef RelativePath, const Module *Imported,
+    SrcMgr::CharacteristicKind FileType) {
+  if (!File && !Imported) {
+    // This is a non-modular include that HeaderSearch failed to find. Add it
+    // here as `FileChanged` will never see it.
+    MDC.MainDeps.push_back(FileName);
+  }
+
+  if (Imported)
+    addDirectImport(Imported);
+}
+
+void ModuleDepCollectorPP::moduleImport(SourceLocation ImportLoc,
+                                        ModuleIdPath Path,
+                                        const Module *Imported) {
+  if (Imported)
+    addDirectImport(Imported);
+}
+
+void ModuleDepCollectorPP::addDirectImport(const Module *Imported) {
+  const Module *TopLevel = Imported->getTopLevelModule();
+  MDC.Deps[MDC.ContextHash + TopLevel->getFullModuleName()]
+      .ImportedByMainFile = true;
+  DirectDeps.insert(TopLevel);
+}
+
+void ModuleDepCollectorPP::EndOfMainFile() {
+  FileID MainFileID = Instance.getSourceManager().getMainFileID();
+  MDC.MainFile =
+      Instance.getSourceManager().getFileEntryForID(MainFileID)->getName();
+
+  for (const Module *M : DirectDeps)
+    handleTopLevelModule(M);
+
+  for (auto &&I : MDC.Deps)
+    MDC.Consumer.handleModuleDependency(I.second);
+
+  DependencyOutputOptions Opts;
+  for (auto &&I : MDC.MainDeps)
+    MDC.Consumer.handleFileDependency(Opts, I);
+}
+
+void ModuleDepCollectorPP::handleTopLevelModule(const Module *M) {
+  assert(M == M->getTopLevelModule() && "Expected top level module!");
+
+  auto ModI = MDC.Deps.insert(
+      std::make_pair(MDC.ContextHash + M->getFullModuleName(), ModuleDeps{}));
+
+  // Already visited.
+  if (!ModI.first->second.ModuleName.empty())
+    return;
+
+  ModuleDeps &MD = ModI.first->second;
+
+  const FileEntry *ModuleMap = Instance.getPreprocessor()
+                                   .getHeaderSearchInfo()
+                                   .getModuleMap()
+                                   .getContainingModuleMapFile(M);
+
+  // The module map is passed to commands which may run in another directory.
+  if (ModuleMap) {
+    SmallString<256> ModuleMapPath(ModuleMap->getName());
+    Instance.getFileManager().makeAbsolutePath(ModuleMapPath);
+    llvm::sys::path::remove_dots(ModuleMapPath, /*remove_dot_dot=*/true);
+    MD.ClangModuleMapFile = ModuleMapPath.str();
+  }
+  MD.ModuleName = M->getFullModuleName();
+  MD.ContextHash = MDC.ContextHash;
+
+  const FileEntry *ASTFile = M->getASTFile();
+  serialization::ModuleFile *MF =
+      ASTFile ? Instance.getModuleManager()->getModuleManager().lookup(ASTFile)
+              : nullptr;
+  if (MF)
+    Instance.getModuleManager()->visitInputFiles(
+        *MF, /*IncludeSystem=*/true, /*Complain=*/true,
+        [&](const serialization::InputFile &IF, bool IsSystem) {
+          // __inferred_module.map is the result of the way in which an
+          // implicit module build handles inferred modules. It adds an
+          // overlay VFS with this file in the proper directory and relies on
+          // the rest of Clang to handle it like normal. With explicitly built
+          // modules we don't need to play VFS tricks, so replace it with the
+          // correct module map.
+          if (IF.getFile()->getName().endswith("__inferred_module.map")) {
+            if (ModuleMap)
+              MD.FileDeps.insert(MD.ClangModuleMapFile);
+            return;
+          }
+          MD.FileDeps.insert(IF.getFile()->getName());
+        });
+
+  addAllSubmoduleDeps(M, MD);
+}
+
+void ModuleDepCollectorPP::addAllSubmoduleDeps(const Module *M,
+                                               ModuleDeps &MD) {
+  addModuleDep(M, MD);
+
+  for (const Module *SubM : M->submodules())
+    addAllSubmoduleDeps(SubM, MD);
+}
+
+void ModuleDepCollectorPP::addModuleDep(const Module *M, ModuleDeps &MD) {
+  for (const Module *Import : M->Imports) {
+    if (Import->getTopLevelModule() != M->getTopLevelModule()) {
+      MD.ClangModuleDeps.insert(Import->getTopLevelModuleName());
+      handleTopLevelModule(Import->getTopLevelModule());
+    }
+  }
+}
+
+ModuleDepCollector::ModuleDepCollector(CompilerInstance &I,
+                                       DependencyConsumer &C)
+    : Instance(I), Consumer(C), ContextHash(I.getInvocation().getModuleHash()) {
+  Consumer.handleContextHash(ContextHash);
+}
+
+void ModuleDepCollector::attachToPreprocessor(Preprocessor &PP) {
+  PP.addPPCallbacks(llvm::make_unique<ModuleDepCollectorPP>(Instance, *this));
+}
+
+void ModuleDepCollector::attachToASTReader(ASTReader &R) {}
@@ -9,6 +9,11 @@
 #include "clang/Tooling/Execution.h"
 #include "clang/Tooling/ToolExecutorPluginRegistry.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
 
 LLVM_INSTANTIATE_REGISTRY(clang::tooling::ToolExecutorPluginRegistry)
 
@@ -35,6 +40,127 @@ void InMemoryToolResults::forEachResult(
   }
 }
 
+struct OnDiskToolResults::Shard {
+  std::string Path;
+  std::mutex Lock;
+  std::unique_ptr<llvm::raw_fd_ostream> OS;
+};
+
+llvm::Expected<std::unique_ptr<OnDiskToolResults>>
+OnDiskToolResults::create(StringRef Dir, unsigned NumShards) {
+  assert(NumShards > 0 && "no shards");
+  if (std::error_code EC = llvm::sys::fs::create_directories(Dir))
+    return llvm::make_error<llvm::StringError>(
+        "cannot create results directory '" + Dir + "': " + EC.message(), EC);
+  std::vector<std::unique_ptr<Shard>> Shards;
+  for (unsigned I = 0; I != NumShards; ++I) {
+    auto S = llvm::make_unique<Shard>();
+    SmallString<128> Path(Dir);
+    llvm::sys::path::append(Path, "results-" + llvm::Twine(I) + ".kv");
+    S->Path = Path.str();
+    std::error_code EC;
+    S->OS = llvm::make_unique<llvm::raw_fd_ostream>(S->Path, EC,
+                                                    llvm::sys::fs::F_None);
+    if (EC)
+      return llvm::make_error<llvm::StringError>(
+          "cannot open results file '" + S->Path + "': " + EC.message(), EC);
+    Shards.push_back(std::move(S));
+  }
+  return std::unique_ptr<OnDiskToolResults>(
+      new OnDiskToolResults(std::move(Shards)));
+}
+
+OnDiskToolResults::OnDiskToolResults(std::vector<std::unique_ptr<Shard>> Shards)
+    : Shards(std::move(Shards)) {}
+
+OnDiskToolResults::~OnDiskToolResults() = default;
+
+// Each result is written as "<key size> <value size>\n<key><value>", so that
+// keys and values may contain any character.
+void OnDiskToolResults::addResult(StringRef Key, StringRef Value) {
+  Shard &S = *Shards[llvm::hash_value(Key) % Shards.size()];
+  std::unique_lock<std::mutex> LockGuard(S.Lock);
+  *S.OS << Key.size() << ' ' << Value.size() << '\n' << Key << Value;
+}
+
+llvm::Error OnDiskToolResults::flush() {
+  for (const auto &S : Shards) {
+    std::unique_lock<std::mutex> LockGuard(S->Lock);
+    S->OS->flush();
+    if (S->OS->has_error()) {
+      S->OS->clear_error();
+      return llvm::make_error<llvm::StringError>(
+          "failed to write results file '" + S->Path + "'",
+          llvm::inconvertibleErrorCode());
+    }
+  }
+  return llvm::Error::success();
+}
+
+std::vector<std::string> OnDiskToolResults::getShardPaths() const {
+  std::vector<std::string> Paths;
+  for (const auto &S : Shards)
+    Paths.push_back(S->Path);
+  return Paths;
+}
+
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+OnDiskToolResults::readShard(
+    Shard &S,
+    llvm::function_ref<void(StringRef Key, StringRef Value)> Callback) {
+  std::unique_lock<std::mutex> LockGuard(S.Lock);
+  S.OS->flush();
+  auto Buffer = llvm::MemoryBuffer::getFile(S.Path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return llvm::make_error<llvm::StringError>(
+        "cannot read results file '" + S.Path +
+            "': " + Buffer.getError().message(),
+        Buffer.getError());
+  StringRef Data = (*Buffer)->getBuffer();
+  while (!Data.empty()) {
+    size_t KeySize, ValueSize;
+    if (Data.consumeInteger(10, KeySize) || !Data.consume_front(" ") ||
+        Data.consumeInteger(10, ValueSize) || !Data.consume_front("\n") ||
+        Data.size() < KeySize + ValueSize)
+      return llvm::make_error<llvm::StringError>(
+          "malformed results file '" + S.Path + "'",
+          llvm::inconvertibleErrorCode());
+    Callback(Data.take_front(KeySize), Data.substr(KeySize, ValueSize));
+    Data = Data.drop_front(KeySize + ValueSize);
+  }
+  return std::move(*Buffer);
+}
+
+std::vector<std::pair<llvm::StringRef, llvm::StringRef>>
+OnDiskToolResults::AllKVResults() {
+  std::vector<std::pair<llvm::StringRef, llvm::StringRef>> KVResults;
+  LoadedShards.clear();
+  for (const auto &S : Shards) {
+    size_t NumResults = KVResults.size();
+    auto Buffer = readShard(*S, [&](StringRef Key, StringRef Value) {
+      KVResults.push_back({Key, Value});
+    });
+    if (!Buffer) {
+      // Drop the results that point into the buffer of the failed shard.
+      KVResults.resize(NumResults);
+      llvm::logAllUnhandledErrors(Buffer.takeError(), llvm::errs());
+      continue;
+    }
+    LoadedShards.push_back(std::move(*Buffer));
+  }
+  return KVResults;
+}
+
+void OnDiskToolResults::forEachResult(
+    llvm::function_ref<void(StringRef Key, StringRef Value)> Callback) {
+  for (const auto &S : Shards) {
+    auto Buffer = readShard(*S, Callback);
+    if (!Buffer)
+      llvm::logAllUnhandledErrors(Buffer.takeError(), llvm::errs());
+  }
+}
+
 void ExecutionContext::reportResult(StringRef Key, StringRef Value) {
   Results->addResult(Key, Value);
 }
@@ -0,0 +1,13 @@
+// Enough declarations to make each AST file bigger than 1 MB.
+#define DECL1(n) int n##a(int); int n##b(int);
+#define DECL10(n) DECL1(n##0) DECL1(n##1) DECL1(n##2) DECL1(n##3) \
+  DECL1(n##4) DECL1(n##5) DECL1(n##6) DECL1(n##7) DECL1(n##8) DECL1(n##9)
+#define DECL100(n) DECL10(n##0) DECL10(n##1) DECL10(n##2) DECL10(n##3) \
+  DECL10(n##4) DECL10(n##5) DECL10(n##6) DECL10(n##7) DECL10(n##8) DECL10(n##9)
+#define DECL1000(n) DECL100(n##0) DECL100(n##1) DECL100(n##2) DECL100(n##3) \
+  DECL100(n##4) DECL100(n##5) DECL100(n##6) DECL100(n##7) DECL100(n##8) \
+  DECL100(n##9)
+#define DECL10000(n) DECL1000(n##0) DECL1000(n##1) DECL1000(n##2) \
+  DECL1000(n##3) DECL1000(n##4) DECL1000(n##5) DECL1000(n##6) \
+  DECL1000(n##7) DECL1000(n##8) DECL1000(n##9)
+DECL10000(BULK_PREFIX)
@@ -0,0 +1,5 @@
+#define BULK_PREFIX first_
+#include "ctu-budget-bulk.h"
+
+int first(int x) { return x + 1; }
+int first_again(int x) { return x + 2; }
@@ -0,0 +1,4 @@
+#define BULK_PREFIX second_
+#include "ctu-budget-bulk.h"
+
+int second(int x) { return x + 2; }
@@ -0,0 +1,89 @@
+// RUN: %clang_analyze_cc1 -triple cheerp-leaningtech-webbrowser-genericjs %s -verify \
+// RUN: -analyzer-checker=cheerp.performance
+// RUN: %clang_analyze_cc1 -triple cheerp-leaningtech-webbrowser-genericjs %s \
+// RUN: -analyzer-checker=cheerp.performance -analyzer-output=sarif -o - \
+// RUN: | FileCheck %s --check-prefix=SARIF
+
+namespace [[cheerp::genericjs]] {
+template<class R,class T,class O>
+R* __builtin_cheerp_create_closure(T* func, O* obj);
+}
+
+union U {
+  int i;
+  float f;
+};
+
+struct [[cheerp::genericjs]] Base {
+  virtual ~Base();
+};
+
+struct [[cheerp::genericjs]] Derived : Base {
+  int x;
+};
+
+struct [[cheerp::genericjs]] Point {
+  int x, y;
+};
+
+struct [[cheerp::wasm]] Linear {
+  int x;
+};
+
+[[cheerp::wasm]] int wasmFunc(int v);
+[[cheerp::genericjs]] int genericFunc(int v);
+[[cheerp::genericjs]] void handler(Point *p, int v);
+
+[[cheerp::genericjs]] float unions(U *u, int n) {
+  float ret = u->f; // no-warning
+  for (int i = 0; i < n; i++)
+    ret += u[i].f; // expected-warning {{Member 'f' of union 'U' is accessed inside a loop; byte layout types are backed by typed arrays in genericjs code}}
+  return ret;
+}
+
+[[cheerp::genericjs]] int crossSection(int n) {
+  int ret = wasmFunc(0); // no-warning
+  for (int i = 0; i < n; i++) {
+    ret += wasmFunc(i); // expected-warning {{Call to wasm function 'wasmFunc' from genericjs code inside a loop crosses the JavaScript/WebAssembly boundary}}
+    ret += genericFunc(i); // no-warning
+  }
+  return ret;
+}
+
+[[cheerp::wasm]] int crossSectionFromWasm(int n) {
+  int ret = 0;
+  while (n--)
+    ret += genericFunc(n); // expected-warning {{Call to genericjs function 'genericFunc' from wasm code inside a loop crosses the JavaScript/WebAssembly boundary}}
+  return ret;
+}
+
+[[cheerp::genericjs]] void closures(Point *p, int n) {
+  for (int i = 0; i < n; i++)
+    __builtin_cheerp_create_closure<void>(&handler, p); // expected-warning {{A new closure is created on every iteration of the loop}}
+}
+
+[[cheerp::genericjs]] int casts(Base **objs, int n) {
+  int ret = 0;
+  for (int i = 0; i < n; i++)
+    if (Derived *d = dynamic_cast<Derived *>(objs[i])) // expected-warning {{dynamic_cast inside a loop walks the type information on every iteration}}
+      ret += d->x;
+  return ret;
+}
+
+[[cheerp::genericjs]] Point *allocations(int n) {
+  Point *p = new Point(); // no-warning
+  do {
+    p = new Point(); // expected-warning {{A new JavaScript object is allocated on every iteration of the loop}}
+    Linear *l = new Linear(); // no-warning
+  } while (--n);
+  return p;
+}
+
+[[cheerp::genericjs]] void lambdas(int n) {
+  for (int i = 0; i < n; i++) {
+    auto f = []() { return new Point(); }; // no-warning
+    f();
+  }
+}
+
+// SARIF: "ruleId": "cheerp.performance.CrossSectionCallInLoop"
@@ -15,6 +15,14 @@
 // RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
 // RUN:   -analyzer-config ctu-dir=%t/ctudir \
 // RUN:   -analyzer-config display-ctu-progress=true 2>&1 %s | FileCheck %s
+// RUN: %clang_extdef_map -binary-index=%t/ctudir/externalDefMap.bin \
+// RUN:   -merge-text-index=%S/Inputs/ctu-other.cpp.externalDefMap.txt
+// RUN: %clang_analyze_cc1 -triple x86_64-pc-linux-gnu \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir \
+// RUN:   -analyzer-config ctu-index-name=externalDefMap.bin \
+// RUN:   -verify %s
 
 // CHECK: CTU loaded AST file: {{.*}}ctu-other.cpp.ast
 // CHECK: CTU loaded AST file: {{.*}}ctu-chain.cpp.ast
@@ -0,0 +1,33 @@
+// REQUIRES: asserts
+//
+// Check the statistics of the ASTs loaded and evicted over the memory budget.
+//
+// RUN: rm -rf %t && mkdir -p %t/ctudir
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu -emit-pch \
+// RUN:   -o %t/ctudir/ctu-budget-first.c.ast %S/Inputs/ctu-budget-first.c
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu -emit-pch \
+// RUN:   -o %t/ctudir/ctu-budget-second.c.ast %S/Inputs/ctu-budget-second.c
+// RUN: cp %S/Inputs/ctu-budget.c.externalDefMap.txt \
+// RUN:   %t/ctudir/externalDefMap.txt
+// RUN: %clang_analyze_cc1 -triple x86_64-pc-linux-gnu -DCTU \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir \
+// RUN:   -analyzer-config ctu-memory-budget=1 -analyzer-stats \
+// RUN:   %S/ctu-memory-budget.c 2>&1 | FileCheck %s
+//
+// Without a budget every AST is loaded once and kept.
+// RUN: %clang_analyze_cc1 -triple x86_64-pc-linux-gnu -DCTU \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir -analyzer-stats \
+// RUN:   %S/ctu-memory-budget.c 2>&1 | FileCheck %s --check-prefix=NO-BUDGET
+
+// CHECK: ... Statistics Collected ...
+// CHECK-DAG: 3 CrossTranslationUnit - The # of AST files loaded, including reloads
+// CHECK-DAG: 2 CrossTranslationUnit - The # of ASTs unloaded because of the memory budget
+
+// NO-BUDGET: ... Statistics Collected ...
+// NO-BUDGET-NOT: The # of ASTs unloaded because of the memory budget
+// NO-BUDGET: 2 CrossTranslationUnit - The # of AST files loaded, including reloads
+// NO-BUDGET-NOT: The # of ASTs unloaded because of the memory budget
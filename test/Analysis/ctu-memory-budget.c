@@ -0,0 +1,47 @@
+// Ensure analyzer option 'ctu-memory-budget' is a recognized option.
+//
+// RUN: %clang_cc1 -analyze -analyzer-config ctu-memory-budget=1024 -verify %s
+
+// Check that the ASTs are evicted when they do not fit in the budget, and
+// loaded again when they are needed.
+//
+// RUN: rm -rf %t && mkdir -p %t/ctudir
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu -emit-pch \
+// RUN:   -o %t/ctudir/ctu-budget-first.c.ast %S/Inputs/ctu-budget-first.c
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu -emit-pch \
+// RUN:   -o %t/ctudir/ctu-budget-second.c.ast %S/Inputs/ctu-budget-second.c
+// RUN: cp %S/Inputs/ctu-budget.c.externalDefMap.txt \
+// RUN:   %t/ctudir/externalDefMap.txt
+// RUN: %clang_analyze_cc1 -triple x86_64-pc-linux-gnu -DCTU \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir \
+// RUN:   -analyzer-config ctu-memory-budget=1 -verify %s
+// RUN: %clang_analyze_cc1 -triple x86_64-pc-linux-gnu -DCTU \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir \
+// RUN:   -analyzer-config ctu-memory-budget=1 \
+// RUN:   -analyzer-config display-ctu-progress=true %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PROGRESS
+//
+// PROGRESS:      CTU loaded AST file: {{.*}}ctu-budget-first.c.ast
+// PROGRESS-NEXT: CTU loaded AST file: {{.*}}ctu-budget-second.c.ast
+// PROGRESS-NEXT: CTU evicted AST file: {{.*}}ctu-budget-first.c.ast
+// PROGRESS-NEXT: CTU loaded AST file: {{.*}}ctu-budget-first.c.ast
+// PROGRESS-NEXT: CTU evicted AST file: {{.*}}ctu-budget-second.c.ast
+
+#ifdef CTU
+void clang_analyzer_eval(int);
+int first(int);
+int second(int);
+int first_again(int);
+
+void test() {
+  clang_analyzer_eval(first(1) == 2);       // expected-warning{{TRUE}}
+  clang_analyzer_eval(second(1) == 3);      // expected-warning{{TRUE}}
+  clang_analyzer_eval(first_again(2) == 4); // expected-warning{{TRUE}}
+}
+#else
+// expected-no-diagnostics
+#endif
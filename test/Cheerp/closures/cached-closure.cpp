@@ -0,0 +1,74 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-cached-closures -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -emit-llvm -o - %s | FileCheck %s --check-prefix=NOCACHE
+
+namespace [[cheerp::genericjs]] {
+template<class R,class T,class O>
+R* __builtin_cheerp_create_closure(T* func, O* obj);
+}
+
+namespace [[cheerp::genericjs]] client
+{
+	class [[cheerp::client_layout]] Object
+	{
+	};
+
+	class EventListener : public Object
+	{
+	};
+}
+
+struct [[cheerp::genericjs]] Stateless
+{
+	void operator()(client::Object* e)
+	{
+	}
+};
+
+struct [[cheerp::genericjs]] Stateful
+{
+	int counter;
+	void onEvent(client::Object* e)
+	{
+		counter++;
+	}
+};
+
+[[cheerp::genericjs]] void invokeStateless(Stateless* s, client::Object* e)
+{
+	(*s)(e);
+}
+
+[[cheerp::genericjs]] void invokeStateful(Stateful* s, client::Object* e)
+{
+	s->onEvent(e);
+}
+
+// CHECK: @{{.*}}invokeStateless{{.*}}.cheerp.static_closure = internal global {{.*}} null
+// CHECK: @{{.*}}invokeStateful{{.*}}.cheerp.closure = internal global {{.*}} null
+// CHECK: @{{.*}}invokeStateful{{.*}}.cheerp.closure_obj = internal global %struct.Stateful* null
+
+// CHECK-LABEL: define {{.*}}getStateless
+// CHECK: load {{.*}}.cheerp.static_closure
+// CHECK: closure.create:
+// CHECK: call {{.*}} @llvm.cheerp.create.closure
+// CHECK: closure.end:
+// CHECK: phi
+
+// NOCACHE-NOT: cheerp.static_closure
+// NOCACHE-NOT: cheerp.closure_obj
+[[cheerp::genericjs]] client::EventListener* getStateless(Stateless* s)
+{
+	return __builtin_cheerp_create_closure<client::EventListener>(&invokeStateless, s);
+}
+
+// CHECK-LABEL: define {{.*}}getStateful
+// CHECK: load {{.*}}.cheerp.closure
+// CHECK: load {{.*}}.cheerp.closure_obj
+// CHECK: icmp eq %struct.Stateful*
+// CHECK: closure.create:
+// CHECK: call {{.*}} @llvm.cheerp.create.closure
+// CHECK: store {{.*}}.cheerp.closure_obj
+[[cheerp::genericjs]] client::EventListener* getStateful(Stateful* s)
+{
+	return __builtin_cheerp_create_closure<client::EventListener>(&invokeStateful, s);
+}
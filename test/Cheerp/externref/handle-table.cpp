@@ -0,0 +1,92 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-wasm -cheerp-wasm-externref -DEXTERNREF -emit-llvm -o %t.ll %s
+// RUN: FileCheck %s < %t.ll
+// RUN: FileCheck %s --check-prefix=INSERT < %t.ll
+// RUN: FileCheck %s --check-prefix=GET < %t.ll
+// RUN: FileCheck %s --check-prefix=REMOVE < %t.ll
+// RUN: FileCheck %s --check-prefix=STALE < %t.ll
+// RUN: FileCheck %s --check-prefix=GROW < %t.ll
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-wasm -cheerp-wasm-externref -DEXTERNREF -DERRORS -verify -fsyntax-only %s
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-wasm -verify -fsyntax-only %s
+
+#include <cheerpintrin.h>
+
+namespace [[cheerp::genericjs]] client
+{
+	class [[cheerp::client_layout]] Object
+	{
+	};
+
+	class HTMLElement : public Object
+	{
+	};
+}
+
+#ifdef EXTERNREF
+#ifndef __CHEERP_EXTERNREF__
+#error "__CHEERP_EXTERNREF__ is not defined"
+#endif
+
+struct [[cheerp::wasm]] Node
+{
+	cheerp::externref_handle<client::HTMLElement> handle;
+	Node* next;
+};
+
+#ifndef ERRORS
+// CHECK-LABEL: define {{.*}}@_Z5store
+// CHECK: call {{.*}}@_ZN6cheerp16externref_handleIN6client11HTMLElementEE4makeEPS2_(
+[[cheerp::wasm]] void store(Node* n, client::HTMLElement* e)
+{
+	n->handle = cheerp::externref_handle<client::HTMLElement>::make(e);
+}
+
+// CHECK-LABEL: define {{.*}}@_Z4load
+// CHECK: call {{.*}}@_ZNK6cheerp16externref_handleIN6client11HTMLElementEE3getEv(
+[[cheerp::wasm]] client::HTMLElement* load(Node* n)
+{
+	return n->handle.get();
+}
+
+// CHECK-LABEL: define {{.*}}@_Z7release
+// CHECK: call {{.*}}@_ZN6cheerp16externref_handleIN6client11HTMLElementEE7releaseEv(
+[[cheerp::wasm]] void release(Node* n)
+{
+	n->handle.release();
+}
+
+// The table is wasm code which works on the externref table directly
+// INSERT-LABEL: define linkonce_odr {{.*}}@_ZN6cheerp15externref_table6insertEPN6client6ObjectE({{.*}} section "asmjs"
+// INSERT: call void @llvm.cheerp.externref.table.set.p0s_{{.*}}Object{{.*}}(i32 %{{.*}}, %{{.*}}Object{{.*}}* %
+// INSERT: ret i32
+
+// GET-LABEL: define linkonce_odr {{.*}}@_ZN6cheerp15externref_table3getIN6client11HTMLElementEEEPT_ij({{.*}} section "asmjs"
+// GET: call void @_ZNK6cheerp15externref_table5checkEij(
+// GET: call {{.*}}HTMLElement{{.*}}* @llvm.cheerp.externref.table.get.p0s_{{.*}}HTMLElement{{.*}}(i32 %
+
+// REMOVE-LABEL: define linkonce_odr {{.*}}@_ZN6cheerp15externref_table6removeEij({{.*}} section "asmjs"
+// REMOVE: call void @_ZNK6cheerp15externref_table5checkEij(
+// REMOVE: call void @llvm.cheerp.externref.table.set.p0s_{{.*}}Object{{.*}}(i32 %{{.*}}, %{{.*}}Object{{.*}}* null)
+
+// Released and stale handles trap
+// STALE-LABEL: define linkonce_odr {{.*}}@_ZNK6cheerp15externref_table5checkEij(
+// STALE: call void @llvm.trap()
+
+// GROW-LABEL: define linkonce_odr {{.*}}@_ZN6cheerp15externref_table4growEv(
+// GROW: call i32 @llvm.cheerp.externref.table.grow(i32 %
+#else
+[[cheerp::wasm]] Node* notClient(Node* other)
+{
+	__builtin_cheerp_externref_table_set(0, other); // expected-error {{Only pointers to types declared in the 'client' namespace can be stored in the externref table}}
+	return __builtin_cheerp_externref_table_get<Node>(0); // expected-error {{Only pointers to types declared in the 'client' namespace can be loaded from the externref table}}
+}
+#endif
+#else
+#ifdef __CHEERP_EXTERNREF__
+#error "__CHEERP_EXTERNREF__ is defined"
+#endif
+
+[[cheerp::wasm]] int noExternRef()
+{
+	return __builtin_cheerp_externref_table_grow(1); // expected-error {{requires the 'externref' WebAssembly feature}}
+}
+#endif
@@ -0,0 +1,28 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-wasm -cheerp-wasm-return-calls -emit-llvm -o - %s | FileCheck %s
+// RUN: not %clang_cc1 -triple cheerp-leaningtech-webbrowser-wasm -fsyntax-only %s 2>&1 | FileCheck %s --check-prefix=NORETURNCALLS
+// RUN: not %clang_cc1 -triple cheerp-leaningtech-webbrowser-wasm -cheerp-wasm-return-calls -fsyntax-only -DGENERICJS %s 2>&1 | FileCheck %s --check-prefix=GENERICJS
+
+// NORETURNCALLS: error: Cheerp: Guaranteed tail calls require the 'returncalls' WebAssembly feature (-cheerp-wasm-enable=returncalls)
+// GENERICJS: error: Cheerp: Guaranteed tail calls are only supported in 'wasm' functions
+
+typedef int (*Handler)(const unsigned char* pc, int acc);
+extern Handler dispatch[256];
+
+// CHECK-LABEL: define {{.*}}opAdd
+// CHECK: musttail call {{.*}}(i8* {{.*}}, i32 {{.*}})
+// CHECK-NEXT: ret i32
+[[cheerp::wasm]] int opAdd(const unsigned char* pc, int acc)
+{
+	acc += pc[1];
+	pc += 2;
+	[[clang::musttail]] return dispatch[*pc](pc, acc);
+}
+
+#ifdef GENERICJS
+[[cheerp::genericjs]] int opSub(const unsigned char* pc, int acc)
+{
+	acc -= pc[1];
+	pc += 2;
+	[[clang::musttail]] return opSub(pc, acc);
+}
+#endif
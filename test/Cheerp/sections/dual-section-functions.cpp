@@ -0,0 +1,42 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-dual-section-functions -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -emit-llvm -o - %s | FileCheck %s --check-prefix=DEFAULT
+
+[[cheerp::genericjs]] inline int clampGeneric(int v, int lo, int hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+[[cheerp::wasm]] inline double lerpWasm(double a, double b, double t)
+{
+	return a + (b - a) * t;
+}
+
+[[cheerp::wasm]] int global;
+
+[[cheerp::wasm]] inline int readsGlobal(int v)
+{
+	return v + global;
+}
+
+// CHECK-LABEL: define {{.*}}@_Z10wasmCaller{{.*}} section "asmjs"
+// CHECK: call {{.*}}@_Z12clampGenericiii.cheerp.asmjs(
+// CHECK: call {{.*}}@_Z11readsGlobali(
+// DEFAULT-LABEL: define {{.*}}@_Z10wasmCaller
+// DEFAULT: call {{.*}}@_Z12clampGenericiii(
+[[cheerp::wasm]] int wasmCaller(int v)
+{
+	return clampGeneric(v, 0, 10) + readsGlobal(v);
+}
+
+// CHECK-LABEL: define {{.*}}@_Z13genericCallerd(
+// CHECK: call {{.*}}@_Z8lerpWasmddd.cheerp.genericjs(
+// DEFAULT-LABEL: define {{.*}}@_Z13genericCallerd(
+// DEFAULT: call {{.*}}@_Z8lerpWasmddd(
+[[cheerp::genericjs]] double genericCaller(double t)
+{
+	return lerpWasm(0.0, 1.0, t);
+}
+
+// CHECK-DAG: define internal {{.*}}@_Z12clampGenericiii.cheerp.asmjs({{.*}} section "asmjs"
+// CHECK-DAG: define internal {{.*}}@_Z8lerpWasmddd.cheerp.genericjs(
+// CHECK-NOT: readsGlobali.cheerp
@@ -0,0 +1,65 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-field-access-info -emit-llvm -o - %s | FileCheck %s
+
+// Accesses which can not be attributed to a single field count as reads of
+// every field, so that no field is wrongly considered as never read.
+
+struct [[cheerp::genericjs]] Inner
+{
+	int a;
+	int b;
+};
+
+struct [[cheerp::genericjs]] Outer
+{
+	int c;
+	Inner in;
+};
+
+// Aggregate copies read all the fields, including the ones of nested records
+// CHECK-DAG: !{%struct.{{.*}}Outer* null, i32 0, i32 1, i32 0, i32 0}
+// CHECK-DAG: !{%struct.{{.*}}Outer* null, i32 1, i32 1, i32 0, i32 0}
+// CHECK-DAG: !{%struct.{{.*}}Inner* null, i32 0, i32 1, i32 0, i32 0}
+// CHECK-DAG: !{%struct.{{.*}}Inner* null, i32 1, i32 1, i32 0, i32 0}
+[[cheerp::genericjs]] void copy(Outer* dst, Outer* src)
+{
+	*dst = *src;
+}
+
+struct [[cheerp::genericjs]] Base
+{
+	int x;
+};
+
+struct [[cheerp::genericjs]] Derived : Base
+{
+	int y;
+};
+
+// Accesses through member pointers may read any field, also of the bases
+// CHECK-DAG: !{%struct.{{.*}}Base* null, i32 0, i32 1, i32 0, i32 0}
+// CHECK-DAG: !{%struct.{{.*}}Derived* null, i32 {{[0-9]+}}, i32 1, i32 0, i32 0}
+[[cheerp::genericjs]] int readMember(Derived* d, int Derived::* pm)
+{
+	return d->*pm;
+}
+
+struct [[cheerp::genericjs]] HasCopy
+{
+	int z;
+	HasCopy(const HasCopy&);
+};
+
+struct [[cheerp::genericjs]] ImplicitCopy
+{
+	int arr[2];
+	HasCopy h;
+};
+
+// The arrays of the implicit copy constructor are copied without member
+// expressions, the defaulted constructor reads every field
+// CHECK-DAG: !{%struct.{{.*}}ImplicitCopy* null, i32 0, i32 {{[1-9][0-9]*}}, i32 {{[1-9][0-9]*}}, i32 0}
+// CHECK-DAG: !{%struct.{{.*}}HasCopy* null, i32 0, i32 {{[1-9][0-9]*}}, i32 0, i32 0}
+[[cheerp::genericjs]] void copyImplicit(ImplicitCopy* src)
+{
+	ImplicitCopy local(*src);
+}
@@ -0,0 +1,38 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-field-access-info -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -emit-llvm -o - %s | FileCheck %s --check-prefix=DEFAULT
+
+// CHECK-DAG: !{i32 1, !"cheerp.field.access.info", i32 1}
+// DEFAULT-NOT: cheerp.field.access
+
+struct [[cheerp::genericjs]] Point
+{
+	int x;
+	int y;
+	int unused;
+};
+
+struct [[cheerp::wasm]] Linear
+{
+	int a;
+};
+
+// Point::x is written once and read in a loop
+// CHECK-DAG: !{%struct.{{.*}}Point* null, i32 0, i32 1, i32 1, i32 1}
+// Point::y is only written
+// CHECK-DAG: !{%struct.{{.*}}Point* null, i32 1, i32 0, i32 1, i32 0}
+// CHECK-NOT: Linear* null
+
+[[cheerp::genericjs]] int sum(Point* p, int n)
+{
+	int ret = 0;
+	p->x = 1;
+	p->y = 2;
+	for(int i = 0; i < n; i++)
+		ret += p->x;
+	return ret;
+}
+
+[[cheerp::wasm]] void setLinear(Linear* l)
+{
+	l->a = 0;
+}
@@ -0,0 +1,116 @@
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-stable-shapes -verify -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -emit-llvm -o - %s | FileCheck %s --check-prefix=DEFAULT
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-stable-shapes -emit-llvm -o - %s | FileCheck %s --check-prefix=AGG
+// RUN: %clang_cc1 -triple cheerp-leaningtech-webbrowser-genericjs -cheerp-stable-shapes -emit-llvm -o - %s | FileCheck %s --check-prefix=IMPLICIT
+
+struct [[cheerp::genericjs]] Base
+{
+	int b;
+	Base(bool c)
+	{
+		if(c)
+			b = 1;
+	}
+};
+
+struct [[cheerp::genericjs]] Derived : Base
+{
+	int* p;
+	double d;
+	Derived(bool c) : Base(c)
+	{
+		if(c)
+			d = 2.0;
+	}
+};
+
+// Every field is created, in declaration order, before the body runs
+// CHECK-LABEL: define {{.*}}@_ZN7DerivedC2Eb(
+// CHECK: call {{.*}}@_ZN4BaseC2Eb(
+// CHECK: store i32* null
+// CHECK: store double 0.000000e+00
+// CHECK: br i1
+// DEFAULT-LABEL: define {{.*}}@_ZN7DerivedC2Eb(
+// DEFAULT-NOT: store i32* null
+// DEFAULT: ret void
+
+// CHECK-LABEL: define {{.*}}@_ZN4BaseC2Eb(
+// CHECK: store i32 0
+// CHECK: br i1
+
+Derived* make(bool c)
+{
+	return new Derived(c);
+}
+
+struct [[cheerp::genericjs]] VBase
+{
+	int v;
+};
+
+struct [[cheerp::genericjs]] WithVBase : virtual VBase // expected-warning {{Cheerp: Objects of type 'WithVBase' may not have a stable shape since it has virtual bases}}
+{
+	int w;
+};
+
+union [[cheerp::genericjs]] U // expected-warning 0-1 {{Cheerp: Unions are less efficient than on native targets}}
+{
+	int i;
+	float f;
+};
+
+struct [[cheerp::genericjs]] WithUnion
+{
+	U u; // expected-warning {{Cheerp: Objects of type 'WithUnion' may not have a stable shape since field 'u' is a union}}
+};
+
+struct [[cheerp::genericjs]] Point
+{
+	int x;
+	int y;
+};
+
+// Arrays and records with a trivial default constructor are cleared, records
+// with their own constructor are created by it
+// AGG-LABEL: define {{.*}}@_ZN14WithAggregatesC2Eb(
+// AGG: call void @llvm.memset
+// AGG: call void @llvm.memset
+// AGG: call {{.*}}@_ZN4BaseC1Eb(
+// AGG: br i1
+struct [[cheerp::genericjs]] WithAggregates
+{
+	int arr[4];
+	Point pt;
+	Base base;
+	WithAggregates(bool c) : base(c)
+	{
+		if(c)
+			arr[0] = 1;
+	}
+};
+
+WithAggregates* makeAggregates(bool c)
+{
+	return new WithAggregates(c);
+}
+
+struct [[cheerp::genericjs]] HasDefault
+{
+	int h;
+	HasDefault();
+};
+
+// Implicitly defined constructors create the fields too
+// IMPLICIT-LABEL: define {{.*}}@_ZN8ImplicitC2Ev(
+// IMPLICIT: store i32 0
+// IMPLICIT: call {{.*}}@_ZN10HasDefaultC1Ev(
+struct [[cheerp::genericjs]] Implicit
+{
+	int i;
+	HasDefault d;
+};
+
+Implicit* makeImplicit()
+{
+	return new Implicit;
+}
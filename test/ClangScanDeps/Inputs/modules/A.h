@@ -0,0 +1 @@
+#include "B.h"
@@ -0,0 +1 @@
+// a_only.h
@@ -0,0 +1 @@
+#include "a_only.h"
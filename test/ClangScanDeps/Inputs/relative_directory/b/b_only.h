@@ -0,0 +1 @@
+// b_only.h
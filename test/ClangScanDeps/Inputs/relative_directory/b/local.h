@@ -0,0 +1 @@
+#include "b_only.h"
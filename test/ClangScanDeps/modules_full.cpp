@@ -0,0 +1,102 @@
+// RUN: rm -rf %t.dir
+// RUN: rm -rf %t.cdb
+// RUN: mkdir -p %t.dir
+// RUN: cp %s %t.dir/modules_full.cpp
+// RUN: cp %s %t.dir/modules_full2.cpp
+// RUN: mkdir %t.dir/Inputs
+// RUN: cp %S/Inputs/modules/module.modulemap %t.dir/Inputs/module.modulemap
+// RUN: cp %S/Inputs/modules/A.h %t.dir/Inputs/A.h
+// RUN: cp %S/Inputs/modules/B.h %t.dir/Inputs/B.h
+// RUN: sed -e "s|DIR|%/t.dir|g" %S/Inputs/modules_full.json > %t.cdb
+//
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 1 \
+// RUN:   -format=experimental-full -module-files-dir %t.dir/pcms | FileCheck %s
+//
+// Each entry carries the directory its command line is run in, since the
+// flags of the translation units, like -IInputs, are kept as they are.
+//
+// The modules are deduplicated across the translation units, so the output
+// is the same regardless of the number of workers.
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 2 \
+// RUN:   -format=experimental-full -module-files-dir %t.dir/pcms | FileCheck %s
+//
+// By default the module files are built in the current directory, and their
+// paths are absolute.
+// RUN: cd %t.dir/Inputs && clang-scan-deps -compilation-database %t.cdb \
+// RUN:   -j 1 -format=experimental-full | FileCheck %s --check-prefix=CWD
+// CWD:      "-fmodule-file={{.*}}Inputs{{/|\\\\}}B-{{[A-Z0-9]+}}.pcm",
+
+#include "A.h"
+
+// CHECK:      {
+// CHECK-NEXT:   "modules": [
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-module-deps": [
+// CHECK-NEXT:         "B"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "clang-modulemap-file": "{{.*}}Inputs{{/|\\\\}}module.modulemap",
+// CHECK-NEXT:       "command-line": [
+// CHECK:              "-emit-module",
+// CHECK-NEXT:         "-fmodule-name=A",
+// CHECK-NEXT:         "-fno-implicit-modules",
+// CHECK-NEXT:         "-fno-implicit-module-maps",
+// CHECK-NEXT:         "-fmodule-file=[[PCMS:.*]]pcms{{/|\\\\}}B-[[HASH:[A-Z0-9]+]].pcm",
+// CHECK-NEXT:         "-fmodule-map-file={{.*}}Inputs{{/|\\\\}}module.modulemap",
+// CHECK-NEXT:         "-x",
+// CHECK-NEXT:         "c++",
+// CHECK-NEXT:         "{{.*}}Inputs{{/|\\\\}}module.modulemap",
+// CHECK-NEXT:         "-o",
+// CHECK-NEXT:         "[[PCMS]]pcms{{/|\\\\}}A-[[HASH]].pcm"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "context-hash": "[[HASH]]",
+// CHECK-NEXT:       "directory": "[[DIR:.*]].dir",
+// CHECK-NEXT:       "file-deps": [
+// CHECK-NEXT:         "{{.*}}Inputs{{/|\\\\}}A.h",
+// CHECK-NEXT:         "{{.*}}Inputs{{/|\\\\}}module.modulemap"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "name": "A"
+// CHECK-NEXT:     },
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-module-deps": [],
+// CHECK-NEXT:       "clang-modulemap-file": "{{.*}}Inputs{{/|\\\\}}module.modulemap",
+// CHECK-NEXT:       "command-line": [
+// CHECK:              "-fmodule-name=B",
+// CHECK:              "-o",
+// CHECK-NEXT:         "[[PCMS]]pcms{{/|\\\\}}B-[[HASH]].pcm"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "context-hash": "[[HASH]]",
+// CHECK-NEXT:       "directory": "[[DIR]].dir",
+// CHECK-NEXT:       "file-deps": [
+// CHECK-NEXT:         "{{.*}}Inputs{{/|\\\\}}B.h",
+// CHECK-NEXT:         "{{.*}}Inputs{{/|\\\\}}module.modulemap"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "name": "B"
+// CHECK-NEXT:     }
+// CHECK-NEXT:   ],
+// CHECK-NEXT:   "translation-units": [
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-context-hash": "[[HASH]]",
+// CHECK-NEXT:       "clang-module-deps": [
+// CHECK-NEXT:         "A"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "command-line": [
+// CHECK:              "-fno-implicit-modules",
+// CHECK-NEXT:         "-fno-implicit-module-maps",
+// CHECK-NEXT:         "-fmodule-file=[[PCMS]]pcms{{/|\\\\}}A-[[HASH]].pcm",
+// CHECK-NEXT:         "-fmodule-map-file={{.*}}Inputs{{/|\\\\}}module.modulemap"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "directory": "[[DIR]].dir",
+// CHECK-NEXT:       "file-deps": [
+// CHECK-NEXT:         "{{.*}}modules_full.cpp"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "input-file": "{{.*}}modules_full.cpp"
+// CHECK-NEXT:     },
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-context-hash": "[[HASH]]",
+// CHECK-NEXT:       "clang-module-deps": [
+// CHECK-NEXT:         "A"
+// CHECK-NEXT:       ],
+// CHECK:            "input-file": "{{.*}}modules_full2.cpp"
+// CHECK-NEXT:     }
+// CHECK-NEXT:   ]
+// CHECK-NEXT: }
@@ -0,0 +1,26 @@
+// RUN: rm -rf %t.dir
+// RUN: rm -rf %t.cdb
+// RUN: mkdir -p %t.dir
+// RUN: cp -r %S/Inputs/relative_directory/a %t.dir/a
+// RUN: cp -r %S/Inputs/relative_directory/b %t.dir/b
+// RUN: cp %s %t.dir/a/tu.cpp
+// RUN: cp %s %t.dir/b/tu.cpp
+// RUN: sed -e "s|DIR|%/t.dir|g" %S/Inputs/relative_directory.json > %t.cdb
+//
+// The cached file system entries are shared between the compilation
+// commands, so headers that are included using the same relative path from
+// different working directories must not be confused.
+//
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 1 | \
+// RUN:   FileCheck %s
+
+#include "local.h"
+
+// CHECK: tu.cpp
+// CHECK-NEXT: local.h
+// CHECK-NEXT: a_only.h
+// CHECK-NOT: b_only.h
+// CHECK: tu.cpp
+// CHECK-NEXT: local.h
+// CHECK-NEXT: b_only.h
+// CHECK-NOT: a_only.h
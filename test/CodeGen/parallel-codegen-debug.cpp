@@ -0,0 +1,24 @@
+// REQUIRES: x86-registered-target, linux, shell
+
+// Each global is described once in the object the partitions are linked into.
+// RUN: %clang -target x86_64-unknown-linux -c -g -fparallel-codegen=2 %s \
+// RUN:   -o %t.o
+// RUN: llvm-dwarfdump -debug-info %t.o | FileCheck %s --check-prefix=CUS
+// RUN: for NAME in global_variable counter first second third helper; do \
+// RUN:   llvm-dwarfdump -debug-info %t.o \
+// RUN:     | grep -c "DW_AT_name[[:space:]]*(\"$NAME\")"; \
+// RUN: done | FileCheck %s --check-prefix=ONCE
+// CUS-COUNT-2: DW_TAG_compile_unit
+// ONCE-COUNT-6: {{^1$}}
+// ONCE-NOT: {{.}}
+
+int global_variable;
+
+static int helper(int x) { return x * global_variable; }
+
+int first() {
+  static int counter;
+  return helper(++counter);
+}
+int second() { return helper(2); }
+int third() { return helper(3) + 1; }
@@ -0,0 +1,49 @@
+// REQUIRES: x86-registered-target
+
+// Code is generated for each symbol in exactly one partition, internal
+// symbols stay internal and comdats are kept.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux -S -fparallel-codegen=2 \
+// RUN:   -parallel-codegen-output %t.1.s %s -o %t.0.s
+// RUN: cat %t.0.s %t.1.s | FileCheck %s
+// RUN: cat %t.0.s %t.1.s | FileCheck %s --check-prefix=LOCAL
+
+// CHECK-DAG: {{^}}_Z5firstv:
+// CHECK-DAG: {{^}}_Z6secondv:
+// CHECK-DAG: {{^}}_Z5thirdv:
+// CHECK-DAG: .section .text._Z7inlinedi,"axG",@progbits,_Z7inlinedi,comdat
+// CHECK-DAG: {{^}}global_variable:
+
+// LOCAL-NOT: .globl _ZL6helperi
+// LOCAL: {{^}}_ZL6helperi:
+// LOCAL-NOT: {{^}}_ZL6helperi:
+// LOCAL-NOT: .globl _ZL6helperi
+
+// Each partition gets debug info for the code generated for it.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux -emit-obj -fparallel-codegen=2 \
+// RUN:   -debug-info-kind=limited -parallel-codegen-output %t.1.o %s -o %t.0.o
+// RUN: llvm-dwarfdump -debug-info %t.0.o | FileCheck %s --check-prefix=DEBUG
+// RUN: llvm-dwarfdump -debug-info %t.1.o | FileCheck %s --check-prefix=DEBUG
+// DEBUG: DW_TAG_compile_unit
+// DEBUG: DW_AT_name ("{{.*}}parallel-codegen.cpp")
+
+// Only the partition that defines a global variable describes it.
+// RUN: llvm-dwarfdump -debug-info %t.0.o %t.1.o \
+// RUN:   | FileCheck %s --check-prefix=DEBUG-GLOBAL
+// DEBUG-GLOBAL: DW_TAG_variable
+// DEBUG-GLOBAL-NEXT: DW_AT_name ("global_variable")
+// DEBUG-GLOBAL-NOT: DW_AT_name ("global_variable")
+
+// RUN: not %clang_cc1 -triple x86_64-unknown-linux -emit-obj \
+// RUN:   -fparallel-codegen=3 -parallel-codegen-output %t.1.o %s -o %t.0.o \
+// RUN:   2>&1 | FileCheck %s --check-prefix=OUTPUTS
+// OUTPUTS: error: '-fparallel-codegen=3' requires 2 '-parallel-codegen-output' files
+
+int global_variable;
+
+static int helper(int x) { return x * global_variable; }
+
+inline int inlined(int x) { return helper(x) + 1; }
+
+int first() { return helper(1); }
+int second() { return helper(2); }
+int third() { return inlined(3); }
@@ -0,0 +1 @@
+#warning "second input"
@@ -0,0 +1,27 @@
+// Check that -fintegrated-cc1 runs the frontend in the driver process when
+// there is a single job to execute.
+
+// RUN: %clang -fintegrated-cc1 -### -c %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=IN-PROCESS
+// IN-PROCESS: (in-process)
+// IN-PROCESS-NEXT: "-cc1"
+
+// RUN: %clang -fintegrated-cc1 -fno-integrated-cc1 -### -c %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SPAWN
+// RUN: %clang -### -c %s 2>&1 | FileCheck %s --check-prefix=SPAWN
+// SPAWN-NOT: (in-process)
+// SPAWN: "-cc1"
+
+// Compilations with several jobs keep spawning a process for each of them.
+// RUN: %clang -fintegrated-cc1 -### -c %s %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SPAWN
+
+// RUN: %clang -fintegrated-cc1 -c %s -o %t.o
+// RUN: test -f %t.o
+
+// The option is accepted without warnings when there is no compile job.
+// RUN: %clang -fintegrated-cc1 -### %t.o 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=LINK-ONLY
+// LINK-ONLY-NOT: argument unused
+
+int f(void) { return 0; }
@@ -0,0 +1,11 @@
+// The frontend emits the field access information, but the link time pass
+// is not available so the option is not forwarded to the optimizer.
+// RUN: %clang -target cheerp-leaningtech-webbrowser-genericjs -cheerp-optimize-object-shapes -### %s 2>&1 | FileCheck %s
+// CHECK: warning: '-cheerp-optimize-object-shapes' only emits field access information, the link time object shape optimization is not available in this toolchain
+// CHECK: "-cc1" {{.*}}"-cheerp-field-access-info"
+// CHECK-NOT: "-cheerp-optimize-object-shapes"
+
+// Compiling only does not need the link time pass
+// RUN: %clang -target cheerp-leaningtech-webbrowser-genericjs -cheerp-optimize-object-shapes -### -c %s 2>&1 | FileCheck %s --check-prefix=COMPILE
+// COMPILE-NOT: warning:
+// COMPILE: "-cc1" {{.*}}"-cheerp-field-access-info"
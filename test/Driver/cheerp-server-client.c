@@ -0,0 +1,12 @@
+// REQUIRES: shell
+// Without a running compile server the client compiles in process.
+// RUN: rm -f %t.sock
+// RUN: %clang --cheerp-client=%t.sock -target cheerp-leaningtech-webbrowser-genericjs -### -c %s 2>&1 | FileCheck %s
+// CHECK-NOT: cheerp-client
+// CHECK: "-cc1"
+
+// The default socket is in $XDG_RUNTIME_DIR, which is created if needed.
+// RUN: rm -rf %t.dir
+// RUN: env XDG_RUNTIME_DIR=%t.dir %clang --cheerp-client -target cheerp-leaningtech-webbrowser-genericjs -### -c %s 2>&1 | FileCheck %s
+// RUN: ls -ld %t.dir | FileCheck %s --check-prefix=PRIVATE
+// PRIVATE: drwx------
@@ -0,0 +1,53 @@
+// Check that -fparallel-codegen= writes the object of each partition to a
+// temporary file and combines them with a relocatable link.
+
+// RUN: %clang -target x86_64-unknown-linux -fparallel-codegen=2 -c %s \
+// RUN:   -o foo.o -### 2>&1 | FileCheck %s
+// CHECK: "-cc1"
+// CHECK-SAME: "-fparallel-codegen=2"
+// CHECK-SAME: "-parallel-codegen-output" "[[PART1:[^"]*foo-part1-[^"]*\.o]]"
+// CHECK-SAME: "-o" "[[PART0:[^"]*foo-part0-[^"]*\.o]]"
+// CHECK: "-r" "-o" "foo.o" "[[PART0]]" "[[PART1]]"
+
+// RUN: %clang -target x86_64-unknown-linux -fparallel-codegen=1 -c %s \
+// RUN:   -o foo.o -### 2>&1 | FileCheck %s --check-prefix=ONE
+// ONE-NOT: warning:
+// ONE-NOT: "-fparallel-codegen
+// ONE-NOT: "-r"
+
+// Only ELF objects written to a file are generated in parallel; otherwise the
+// option is dropped with a warning.
+// RUN: %clang -target x86_64-unknown-linux -fparallel-codegen=2 -S %s \
+// RUN:   -o foo.s -### 2>&1 | FileCheck %s --check-prefix=ASM
+// ASM: warning: ignoring '-fparallel-codegen=2' option when not generating an object file
+// ASM-NOT: "-fparallel-codegen
+// ASM-NOT: "-r"
+
+// RUN: %clang -target x86_64-unknown-linux -fparallel-codegen=2 -c %s \
+// RUN:   -gsplit-dwarf -o foo.o -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SPLIT-DWARF
+// SPLIT-DWARF: warning: ignoring '-fparallel-codegen=2' option with split DWARF
+// SPLIT-DWARF-NOT: "-fparallel-codegen
+// SPLIT-DWARF-NOT: "-r"
+
+// RUN: %clang -target x86_64-unknown-linux -fparallel-codegen=2 -c %s \
+// RUN:   -o - -### 2>&1 | FileCheck %s --check-prefix=STDOUT
+// STDOUT: warning: ignoring '-fparallel-codegen=2' option when writing the object to standard output
+// STDOUT-NOT: "-fparallel-codegen
+// STDOUT-NOT: "-r"
+
+// RUN: %clang -target x86_64-apple-darwin -fparallel-codegen=2 -c %s \
+// RUN:   -o foo.o -### 2>&1 | FileCheck %s --check-prefix=MACHO
+// MACHO: warning: optimization flag '-fparallel-codegen=2' is not supported for target 'x86_64-apple-{{.*}}'
+// MACHO-NOT: "-fparallel-codegen
+// MACHO-NOT: "-r"
+
+// RUN: %clang -target cheerp-leaningtech-webbrowser-genericjs \
+// RUN:   -fparallel-codegen=2 -c %s -o foo.bc -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=CHEERP
+// CHEERP: warning: optimization flag '-fparallel-codegen=2' is not supported for target 'cheerp-leaningtech-webbrowser-genericjs'
+// CHEERP-NOT: "-fparallel-codegen
+
+// RUN: %clang -target x86_64-unknown-linux -fparallel-codegen=0 -c %s \
+// RUN:   -### 2>&1 | FileCheck %s --check-prefix=INVALID
+// INVALID: error: invalid integral value '0' in '-fparallel-codegen=0'
@@ -0,0 +1,29 @@
+// Check that -parallel-jobs= runs the jobs of independent inputs in parallel
+// while keeping their diagnostics in the order of the command line.
+
+// RUN: %clang -parallel-jobs=4 -fsyntax-only %s \
+// RUN:   %S/Inputs/parallel-jobs-second.c 2>&1 | FileCheck %s
+// RUN: %clang -parallel-jobs=0 -fsyntax-only %s \
+// RUN:   %S/Inputs/parallel-jobs-second.c 2>&1 | FileCheck %s
+// CHECK: warning: "first input"
+// CHECK: warning: "second input"
+
+// The -v output of each command is printed with the output of its job.
+// RUN: %clang -v -parallel-jobs=4 -fsyntax-only %s \
+// RUN:   %S/Inputs/parallel-jobs-second.c 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=VERBOSE
+// VERBOSE: "-cc1"
+// VERBOSE-SAME: parallel-jobs.c
+// VERBOSE: warning: "first input"
+// VERBOSE: "-cc1"
+// VERBOSE-SAME: parallel-jobs-second.c
+// VERBOSE: warning: "second input"
+
+// The option is claimed, so no unused argument warning is printed.
+// RUN: %clang -parallel-jobs=4 -### -c %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=CLAIMED
+// RUN: %clang -parallel-jobs=4 -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=CLAIMED
+// CLAIMED-NOT: argument unused
+
+#warning "first input"
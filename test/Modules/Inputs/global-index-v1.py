@@ -0,0 +1,56 @@
+# Write a global module index in the format of version 1, which only holds
+# the index metadata record.
+import sys
+
+bits = []
+
+def emit(value, width):
+    for i in range(width):
+        bits.append((value >> i) & 1)
+
+def emit_vbr(value, width):
+    threshold = 1 << (width - 1)
+    while value >= threshold:
+        emit((value & (threshold - 1)) | threshold, width)
+        value >>= width - 1
+    emit(value, width)
+
+def align32():
+    while len(bits) % 32:
+        bits.append(0)
+
+for c in b'BCGI':
+    emit(c if isinstance(c, int) else ord(c), 8)
+
+# ENTER_SUBBLOCK of GLOBAL_INDEX_BLOCK_ID, with 3 bit abbreviation IDs.
+emit(1, 2)
+emit_vbr(8, 8)
+emit_vbr(3, 4)
+align32()
+length_pos = len(bits)
+emit(0, 32)
+body_start = len(bits)
+
+# UNABBREV_RECORD INDEX_METADATA [1]
+emit(3, 3)
+emit_vbr(0, 6)
+emit_vbr(1, 6)
+emit_vbr(1, 6)
+
+# END_BLOCK
+emit(0, 3)
+align32()
+
+words = (len(bits) - body_start) // 32
+for i in range(32):
+    bits[length_pos + i] = (words >> i) & 1
+
+data = bytearray()
+for i in range(0, len(bits), 8):
+    byte = 0
+    for j in range(8):
+        byte |= bits[i + j] << j
+    data.append(byte)
+
+with open(sys.argv[1], 'wb') as f:
+    f.write(bytes(data))
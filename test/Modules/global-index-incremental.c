@@ -0,0 +1,93 @@
+// REQUIRES: asserts, shell
+//
+// Check that rebuilding the global module index reuses what the previous index
+// knows about the module files which did not change.
+//
+// RUN: rm -rf %t && mkdir -p %t/Inputs
+// RUN: for M in A B C D E F; do \
+// RUN:   echo "module $M { header \"$M.h\" }" >> %t/Inputs/module.modulemap; \
+// RUN:   echo "int ${M}_name;" > %t/Inputs/$M.h; \
+// RUN: done
+//
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t/Inputs -fsyntax-only \
+// RUN:   -print-stats -DIMPORT_A -DIMPORT_B %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=FIRST
+// FIRST: Statistics Collected
+// FIRST-NOT: global-module-index{{ +}}- The # of module files whose entry
+// FIRST: {{^ *}}2 global-module-index{{ +}}- The # of module files read
+//
+// An unchanged module file is reused.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t/Inputs -fsyntax-only \
+// RUN:   -print-stats -DIMPORT_C %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=UNCHANGED
+// UNCHANGED: Statistics Collected
+// UNCHANGED-DAG: {{^ *}}2 global-module-index{{ +}}- The # of module files whose entry
+// UNCHANGED-DAG: {{^ *}}1 global-module-index{{ +}}- The # of module files read
+// RUN: grep C_name %t/cache/modules.idx
+//
+// A module file rewritten with the same signature is reused too.
+// RUN: touch -m -t 200001010000 %t/cache/A.pcm
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t/Inputs -fsyntax-only \
+// RUN:   -print-stats -DIMPORT_D %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SAME-SIGNATURE
+// SAME-SIGNATURE: Statistics Collected
+// SAME-SIGNATURE-DAG: {{^ *}}2 global-module-index{{ +}}- The # of module files whose entry
+// SAME-SIGNATURE-DAG: {{^ *}}1 global-module-index{{ +}}- The # of module files read
+// SAME-SIGNATURE-DAG: {{^ *}}1 global-module-index{{ +}}- The # of rewritten module files
+//
+// A module file which changed is read again.
+// RUN: echo "int B_changed_name;" >> %t/Inputs/B.h
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t/Inputs -fsyntax-only \
+// RUN:   -print-stats -DIMPORT_B %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=CHANGED
+// CHANGED: Statistics Collected
+// CHANGED-DAG: {{^ *}}3 global-module-index{{ +}}- The # of module files whose entry
+// CHANGED-DAG: {{^ *}}1 global-module-index{{ +}}- The # of module files read
+// RUN: grep B_changed_name %t/cache/modules.idx
+//
+// The identifiers of a module file which was removed are dropped.
+// RUN: rm %t/cache/C.pcm
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t/Inputs -fsyntax-only \
+// RUN:   -print-stats -DIMPORT_E %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=REMOVED
+// REMOVED: Statistics Collected
+// REMOVED-DAG: {{^ *}}3 global-module-index{{ +}}- The # of module files whose entry
+// REMOVED-DAG: {{^ *}}1 global-module-index{{ +}}- The # of module files read
+// RUN: not grep C_name %t/cache/modules.idx
+// RUN: grep A_name %t/cache/modules.idx
+//
+// An index in the format of version 1 is discarded, and all the module files
+// are read again.
+// RUN: %python %S/Inputs/global-index-v1.py %t/cache/modules.idx
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fdisable-module-hash \
+// RUN:   -fmodules-cache-path=%t/cache -I %t/Inputs -fsyntax-only \
+// RUN:   -print-stats -DIMPORT_F %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=VERSION1
+// VERSION1: Statistics Collected
+// VERSION1-NOT: global-module-index{{ +}}- The # of module files whose entry
+// VERSION1: {{^ *}}5 global-module-index{{ +}}- The # of module files read
+// VERSION1-NOT: global-module-index{{ +}}- The # of module files whose entry
+
+#ifdef IMPORT_A
+#include "A.h"
+#endif
+#ifdef IMPORT_B
+#include "B.h"
+#endif
+#ifdef IMPORT_C
+#include "C.h"
+#endif
+#ifdef IMPORT_D
+#include "D.h"
+#endif
+#ifdef IMPORT_E
+#include "E.h"
+#endif
+#ifdef IMPORT_F
+#include "F.h"
+#endif
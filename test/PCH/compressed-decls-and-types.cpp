@@ -0,0 +1,46 @@
+// REQUIRES: zlib
+//
+// RUN: %clang_cc1 -x c++-header -std=c++11 -emit-pch \
+// RUN:   -fmodules-compress-decls-and-types -o %t.compressed.pch %s
+// RUN: %clang_cc1 -std=c++11 -include-pch %t.compressed.pch -fsyntax-only \
+// RUN:   -verify -print-stats %s 2>&1 | FileCheck %s
+//
+// RUN: %clang_cc1 -x c++-header -std=c++11 -emit-pch -o %t.pch %s
+// RUN: %clang_cc1 -std=c++11 -include-pch %t.pch -fsyntax-only -verify \
+// RUN:   -print-stats %s 2>&1 | FileCheck --check-prefix=PLAIN %s
+
+// Only the chunks with the declarations that are used are decompressed.
+// CHECK: {{[1-9][0-9]*}}/{{[1-9][0-9]*}} declaration and type chunks decompressed
+// CHECK: {{[1-9][0-9]*}} bytes of declarations and types compressed to {{[1-9][0-9]*}}
+// CHECK: {{[1-9][0-9]*}} bytes decompressed, {{[1-9][0-9]*}} bytes skipped
+// PLAIN-NOT: declaration and type chunks
+
+#ifndef HEADER
+#define HEADER
+
+#define S(N)                                                                   \
+  struct record_with_a_long_name_##N {                                         \
+    int first, second;                                                         \
+    constexpr int sum() const { return first + second + N; }                   \
+  };                                                                           \
+  constexpr int function_with_a_long_name_##N(int x) {                         \
+    return record_with_a_long_name_##N{x, N % 7}.sum();                        \
+  }
+#define S10(N) S(N##0) S(N##1) S(N##2) S(N##3) S(N##4) \
+               S(N##5) S(N##6) S(N##7) S(N##8) S(N##9)
+#define S100(N) S10(N##0) S10(N##1) S10(N##2) S10(N##3) S10(N##4) \
+                S10(N##5) S10(N##6) S10(N##7) S10(N##8) S10(N##9)
+
+// Large enough to be split into several chunks.
+S100(1)
+S100(2)
+S100(3)
+S100(4)
+
+#else
+
+// expected-no-diagnostics
+static_assert(function_with_a_long_name_100(1) == 103, "");
+static_assert(function_with_a_long_name_499(2) == 503, "");
+
+#endif
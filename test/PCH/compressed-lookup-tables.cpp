@@ -0,0 +1,42 @@
+// REQUIRES: zlib
+//
+// RUN: %clang_cc1 -x c++-header -emit-pch -fmodules-compress-lookup-tables \
+// RUN:   -o %t.compressed.pch %s
+// RUN: %clang_cc1 -include-pch %t.compressed.pch -fsyntax-only -verify \
+// RUN:   -print-stats %s 2>&1 | FileCheck %s
+//
+// RUN: %clang_cc1 -x c++-header -emit-pch -o %t.pch %s
+// RUN: %clang_cc1 -include-pch %t.pch -fsyntax-only -verify -print-stats %s \
+// RUN:   2>&1 | FileCheck --check-prefix=PLAIN %s
+
+// Only the lexical and the visible lookup tables of the namespace are large
+// enough to be compressed, and both are needed by the lookups.
+// CHECK: 2/2 compressed lookup tables decompressed
+// CHECK: {{[1-9][0-9]*}} bytes of lookup tables compressed to {{[1-9][0-9]*}}
+// CHECK: {{[1-9][0-9]*}} bytes decompressed, 0 bytes skipped
+// PLAIN-NOT: compressed lookup tables
+
+#ifndef HEADER
+#define HEADER
+
+#define F(N) int function_with_a_long_name_##N();
+#define F10(N) F(N##0) F(N##1) F(N##2) F(N##3) F(N##4) \
+               F(N##5) F(N##6) F(N##7) F(N##8) F(N##9)
+#define F100(N) F10(N##0) F10(N##1) F10(N##2) F10(N##3) F10(N##4) \
+                F10(N##5) F10(N##6) F10(N##7) F10(N##8) F10(N##9)
+
+// Large enough for its lookup tables to be compressed.
+namespace large {
+F100(1)
+F100(2)
+}
+
+#else
+
+// expected-no-diagnostics
+int use() {
+  return large::function_with_a_long_name_100() +
+         large::function_with_a_long_name_299();
+}
+
+#endif
@@ -0,0 +1,35 @@
+// Check that the persistent header lookup cache does not hide headers which
+// are added or moved without changing the modification times of the search
+// directories.
+//
+// RUN: rm -rf %t && mkdir -p %t/a/sub %t/b/sub %t/c
+// RUN: echo 'int sub_from_b;' > %t/b/sub/shadow.h
+// RUN: echo 'int moved;' > %t/b/moved.h
+// RUN: touch -m -t 200001010000 %t/a %t/b %t/c
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b -I %t/c \
+// RUN:   -fheader-lookup-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck --check-prefixes=SUB-B,MOVED-B,MISS %s
+//
+// Adding a header to a subdirectory leaves the search directory unchanged,
+// so the lookups of names with a directory component are not cached.
+// RUN: echo 'int sub_from_a;' > %t/a/sub/shadow.h
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b -I %t/c \
+// RUN:   -fheader-lookup-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck --check-prefixes=SUB-A,MOVED-B,HIT %s
+//
+// A header which is no longer where it was found is looked up again.
+// RUN: mv %t/b/moved.h %t/c/moved.h
+// RUN: touch -m -t 200001010000 %t/b %t/c
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b -I %t/c \
+// RUN:   -fheader-lookup-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck --check-prefixes=SUB-A,MOVED-C,MISS %s
+
+#include <sub/shadow.h>
+#include <moved.h>
+
+// SUB-A: int sub_from_a;
+// SUB-B: int sub_from_b;
+// MOVED-B: {{[/\\]}}b{{[/\\]}}moved.h"
+// MOVED-C: {{[/\\]}}c{{[/\\]}}moved.h"
+// MISS: 0 lookups shortened by the persistent lookup cache.
+// HIT: 1 lookups shortened by the persistent lookup cache.
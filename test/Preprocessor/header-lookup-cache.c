@@ -0,0 +1,28 @@
+// RUN: rm -rf %t && mkdir -p %t/a %t/b
+// RUN: echo 'int from_b;' > %t/b/lookup.h
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b \
+// RUN:   -fheader-lookup-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck --check-prefixes=B,MISS %s
+// RUN: ls %t/cache | FileCheck --check-prefix=FILE %s
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b \
+// RUN:   -fheader-lookup-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck --check-prefixes=B,HIT %s
+//
+// Adding a header to a search directory invalidates the cache.
+// RUN: echo 'int from_a;' > %t/a/lookup.h
+// RUN: touch -m -t 200001010000 %t/a
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b \
+// RUN:   -fheader-lookup-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck --check-prefixes=A,MISS %s
+//
+// RUN: %clang -### -fheader-lookup-cache-path=%t/cache -c %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=DRIVER %s
+
+#include <lookup.h>
+
+// A: int from_a;
+// B: int from_b;
+// MISS: 0 lookups shortened by the persistent lookup cache.
+// HIT: 1 lookups shortened by the persistent lookup cache.
+// FILE: {{[0-9a-f]+}}.hlc
+// DRIVER: "-cc1"{{.*}} "-fheader-lookup-cache-path={{.*}}cache"
@@ -0,0 +1,93 @@
+// RUN: %clang_cc1 -verify -fsyntax-only %s
+
+int ReturnsInt1();
+int Func1() {
+  [[clang::musttail]] ReturnsInt1(); // expected-error {{'musttail' attribute only applies to return statements}}
+  [[clang::musttail]] return 5;      // expected-error {{'musttail' attribute requires that the return value is the result of a function call}}
+  [[clang::musttail]] return ReturnsInt1();
+}
+
+void NoParams();
+void TakesInt(int);
+void Func2() {
+  [[clang::musttail]] return TakesInt(1); // expected-error {{cannot perform a tail call to function 'TakesInt' because its signature is incompatible with the calling function}} expected-note {{number of parameters differ}}
+}
+
+long ReturnsLong();
+int Func3() {
+  [[clang::musttail]] return ReturnsLong(); // expected-error {{cannot perform a tail call to function 'ReturnsLong' because its signature is incompatible with the calling function}} expected-note {{return types differ}}
+}
+
+void TakesLong(long);
+void Func4(int x) {
+  [[clang::musttail]] return TakesLong(x); // expected-error {{cannot perform a tail call to function 'TakesLong' because its signature is incompatible with the calling function}} expected-note {{parameter types differ}}
+}
+
+void Func5(int x) {
+  void (*Fptr)(int) = TakesInt;
+  [[clang::musttail]] return Fptr(x);
+}
+
+struct HasNonTrivialDtor {
+  ~HasNonTrivialDtor();
+};
+int TakesTemporary(const HasNonTrivialDtor &);
+int Func6(const HasNonTrivialDtor &x) {
+  [[clang::musttail]] return TakesTemporary(HasNonTrivialDtor()); // expected-error {{'musttail' attribute does not allow temporaries with non-trivial destructors in the call arguments}}
+}
+
+struct Foo {
+  int MemberFunction(int);
+  static int StaticFunction(int);
+  int OtherMember(int x) {
+    [[clang::musttail]] return MemberFunction(x);
+  }
+  int CallsStatic(int x) {
+    [[clang::musttail]] return StaticFunction(x); // expected-error {{cannot perform a tail call to function 'StaticFunction' because its signature is incompatible with the calling function}} expected-note {{member function kinds differ}}
+  }
+};
+
+struct Bar {
+  int MemberFunction(int);
+  int CallsOtherClass(Foo &f, int x) {
+    [[clang::musttail]] return f.MemberFunction(x); // expected-error {{cannot perform a tail call to function 'MemberFunction' because its signature is incompatible with the calling function}} expected-note {{member function classes differ}}
+  }
+};
+
+int Func7(Foo &f, int (Foo::*p)(int), int x) {
+  [[clang::musttail]] return (f.*p)(x); // expected-error {{'musttail' attribute is not supported on calls through member pointers}}
+}
+
+template <class T>
+T TemplateFunc(T x) {
+  [[clang::musttail]] return TemplateFunc<T>(x);
+}
+int Func8(int x) {
+  return TemplateFunc(x);
+}
+
+// The signatures can only be compared once the template is instantiated
+template <class T>
+T TemplateMismatch(int x) {
+  [[clang::musttail]] return ReturnsLong(); // expected-error {{cannot perform a tail call to function 'ReturnsLong' because its signature is incompatible with the calling function}} expected-note {{number of parameters differ}}
+}
+long Func9(int x) {
+  return TemplateMismatch<long>(x); // expected-note {{in instantiation of function template specialization 'TemplateMismatch<long>' requested here}}
+}
+
+long TakesIntReturnsLong(int);
+template <class T>
+T TemplateReturnMismatch(int x) {
+  [[clang::musttail]] return TakesIntReturnsLong(x); // expected-error {{cannot perform a tail call to function 'TakesIntReturnsLong' because its signature is incompatible with the calling function}} expected-note {{return types differ}}
+}
+long Func10(int x) {
+  return TemplateReturnMismatch<long>(x) + TemplateReturnMismatch<int>(x); // expected-note {{in instantiation of function template specialization 'TemplateReturnMismatch<int>' requested here}}
+}
+
+template <class T>
+int DependentTemporary(int x) {
+  [[clang::musttail]] return TakesTemporary(T()); // expected-error {{'musttail' attribute does not allow temporaries with non-trivial destructors in the call arguments}}
+}
+int Func11(int x) {
+  return DependentTemporary<HasNonTrivialDtor>(x); // expected-note {{in instantiation of function template specialization 'DependentTemporary<HasNonTrivialDtor>' requested here}}
+}
@@ -2002,6 +2002,7 @@ int perform_test_load_source(int argc, const char **argv,
   unsigned Repeats = 0;
   unsigned I;
   const char *InvocationPath;
+  const char *PreambleStorePath;
 
   Idx = clang_createIndex(/* excludeDeclsFromPCH */
                           (!strcmp(filter, "local") ||
@@ -2013,6 +2014,9 @@ int perform_test_load_source(int argc, const char **argv,
   InvocationPath = getenv("CINDEXTEST_INVOCATION_EMISSION_PATH");
   if (InvocationPath)
     clang_CXIndex_setInvocationEmissionPathOption(Idx, InvocationPath);
+  PreambleStorePath = getenv("CINDEXTEST_PREAMBLE_STORE");
+  if (PreambleStorePath)
+    clang_CXIndex_setPreambleStoreOption(Idx, PreambleStorePath, 0);
 
   if ((CommentSchemaFile = parse_comments_schema(argc, argv))) {
     argc--;
@@ -2078,10 +2082,14 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
   int trial;
   int remap_after_trial = 0;
   char *endptr = 0;
+  const char *PreambleStorePath;
   
   Idx = clang_createIndex(/* excludeDeclsFromPCH */
                           !strcmp(filter, "local") ? 1 : 0,
                           /* displayDiagnostics=*/1);
+  PreambleStorePath = getenv("CINDEXTEST_PREAMBLE_STORE");
+  if (PreambleStorePath)
+    clang_CXIndex_setPreambleStoreOption(Idx, PreambleStorePath, 0);
   
   if (parse_remapped_files(argc, argv, 0, &unsaved_files, &num_unsaved_files)) {
     clang_disposeIndex(Idx);
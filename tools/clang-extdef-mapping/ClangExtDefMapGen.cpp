@@ -19,6 +19,7 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Signals.h"
 #include <sstream>
@@ -31,12 +32,46 @@ using namespace clang::tooling;
 
 static cl::OptionCategory ClangExtDefMapGenCategory("clang-extdefmapgen options");
 
+static cl::opt<std::string> BinaryIndex(
+    "binary-index",
+    cl::desc("Write the definitions of all the processed sources to <file> "
+             "as an on-disk hash table, instead of printing them as text"),
+    cl::value_desc("file"), cl::cat(ClangExtDefMapGenCategory));
+
+static cl::list<std::string> MergeTextIndex(
+    "merge-text-index",
+    cl::desc("Add the definitions listed in a textual index to the binary "
+             "index. Allows converting a merged textual index without "
+             "processing any sources."),
+    cl::value_desc("file"), cl::cat(ClangExtDefMapGenCategory));
+
+/// The definitions collected for -binary-index. Names defined in more than
+/// one file are left out of the index, like when merging textual indexes.
+static llvm::StringMap<std::string> CombinedIndex;
+static llvm::StringSet<> AmbiguousNames;
+
+static void addToCombinedIndex(const llvm::StringMap<std::string> &Index) {
+  for (const auto &E : Index) {
+    if (AmbiguousNames.count(E.getKey()))
+      continue;
+    auto Inserted = CombinedIndex.try_emplace(E.getKey(), E.getValue());
+    if (!Inserted.second && Inserted.first->getValue() != E.getValue()) {
+      CombinedIndex.erase(Inserted.first);
+      AmbiguousNames.insert(E.getKey());
+    }
+  }
+}
+
 class MapExtDefNamesConsumer : public ASTConsumer {
 public:
   MapExtDefNamesConsumer(ASTContext &Context)
       : Ctx(Context), SM(Context.getSourceManager()) {}
 
   ~MapExtDefNamesConsumer() {
+    if (!BinaryIndex.empty()) {
+      addToCombinedIndex(Index);
+      return;
+    }
     // Flush results to standard output.
     llvm::outs() << createCrossTUIndexString(Index);
   }
@@ -117,8 +152,36 @@ int main(int argc, const char **argv) {
   CommonOptionsParser OptionsParser(argc, argv, ClangExtDefMapGenCategory,
                                     cl::ZeroOrMore, Overview);
 
-  ClangTool Tool(OptionsParser.getCompilations(),
-                 OptionsParser.getSourcePathList());
+  int Result = 0;
+  // Without sources there is no compilation database either.
+  if (!OptionsParser.getSourcePathList().empty()) {
+    ClangTool Tool(OptionsParser.getCompilations(),
+                   OptionsParser.getSourcePathList());
+    Result = Tool.run(newFrontendActionFactory<MapExtDefNamesAction>().get());
+  }
+
+  if (BinaryIndex.empty()) {
+    if (!MergeTextIndex.empty()) {
+      llvm::errs() << "error: -merge-text-index requires -binary-index\n";
+      return 1;
+    }
+    return Result;
+  }
 
-  return Tool.run(newFrontendActionFactory<MapExtDefNamesAction>().get());
+  for (const std::string &TextIndex : MergeTextIndex) {
+    llvm::Expected<llvm::StringMap<std::string>> IndexOrErr =
+        parseCrossTUIndex(TextIndex, "");
+    if (!IndexOrErr) {
+      llvm::errs() << "error: cannot read '" << TextIndex
+                   << "': " << llvm::toString(IndexOrErr.takeError());
+      return 1;
+    }
+    addToCombinedIndex(*IndexOrErr);
+  }
+  if (llvm::Error Err = writeCrossTUIndexTable(CombinedIndex, BinaryIndex)) {
+    llvm::errs() << "error: cannot write '" << BinaryIndex
+                 << "': " << llvm::toString(std::move(Err)) << "\n";
+    return 1;
+  }
+  return Result;
 }
@@ -6,15 +6,20 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "clang/Driver/Types.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/DependencyScanning/DependencyScanningWorker.h"
 #include "clang/Tooling/JSONCompilationDatabase.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Options.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Threading.h"
+#include <map>
 #include <mutex>
 #include <thread>
 
@@ -37,42 +42,271 @@ private:
   raw_ostream &OS;
 };
 
+static bool isInputFile(const tooling::CompileCommand &Command,
+                        StringRef Arg) {
+  if (Arg == Command.Filename)
+    return true;
+  SmallString<256> AbsArg(Arg), AbsFilename(Command.Filename);
+  llvm::sys::fs::make_absolute(Command.Directory, AbsArg);
+  llvm::sys::fs::make_absolute(Command.Directory, AbsFilename);
+  llvm::sys::path::remove_dots(AbsArg, /*remove_dot_dot=*/true);
+  llvm::sys::path::remove_dots(AbsFilename, /*remove_dot_dot=*/true);
+  return AbsArg == AbsFilename;
+}
+
+/// Returns the command line of \p Command without the input file, the output
+/// file, the action and the dependency file options, so that only the options
+/// that affect the compilation of a module are left.
+static std::vector<std::string>
+getBaseCommandLine(const tooling::CompileCommand &Command) {
+  std::vector<std::string> Args;
+  const std::vector<std::string> &CommandLine = Command.CommandLine;
+  for (size_t I = 0, E = CommandLine.size(); I != E; ++I) {
+    StringRef Arg = CommandLine[I];
+    if (I != 0 && isInputFile(Command, Arg))
+      continue;
+    if (Arg == "-o" || Arg == "-MF" || Arg == "-MT" || Arg == "-MQ") {
+      ++I;
+      continue;
+    }
+    if (Arg == "-E" || Arg == "-c" || Arg == "-S" || Arg == "-fsyntax-only" ||
+        Arg == "-M" || Arg == "-MM" || Arg == "-MD" || Arg == "-MMD" ||
+        Arg == "-MP" || Arg == "-MG" || Arg == "-MV" ||
+        (Arg.startswith("-o") && Arg.size() > 2 && !Arg.startswith("-obj")) ||
+        Arg.startswith("-MF") || Arg.startswith("-MT") ||
+        Arg.startswith("-MQ"))
+      continue;
+    Args.push_back(Arg);
+  }
+  return Args;
+}
+
+/// Collects the dependencies of a single translation unit.
+class FullDependencyConsumer : public DependencyConsumer {
+public:
+  void handleFileDependency(const DependencyOutputOptions &Opts,
+                            StringRef File) override {
+    FileDeps.push_back(File);
+  }
+
+  void handleModuleDependency(ModuleDeps MD) override {
+    Modules.push_back(std::move(MD));
+  }
+
+  void handleContextHash(std::string Hash) override {
+    ContextHash = std::move(Hash);
+  }
+
+  std::vector<std::string> FileDeps;
+  std::vector<ModuleDeps> Modules;
+  std::string ContextHash;
+};
+
+/// Merges the dependencies of all the scanned translation units. The modules
+/// are deduplicated by their name and context hash, so that each of them is
+/// printed, and built, only once.
+class FullDeps {
+public:
+  /// \param ModuleFilesDir The absolute path of the directory in which the
+  /// module files are expected to be built.
+  FullDeps(StringRef ModuleFilesDir) : ModuleFilesDir(ModuleFilesDir) {}
+
+  void mergeDeps(const tooling::CompileCommand &Command, size_t InputIndex,
+                 FullDependencyConsumer &&TUDeps) {
+    InputDeps ID;
+    ID.Command = Command;
+    ID.ContextHash = TUDeps.ContextHash;
+    ID.FileDeps = std::move(TUDeps.FileDeps);
+
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    for (ModuleDeps &MD : TUDeps.Modules) {
+      if (MD.ImportedByMainFile)
+        ID.ClangModuleDeps.push_back(MD.ModuleName);
+      auto Key = std::make_pair(MD.ModuleName, MD.ContextHash);
+      if (Modules.count(Key))
+        continue;
+      ModuleEntry &Entry = Modules[Key];
+      Entry.Deps = std::move(MD);
+      Entry.Command = Command;
+    }
+    llvm::sort(ID.ClangModuleDeps);
+    Inputs[InputIndex] = std::move(ID);
+  }
+
+  void printFullOutput(raw_ostream &OS) {
+    llvm::json::Array OutModules;
+    for (auto &&I : Modules) {
+      const ModuleDeps &MD = I.second.Deps;
+      std::vector<std::string> Deps = toSorted(MD.ClangModuleDeps);
+      std::vector<std::string> CommandLine =
+          getBaseCommandLine(I.second.Command);
+      CommandLine.push_back("-c");
+      CommandLine.push_back("-Xclang");
+      CommandLine.push_back("-emit-module");
+      CommandLine.push_back("-fmodule-name=" + MD.ModuleName);
+      addExplicitModuleArgs(CommandLine, Deps, MD.ContextHash);
+      CommandLine.push_back("-x");
+      CommandLine.push_back(getLanguage(I.second.Command));
+      CommandLine.push_back(MD.ClangModuleMapFile);
+      CommandLine.push_back("-o");
+      CommandLine.push_back(getModuleFileName(MD.ModuleName, MD.ContextHash));
+
+      OutModules.push_back(llvm::json::Object{
+          {"name", MD.ModuleName},
+          {"context-hash", MD.ContextHash},
+          {"directory", I.second.Command.Directory},
+          {"clang-modulemap-file", MD.ClangModuleMapFile},
+          {"file-deps", toSorted(MD.FileDeps)},
+          {"clang-module-deps", Deps},
+          {"command-line", CommandLine},
+      });
+    }
+
+    llvm::json::Array TUs;
+    for (auto &&I : Inputs) {
+      const InputDeps &ID = I.second;
+      std::vector<std::string> CommandLine = ID.Command.CommandLine;
+      addExplicitModuleArgs(CommandLine, ID.ClangModuleDeps, ID.ContextHash);
+
+      TUs.push_back(llvm::json::Object{
+          {"input-file", ID.Command.Filename},
+          {"clang-context-hash", ID.ContextHash},
+          {"file-deps", ID.FileDeps},
+          {"clang-module-deps", ID.ClangModuleDeps},
+          {"command-line", CommandLine},
+          {"directory", ID.Command.Directory},
+      });
+    }
+
+    llvm::json::Object Output{
+        {"modules", std::move(OutModules)},
+        {"translation-units", std::move(TUs)},
+    };
+    OS << llvm::formatv("{0:2}\n", llvm::json::Value(std::move(Output)));
+  }
+
+private:
+  struct ModuleEntry {
+    ModuleDeps Deps;
+    /// The command of the first translation unit that imported the module.
+    /// The command line of the module is run in the directory of that
+    /// command, since it keeps the relative paths of its flags.
+    tooling::CompileCommand Command;
+  };
+
+  struct InputDeps {
+    tooling::CompileCommand Command;
+    std::string ContextHash;
+    std::vector<std::string> FileDeps;
+    /// The top level modules that are directly imported by the input.
+    std::vector<std::string> ClangModuleDeps;
+  };
+
+  /// Returns the absolute path of the module file that the build system is
+  /// expected to produce for the given module, so that the command lines do
+  /// not depend on the directory of the translation unit they come from.
+  std::string getModuleFileName(StringRef ModuleName,
+                                StringRef ContextHash) const {
+    SmallString<256> Path(ModuleFilesDir);
+    llvm::sys::path::append(Path, ModuleName + "-" + ContextHash + ".pcm");
+    return Path.str();
+  }
+
+  static std::vector<std::string> toSorted(const llvm::StringSet<> &Set) {
+    std::vector<std::string> Result;
+    for (auto &&I : Set)
+      Result.push_back(I.getKey());
+    llvm::sort(Result);
+    return Result;
+  }
+
+  static std::string getLanguage(const tooling::CompileCommand &Command) {
+    driver::types::ID Ty = driver::types::lookupTypeForExtension(
+        llvm::sys::path::extension(Command.Filename).drop_front());
+    if (Ty == driver::types::TY_INVALID)
+      Ty = driver::types::TY_C;
+    return driver::types::getTypeName(Ty);
+  }
+
+  /// Disables the implicit module builds and passes the explicitly built
+  /// \p Deps instead.
+  void addExplicitModuleArgs(std::vector<std::string> &CommandLine,
+                             ArrayRef<std::string> Deps,
+                             StringRef ContextHash) {
+    CommandLine.push_back("-fno-implicit-modules");
+    CommandLine.push_back("-fno-implicit-module-maps");
+    for (const std::string &Dep : Deps) {
+      CommandLine.push_back("-fmodule-file=" +
+                            getModuleFileName(Dep, ContextHash));
+      auto It = Modules.find(std::make_pair(Dep, ContextHash.str()));
+      if (It != Modules.end() && !It->second.Deps.ClangModuleMapFile.empty())
+        CommandLine.push_back("-fmodule-map-file=" +
+                              It->second.Deps.ClangModuleMapFile);
+    }
+  }
+
+  std::string ModuleFilesDir;
+  std::mutex Lock;
+  std::map<std::pair<std::string, std::string>, ModuleEntry> Modules;
+  std::map<size_t, InputDeps> Inputs;
+};
+
 /// The high-level implementation of the dependency discovery tool that runs on
 /// an individual worker thread.
 class DependencyScanningTool {
 public:
   /// Construct a dependency scanning tool.
   ///
+  /// \param Service          The shared state of all the workers.
   /// \param Compilations     The reference to the compilation database that's
   /// used by the clang tool.
-  DependencyScanningTool(const tooling::CompilationDatabase &Compilations,
-                         SharedStream &OS, SharedStream &Errs)
-      : Compilations(Compilations), OS(OS), Errs(Errs) {}
+  DependencyScanningTool(DependencyScanningService &Service,
+                         const tooling::CompilationDatabase &Compilations,
+                         SharedStream &OS, SharedStream &Errs, FullDeps &FD)
+      : Worker(Service), Format(Service.getFormat()),
+        Compilations(Compilations), OS(OS), Errs(Errs), FD(FD) {}
 
-  /// Computes the dependencies for the given file and prints them out.
+  /// Computes the dependencies for the given file and prints them out, or
+  /// merges them into the full dependency graph.
   ///
   /// \returns True on error.
-  bool runOnFile(const std::string &Input, StringRef CWD) {
-    auto MaybeFile = Worker.getDependencyFile(Input, CWD, Compilations);
-    if (!MaybeFile) {
-      llvm::handleAllErrors(
-          MaybeFile.takeError(), [this, &Input](llvm::StringError &Err) {
-            Errs.applyLocked([&](raw_ostream &OS) {
-              OS << "Error while scanning dependencies for " << Input << ":\n";
-              OS << Err.getMessage();
-            });
-          });
-      return true;
+  bool runOnFile(const tooling::CompileCommand &Command, size_t InputIndex) {
+    const std::string &Input = Command.Filename;
+    StringRef CWD = Command.Directory;
+    if (Format == ScanningOutputFormat::Full) {
+      FullDependencyConsumer Consumer;
+      if (llvm::Error E =
+              Worker.computeDependencies(Input, CWD, Compilations, Consumer))
+        return reportError(Input, std::move(E));
+      FD.mergeDeps(Command, InputIndex, std::move(Consumer));
+      return false;
     }
+
+    auto MaybeFile = Worker.getDependencyFile(Input, CWD, Compilations);
+    if (!MaybeFile)
+      return reportError(Input, MaybeFile.takeError());
     OS.applyLocked([&](raw_ostream &OS) { OS << *MaybeFile; });
     return false;
   }
 
 private:
+  bool reportError(StringRef Input, llvm::Error Err) {
+    llvm::handleAllErrors(
+        std::move(Err), [this, &Input](llvm::StringError &Err) {
+          Errs.applyLocked([&](raw_ostream &OS) {
+            OS << "Error while scanning dependencies for " << Input << ":\n";
+            OS << Err.getMessage();
+          });
+        });
+    return true;
+  }
+
   DependencyScanningWorker Worker;
+  ScanningOutputFormat Format;
   const tooling::CompilationDatabase &Compilations;
   SharedStream &OS;
   SharedStream &Errs;
+  FullDeps &FD;
 };
 
 llvm::cl::opt<bool> Help("h", llvm::cl::desc("Alias for -help"),
@@ -80,6 +314,32 @@ llvm::cl::opt<bool> Help("h", llvm::cl::desc("Alias for -help"),
 
 llvm::cl::OptionCategory DependencyScannerCategory("Tool options");
 
+llvm::cl::opt<ScanningMode> ScanMode(
+    "mode",
+    llvm::cl::desc("The preprocessing mode used to compute the dependencies"),
+    llvm::cl::values(
+        clEnumValN(ScanningMode::MinimizedSourcePreprocessing,
+                   "preprocess-minimized-sources",
+                   "The set of dependencies is computed by preprocessing the "
+                   "source files that were minimized to only include the "
+                   "contents that might affect the dependencies"),
+        clEnumValN(ScanningMode::CanonicalPreprocessing, "preprocess",
+                   "The set of dependencies is computed by preprocessing the "
+                   "unmodified source files")),
+    llvm::cl::init(ScanningMode::MinimizedSourcePreprocessing),
+    llvm::cl::cat(DependencyScannerCategory));
+
+llvm::cl::opt<ScanningOutputFormat> Format(
+    "format", llvm::cl::desc("The output format for the dependencies"),
+    llvm::cl::values(clEnumValN(ScanningOutputFormat::Make, "make",
+                                "Makefile compatible dep file"),
+                     clEnumValN(ScanningOutputFormat::Full, "experimental-full",
+                                "Full dependency graph suitable"
+                                " for explicitly building modules. This format "
+                                "is experimental and will change.")),
+    llvm::cl::init(ScanningOutputFormat::Make),
+    llvm::cl::cat(DependencyScannerCategory));
+
 llvm::cl::opt<unsigned>
     NumThreads("j", llvm::cl::Optional,
                llvm::cl::desc("Number of worker threads to use (default: use "
@@ -91,6 +351,12 @@ llvm::cl::opt<std::string>
                   llvm::cl::desc("Compilation database"), llvm::cl::Required,
                   llvm::cl::cat(DependencyScannerCategory));
 
+llvm::cl::opt<std::string> ModuleFilesDir(
+    "module-files-dir",
+    llvm::cl::desc("The directory in which the module files are built by the "
+                   "full output commands (default: the current directory)"),
+    llvm::cl::cat(DependencyScannerCategory));
+
 } // end anonymous namespace
 
 int main(int argc, const char **argv) {
@@ -112,9 +378,8 @@ int main(int argc, const char **argv) {
   llvm::cl::PrintOptionValues();
 
   // By default the tool runs on all inputs in the CDB.
-  std::vector<std::pair<std::string, std::string>> Inputs;
-  for (const auto &Command : Compilations->getAllCompileCommands())
-    Inputs.emplace_back(Command.Filename, Command.Directory);
+  std::vector<tooling::CompileCommand> Inputs =
+      Compilations->getAllCompileCommands();
 
   // The command options are rewritten to run Clang in preprocessor only mode.
   auto AdjustingCompilations =
@@ -133,40 +398,45 @@ int main(int argc, const char **argv) {
         return AdjustedArgs;
       });
 
+  // The file status and minimized contents are shared by all the workers.
+  DependencyScanningService Service(ScanMode, Format);
   SharedStream Errs(llvm::errs());
   // Print out the dependency results to STDOUT by default.
   SharedStream DependencyOS(llvm::outs());
+  SmallString<256> ModuleFilesPath(ModuleFilesDir);
+  llvm::sys::fs::make_absolute(ModuleFilesPath);
+  llvm::sys::path::remove_dots(ModuleFilesPath, /*remove_dot_dot=*/true);
+  FullDeps FD(ModuleFilesPath);
   unsigned NumWorkers =
       NumThreads == 0 ? llvm::hardware_concurrency() : NumThreads;
   std::vector<std::unique_ptr<DependencyScanningTool>> WorkerTools;
   for (unsigned I = 0; I < NumWorkers; ++I)
     WorkerTools.push_back(llvm::make_unique<DependencyScanningTool>(
-        *AdjustingCompilations, DependencyOS, Errs));
+        Service, *AdjustingCompilations, DependencyOS, Errs, FD));
 
   std::vector<std::thread> WorkerThreads;
   std::atomic<bool> HadErrors(false);
   std::mutex Lock;
   size_t Index = 0;
 
-  llvm::outs() << "Running clang-scan-deps on " << Inputs.size()
-               << " files using " << NumWorkers << " workers\n";
+  // The full output is a single JSON document, don't prefix it.
+  if (Format == ScanningOutputFormat::Make)
+    llvm::outs() << "Running clang-scan-deps on " << Inputs.size()
+                 << " files using " << NumWorkers << " workers\n";
   for (unsigned I = 0; I < NumWorkers; ++I) {
     WorkerThreads.emplace_back(
         [I, &Lock, &Index, &Inputs, &HadErrors, &WorkerTools]() {
           while (true) {
-            std::string Input;
-            StringRef CWD;
+            size_t InputIndex;
             // Take the next input.
             {
               std::unique_lock<std::mutex> LockGuard(Lock);
               if (Index >= Inputs.size())
                 return;
-              const auto &Compilation = Inputs[Index++];
-              Input = Compilation.first;
-              CWD = Compilation.second;
+              InputIndex = Index++;
             }
             // Run the tool on it.
-            if (WorkerTools[I]->runOnFile(Input, CWD))
+            if (WorkerTools[I]->runOnFile(Inputs[InputIndex], InputIndex))
               HadErrors = true;
           }
         });
@@ -174,5 +444,8 @@ int main(int argc, const char **argv) {
   for (auto &W : WorkerThreads)
     W.join();
 
+  if (Format == ScanningOutputFormat::Full)
+    FD.printFullOutput(llvm::outs());
+
   return HadErrors;
 }
@@ -33,6 +33,7 @@
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/BuryPointer.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
@@ -66,6 +67,13 @@ static void LLVMErrorHandler(void *UserData, const std::string &Message,
   // particular that we remove files registered with RemoveFileOnSignal.
   llvm::sys::RunInterruptHandlers();
 
+  // When the frontend runs in the driver process, unwind back to the driver
+  // so that it generates the crash diagnostics.
+  if (GenCrashDiag)
+    if (llvm::CrashRecoveryContext *CRC =
+            llvm::CrashRecoveryContext::GetCurrent())
+      CRC->HandleCrash();
+
   // We cannot recover from llvm errors.  When reporting a fatal error, exit
   // with status 70 to generate crash diagnostics.  For BSD systems this is
   // defined as an internal software error.  Otherwise, exit with status 1.
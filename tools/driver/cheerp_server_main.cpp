@@ -0,0 +1,787 @@
+//===-- cheerp_server_main.cpp - Cheerp compile server --------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This is the entry point to the clang --cheerp-server and --cheerp-client
+// modes.
+//
+// The server stays resident and serves driver invocations sent by clients
+// over a local socket. Compile jobs run in process, on top of a file system
+// which caches the status and contents of the system include directories,
+// and link jobs reuse the already parsed Cheerp libraries. Other jobs (the
+// optimizer and the backend) and links of inputs which are not bitcode files
+// are executed as usual.
+//
+// The client sends its working directory, arguments and environment, and
+// replays the output and exit code of the server. Requests change the working
+// directory, the environment and the standard file descriptors of the server
+// process, so they are served one at a time. If no server is running, or if
+// it is busy with another request, the client compiles as a normal driver
+// invocation would.
+//
+// The default socket lives in a directory only accessible by the user, and
+// the server only accepts connections from processes of the same user.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/Stack.h"
+#include "clang/Config/config.h"
+#include "clang/CodeGen/ObjectFilePCHContainerOperations.h"
+#include "clang/Driver/Compilation.h"
+#include "clang/Driver/Driver.h"
+#include "clang/Driver/DriverDiagnostic.h"
+#include "clang/Driver/Job.h"
+#include "clang/Driver/Options.h"
+#include "clang/Driver/Tool.h"
+#include "clang/Driver/ToolChain.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/TextDiagnosticBuffer.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "clang/Frontend/Utils.h"
+#include "clang/FrontendTool/Utils.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/BinaryFormat/Magic.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+using namespace clang;
+using namespace clang::driver;
+
+std::string GetExecutablePath(const char *Argv0, bool CanonicalPrefixes);
+
+#ifdef LLVM_ON_UNIX
+
+namespace {
+
+/// Check if \p Path is \p Dir or is below it. Whole path components are
+/// compared, and paths going up with ".." are never considered below \p Dir.
+bool isInDirectory(StringRef Path, StringRef Dir) {
+  if (Dir.empty() || !Path.startswith(Dir))
+    return false;
+  if (Path.size() != Dir.size() &&
+      !llvm::sys::path::is_separator(Path[Dir.size()]))
+    return false;
+  for (auto It = llvm::sys::path::begin(Path), E = llvm::sys::path::end(Path);
+       It != E; ++It)
+    if (*It == "..")
+      return false;
+  return true;
+}
+
+/// A file system which caches the status and the contents of the files below
+/// a set of directories, which are assumed not to change while the server
+/// runs. Failed lookups are cached too, since most of the header search
+/// consists of probing include directories which do not contain the header.
+class ImmutablePrefixFileSystem : public llvm::vfs::ProxyFileSystem {
+  std::vector<std::string> Dirs;
+  llvm::StringMap<llvm::ErrorOr<llvm::vfs::Status>> StatCache;
+  llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> ContentCache;
+
+  class CachedFile : public llvm::vfs::File {
+    llvm::vfs::Status S;
+    const llvm::MemoryBuffer &Buffer;
+
+  public:
+    CachedFile(llvm::vfs::Status S, const llvm::MemoryBuffer &Buffer)
+        : S(std::move(S)), Buffer(Buffer) {}
+    llvm::ErrorOr<llvm::vfs::Status> status() override { return S; }
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+    getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+              bool IsVolatile) override {
+      return llvm::MemoryBuffer::getMemBuffer(Buffer.getMemBufferRef(),
+                                              RequiresNullTerminator);
+    }
+    std::error_code close() override { return std::error_code(); }
+  };
+
+  bool isCacheable(StringRef Path) const {
+    if (!llvm::sys::path::is_absolute(Path))
+      return false;
+    for (const std::string &Dir : Dirs)
+      if (isInDirectory(Path, Dir))
+        return true;
+    return false;
+  }
+
+public:
+  ImmutablePrefixFileSystem(ArrayRef<std::string> CachedDirs)
+      : ProxyFileSystem(llvm::vfs::getRealFileSystem()) {
+    for (StringRef Dir : CachedDirs) {
+      SmallString<256> Path(Dir);
+      llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+      while (Path.size() > 1 &&
+             llvm::sys::path::is_separator(Path.back()))
+        Path.pop_back();
+      Dirs.push_back(Path.str());
+    }
+  }
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const Twine &Path) override {
+    SmallString<256> Storage;
+    StringRef P = Path.toStringRef(Storage);
+    if (!isCacheable(P))
+      return ProxyFileSystem::status(Path);
+    auto It = StatCache.find(P);
+    if (It != StatCache.end())
+      return It->second;
+    llvm::ErrorOr<llvm::vfs::Status> S = ProxyFileSystem::status(Path);
+    StatCache.insert({P, S});
+    return S;
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const Twine &Path) override {
+    SmallString<256> Storage;
+    StringRef P = Path.toStringRef(Storage);
+    if (!isCacheable(P))
+      return ProxyFileSystem::openFileForRead(Path);
+    llvm::ErrorOr<llvm::vfs::Status> S = status(P);
+    if (!S)
+      return S.getError();
+    auto It = ContentCache.find(P);
+    if (It == ContentCache.end()) {
+      auto Buffer = llvm::MemoryBuffer::getFile(P, /*FileSize=*/-1,
+                                                /*RequiresNullTerminator=*/true,
+                                                /*IsVolatile=*/false);
+      if (!Buffer)
+        return Buffer.getError();
+      It = ContentCache.insert({P, std::move(*Buffer)}).first;
+    }
+    return std::unique_ptr<llvm::vfs::File>(new CachedFile(
+        llvm::vfs::Status::copyWithNewName(*S, P), *It->second));
+  }
+};
+
+/// The state which is kept across requests.
+struct ServerState {
+  std::string DriverPath;
+  const char *Argv0;
+  void *MainAddr;
+  /// The system include directories, which are cached by FS.
+  std::vector<std::string> CachedDirs;
+  IntrusiveRefCntPtr<ImmutablePrefixFileSystem> FS;
+
+  /// Parsed bitcode libraries, keyed by path. They are cloned into each link.
+  struct CachedModule {
+    llvm::sys::TimePoint<> ModTime;
+    uint64_t Size;
+    std::unique_ptr<llvm::Module> M;
+  };
+  std::unique_ptr<llvm::LLVMContext> LinkContext;
+  llvm::StringMap<CachedModule> Libraries;
+  /// The types of every linked module end up in LinkContext, start from a
+  /// fresh one every once in a while.
+  unsigned LinksInContext = 0;
+};
+
+const unsigned MaxLinksPerContext = 64;
+
+/// Sent back instead of an exit code when the server is already serving a
+/// request. The client then compiles in process, like when there is no server.
+const int32_t BusyResult = -1;
+
+/// A driver invocation sent by a client.
+struct Request {
+  std::string WorkingDir;
+  std::vector<std::string> Args;
+  std::vector<std::string> Env;
+
+  bool isShutdown() const {
+    return Args.size() == 2 && Args[1] == "--cheerp-server-shutdown";
+  }
+};
+
+bool writeAll(int FD, const void *Data, size_t Size) {
+  const char *Ptr = static_cast<const char *>(Data);
+  while (Size) {
+    ssize_t Written = ::write(FD, Ptr, Size);
+    if (Written <= 0)
+      return false;
+    Ptr += Written;
+    Size -= Written;
+  }
+  return true;
+}
+
+bool readAll(int FD, void *Data, size_t Size) {
+  char *Ptr = static_cast<char *>(Data);
+  while (Size) {
+    ssize_t Read = ::read(FD, Ptr, Size);
+    if (Read <= 0)
+      return false;
+    Ptr += Read;
+    Size -= Read;
+  }
+  return true;
+}
+
+bool sendString(int FD, StringRef S) {
+  uint32_t Size = S.size();
+  return writeAll(FD, &Size, sizeof(Size)) && writeAll(FD, S.data(), Size);
+}
+
+bool recvString(int FD, std::string &S) {
+  uint32_t Size;
+  if (!readAll(FD, &Size, sizeof(Size)))
+    return false;
+  S.resize(Size);
+  return readAll(FD, &S[0], Size);
+}
+
+bool sendStrings(int FD, ArrayRef<std::string> Strings) {
+  uint32_t Count = Strings.size();
+  if (!writeAll(FD, &Count, sizeof(Count)))
+    return false;
+  for (const std::string &S : Strings)
+    if (!sendString(FD, S))
+      return false;
+  return true;
+}
+
+bool recvStrings(int FD, std::vector<std::string> &Strings) {
+  uint32_t Count;
+  if (!readAll(FD, &Count, sizeof(Count)))
+    return false;
+  Strings.resize(Count);
+  for (std::string &S : Strings)
+    if (!recvString(FD, S))
+      return false;
+  return true;
+}
+
+bool sendResult(int FD, int32_t Res, StringRef Out, StringRef Err) {
+  return writeAll(FD, &Res, sizeof(Res)) && sendString(FD, Out) &&
+         sendString(FD, Err);
+}
+
+/// Check that the process on the other side of \p FD belongs to this user.
+bool isPeerSameUser(int FD) {
+#if defined(__linux__)
+  struct ucred Cred;
+  socklen_t Len = sizeof(Cred);
+  if (::getsockopt(FD, SOL_SOCKET, SO_PEERCRED, &Cred, &Len) < 0)
+    return false;
+  return Cred.uid == ::getuid();
+#else
+  uid_t UID;
+  gid_t GID;
+  if (::getpeereid(FD, &UID, &GID) < 0)
+    return false;
+  return UID == ::getuid();
+#endif
+}
+
+/// Create \p Dir if needed, and check that it is a directory owned by this
+/// user and not accessible by anybody else.
+bool ensurePrivateDirectory(StringRef Dir) {
+  if (llvm::sys::fs::create_directory(Dir, /*IgnoreExisting=*/true,
+                                      llvm::sys::fs::owner_all))
+    return false;
+  struct stat St;
+  std::string DirStr = Dir.str();
+  if (::lstat(DirStr.c_str(), &St) < 0)
+    return false;
+  return S_ISDIR(St.st_mode) && St.st_uid == ::getuid() &&
+         (St.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+/// The socket is either given as --cheerp-server=<path> (or
+/// --cheerp-client=<path>), or it is a per-user socket in $XDG_RUNTIME_DIR,
+/// or in a private directory in the temp directory. An empty path is returned
+/// if the default directory is not private.
+std::string getSocketPath(StringRef Arg) {
+  size_t Eq = Arg.find('=');
+  if (Eq != StringRef::npos)
+    return Arg.substr(Eq + 1);
+  SmallString<128> Path;
+  if (const char *RuntimeDir = ::getenv("XDG_RUNTIME_DIR"))
+    Path = RuntimeDir;
+  if (Path.empty() || !llvm::sys::path::is_absolute(Path)) {
+    Path.clear();
+    llvm::sys::path::system_temp_directory(/*ErasedOnReboot=*/true, Path);
+    llvm::sys::path::append(Path, "cheerp-server-" + Twine(::getuid()));
+  }
+  if (!ensurePrivateDirectory(Path))
+    return std::string();
+  llvm::sys::path::append(Path, "cheerp-server.sock");
+  return Path.str();
+}
+
+/// Replace the environment of the process with \p Env, and return the
+/// previous one.
+std::vector<std::string> replaceEnvironment(ArrayRef<std::string> Env) {
+  std::vector<std::string> Previous;
+  for (char **Var = environ; *Var; ++Var)
+    Previous.push_back(*Var);
+  for (StringRef Var : Previous)
+    ::unsetenv(Var.split('=').first.str().c_str());
+  for (StringRef Var : Env) {
+    std::pair<StringRef, StringRef> NameValue = Var.split('=');
+    if (!NameValue.first.empty())
+      ::setenv(NameValue.first.str().c_str(), NameValue.second.str().c_str(),
+               /*overwrite=*/1);
+  }
+  return Previous;
+}
+
+int connectToServer(StringRef Path) {
+  struct sockaddr_un Addr;
+  if (Path.empty() || Path.size() >= sizeof(Addr.sun_path))
+    return -1;
+  int FD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (FD < 0)
+    return -1;
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  memcpy(Addr.sun_path, Path.data(), Path.size());
+  if (::connect(FD, reinterpret_cast<struct sockaddr *>(&Addr),
+                sizeof(Addr)) < 0) {
+    ::close(FD);
+    return -1;
+  }
+  return FD;
+}
+
+/// Run a -cc1 job in process, on top of the caching file system.
+int runCC1(ServerState &S, ArrayRef<const char *> Argv) {
+  ensureSufficientStack();
+
+  std::unique_ptr<CompilerInstance> Clang(new CompilerInstance());
+  auto PCHOps = Clang->getPCHContainerOperations();
+  PCHOps->registerWriter(llvm::make_unique<ObjectFilePCHContainerWriter>());
+  PCHOps->registerReader(llvm::make_unique<ObjectFilePCHContainerReader>());
+
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticBuffer *DiagsBuffer = new TextDiagnosticBuffer;
+  DiagnosticsEngine Diags(DiagID, &*DiagOpts, DiagsBuffer);
+  bool Success = CompilerInvocation::CreateFromArgs(
+      Clang->getInvocation(), Argv.begin(), Argv.end(), Diags);
+
+  if (Clang->getHeaderSearchOpts().UseBuiltinIncludes &&
+      Clang->getHeaderSearchOpts().ResourceDir.empty())
+    Clang->getHeaderSearchOpts().ResourceDir =
+        CompilerInvocation::GetResourcesPath(S.Argv0, S.MainAddr);
+  // The server outlives the compilation, memory must be released
+  Clang->getFrontendOpts().DisableFree = false;
+
+  Clang->createDiagnostics();
+  if (!Clang->hasDiagnostics())
+    return 1;
+  DiagsBuffer->FlushDiagnostics(Clang->getDiagnostics());
+  if (!Success)
+    return 1;
+
+  Clang->createFileManager(createVFSFromCompilerInvocation(
+      Clang->getInvocation(), Clang->getDiagnostics(), S.FS));
+  return !ExecuteCompilerInvocation(Clang.get());
+}
+
+void linkDiagnosticHandler(const llvm::DiagnosticInfo &DI, void *Context) {
+  if (DI.getSeverity() == llvm::DS_Error)
+    *static_cast<bool *>(Context) = true;
+  llvm::DiagnosticPrinterRawOStream DP(llvm::errs());
+  llvm::errs() << (DI.getSeverity() == llvm::DS_Error ? "error: " : "warning: ");
+  DI.print(DP);
+  llvm::errs() << "\n";
+}
+
+/// Run a cheerp::Link job in process. Libraries from the toolchain file paths
+/// are parsed once and cloned into each link.
+int runLink(ServerState &S, ArrayRef<const char *> Argv,
+            const ToolChain::path_list &LibraryPaths) {
+  if (!S.LinkContext || S.LinksInContext >= MaxLinksPerContext) {
+    S.Libraries.clear();
+    S.LinkContext.reset(new llvm::LLVMContext());
+    S.LinksInContext = 0;
+  }
+  llvm::LLVMContext &Ctx = *S.LinkContext;
+  S.LinksInContext++;
+  bool HadError = false;
+  Ctx.setDiagnosticHandlerCallBack(linkDiagnosticHandler, &HadError);
+
+  StringRef Output;
+  std::vector<StringRef> Inputs;
+  for (size_t i = 0; i < Argv.size(); ++i) {
+    if (StringRef(Argv[i]) == "-o" && i + 1 < Argv.size())
+      Output = Argv[++i];
+    else
+      Inputs.push_back(Argv[i]);
+  }
+
+  auto isLibrary = [&](StringRef Path) {
+    for (const std::string &Dir : LibraryPaths)
+      if (isInDirectory(Path, Dir))
+        return true;
+    return false;
+  };
+
+  auto Composite = llvm::make_unique<llvm::Module>("cheerp-server-link", Ctx);
+  llvm::Linker L(*Composite);
+  for (StringRef Input : Inputs) {
+    std::unique_ptr<llvm::Module> M;
+    llvm::SMDiagnostic Err;
+    llvm::sys::fs::file_status Status;
+    if (isLibrary(Input) && !llvm::sys::fs::status(Input, Status)) {
+      ServerState::CachedModule &Cached = S.Libraries[Input];
+      if (!Cached.M || Cached.ModTime != Status.getLastModificationTime() ||
+          Cached.Size != Status.getSize()) {
+        Cached.M = llvm::parseIRFile(Input, Err, Ctx);
+        Cached.ModTime = Status.getLastModificationTime();
+        Cached.Size = Status.getSize();
+      }
+      if (Cached.M)
+        M = llvm::CloneModule(*Cached.M);
+    } else {
+      M = llvm::parseIRFile(Input, Err, Ctx);
+    }
+    if (!M) {
+      Err.print(S.Argv0, llvm::errs());
+      return 1;
+    }
+    if (L.linkInModule(std::move(M)) || HadError)
+      return 1;
+  }
+
+  std::error_code EC;
+  llvm::ToolOutputFile Out(Output, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    llvm::errs() << EC.message() << '\n';
+    return 1;
+  }
+  llvm::WriteBitcodeToFile(*Composite, Out.os());
+  Out.keep();
+  return 0;
+}
+
+/// Check if a cheerp::Link job can run in the server process, which only links
+/// bitcode files. Archives and other inputs are left to the linker tool.
+bool canRunLinkInProcess(const Command &Cmd) {
+  const llvm::opt::ArgStringList &Args = Cmd.getArguments();
+  for (size_t i = 0; i < Args.size(); ++i) {
+    StringRef Arg = Args[i];
+    if (Arg == "-o") {
+      ++i;
+      continue;
+    }
+    llvm::file_magic Magic;
+    if (Arg.startswith("-") || llvm::identify_magic(Arg, Magic) ||
+        Magic != llvm::file_magic::bitcode)
+      return false;
+  }
+  return true;
+}
+
+/// Check if a -cc1 job can run in the server process. Options of LLVM itself
+/// are global state, so compilations which set them run in a new process.
+bool canRunCC1InProcess(const ServerState &S, const Command &Cmd) {
+  if (S.DriverPath != Cmd.getExecutable())
+    return false;
+  const llvm::opt::ArgStringList &Args = Cmd.getArguments();
+  if (Args.empty() || StringRef(Args[0]) != "-cc1")
+    return false;
+  for (const char *Arg : Args)
+    if (StringRef(Arg) == "-mllvm")
+      return false;
+  return true;
+}
+
+/// Run a driver invocation, with the same behavior of the normal driver
+/// except for jobs which can be run in process.
+int runDriver(ServerState &S, SmallVectorImpl<const char *> &Argv) {
+  auto TargetAndMode = ToolChain::getTargetAndModeFromProgramName(Argv[0]);
+  if (!TargetAndMode.DriverMode.empty())
+    Argv.insert(Argv.begin() + 1, TargetAndMode.DriverMode);
+
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticPrinter *DiagClient =
+      new TextDiagnosticPrinter(llvm::errs(), &*DiagOpts);
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+  DiagnosticsEngine Diags(DiagID, &*DiagOpts, DiagClient);
+
+  Driver TheDriver(S.DriverPath, llvm::sys::getDefaultTargetTriple(), Diags);
+  TheDriver.setInstalledDir(llvm::sys::path::parent_path(S.DriverPath));
+  TheDriver.setTargetAndMode(TargetAndMode);
+
+  std::unique_ptr<Compilation> C(TheDriver.BuildCompilation(Argv));
+  if (!C || C->containsError())
+    return 1;
+
+  // Let the driver handle everything which is not a plain compilation
+  const llvm::opt::ArgList &Args = C->getArgs();
+  if (Args.hasArg(options::OPT__HASH_HASH_HASH) ||
+      Args.hasArg(options::OPT_v)) {
+    SmallVector<std::pair<int, const Command *>, 4> FailingCommands;
+    return TheDriver.ExecuteCompilation(*C, FailingCommands);
+  }
+
+  int Res = 0;
+  for (const Command &Cmd : C->getJobs()) {
+    bool InProcessLink =
+        Cmd.getCreator().getName() == StringRef("cheerp::Link") &&
+        canRunLinkInProcess(Cmd);
+    if (InProcessLink || canRunCC1InProcess(S, Cmd)) {
+      // A crash in a job must not take down the server. The caches may be
+      // left in an inconsistent state, so they are dropped.
+      llvm::CrashRecoveryContext CRC;
+      bool Completed = CRC.RunSafely([&] {
+        Res = InProcessLink
+                  ? runLink(S, Cmd.getArguments(),
+                            C->getDefaultToolChain().getFilePaths())
+                  : runCC1(S, Cmd.getArguments());
+      });
+      if (!Completed) {
+        Diags.Report(diag::err_drv_command_signalled)
+            << Cmd.getCreator().getName();
+        S.FS = new ImmutablePrefixFileSystem(S.CachedDirs);
+        S.LinkContext.reset();
+        S.Libraries.clear();
+        Res = 1;
+      }
+    } else {
+      std::string ErrMsg;
+      bool ExecutionFailed;
+      Res = Cmd.Execute({}, &ErrMsg, &ExecutionFailed);
+      if (ExecutionFailed)
+        Diags.Report(diag::err_drv_command_failure) << ErrMsg;
+    }
+    if (Res) {
+      C->CleanupFileMap(C->getFailureResultFiles(),
+                        dyn_cast<JobAction>(&Cmd.getSource()), true);
+      break;
+    }
+  }
+  if (!TheDriver.isSaveTempsEnabled())
+    C->CleanupFileList(C->getTempFiles());
+  Diags.getClient()->finish();
+  return Res;
+}
+
+/// Read a request from \p ClientFD.
+bool readRequest(int ClientFD, Request &R) {
+  return recvString(ClientFD, R.WorkingDir) && recvStrings(ClientFD, R.Args) &&
+         recvStrings(ClientFD, R.Env);
+}
+
+/// Run a request with the working directory and the environment of the
+/// client, and the standard output and error redirected to temporary files,
+/// then send back the exit code and the output.
+void serveRequest(ServerState &S, int ClientFD, const Request &R) {
+  SmallString<128> OutPath, ErrPath;
+  int OutFD, ErrFD;
+  if (llvm::sys::fs::createTemporaryFile("cheerp-server", "out", OutFD,
+                                         OutPath) ||
+      llvm::sys::fs::createTemporaryFile("cheerp-server", "err", ErrFD,
+                                         ErrPath)) {
+    sendResult(ClientFD, BusyResult, "", "");
+    return;
+  }
+
+  int32_t Res = 1;
+  SmallString<256> ServerDir;
+  llvm::sys::fs::current_path(ServerDir);
+  if (::chdir(R.WorkingDir.c_str()) == 0) {
+    SmallVector<const char *, 64> Argv;
+    for (const std::string &Arg : R.Args)
+      Argv.push_back(Arg.c_str());
+
+    std::vector<std::string> ServerEnv = replaceEnvironment(R.Env);
+    int SavedOut = ::dup(STDOUT_FILENO);
+    int SavedErr = ::dup(STDERR_FILENO);
+    ::dup2(OutFD, STDOUT_FILENO);
+    ::dup2(ErrFD, STDERR_FILENO);
+    Res = runDriver(S, Argv);
+    llvm::outs().flush();
+    llvm::errs().flush();
+    fflush(stdout);
+    fflush(stderr);
+    ::dup2(SavedOut, STDOUT_FILENO);
+    ::dup2(SavedErr, STDERR_FILENO);
+    ::close(SavedOut);
+    ::close(SavedErr);
+    replaceEnvironment(ServerEnv);
+    ::chdir(ServerDir.c_str());
+  }
+  ::close(OutFD);
+  ::close(ErrFD);
+
+  // Negative values are reserved for BusyResult
+  if (Res < 0)
+    Res = 1;
+  auto Out = llvm::MemoryBuffer::getFile(OutPath);
+  auto Err = llvm::MemoryBuffer::getFile(ErrPath);
+  sendResult(ClientFD, Res, Out ? (*Out)->getBuffer() : "",
+             Err ? (*Err)->getBuffer() : "");
+  llvm::sys::fs::remove(OutPath);
+  llvm::sys::fs::remove(ErrPath);
+}
+
+} // end anonymous namespace
+
+int cheerp_server_main(ArrayRef<const char *> Argv, const char *Argv0,
+                       void *MainAddr) {
+  std::string SocketPath = getSocketPath(Argv[1]);
+  ServerState S;
+  S.DriverPath = GetExecutablePath(Argv0, /*CanonicalPrefixes=*/true);
+  S.Argv0 = Argv0;
+  S.MainAddr = MainAddr;
+  // The system include directories of the default sysroot and of the resource
+  // directory are assumed to be immutable. The default sysroot is the
+  // installation prefix when it is not configured.
+  SmallString<128> SysRootInclude(DEFAULT_SYSROOT);
+  if (SysRootInclude.empty())
+    SysRootInclude = llvm::sys::path::parent_path(
+        llvm::sys::path::parent_path(S.DriverPath));
+  llvm::sys::path::append(SysRootInclude, "include");
+  SmallString<128> ResourceInclude(
+      CompilerInvocation::GetResourcesPath(Argv0, MainAddr));
+  llvm::sys::path::append(ResourceInclude, "include");
+  S.CachedDirs.push_back(SysRootInclude.str());
+  S.CachedDirs.push_back(ResourceInclude.str());
+  S.FS = new ImmutablePrefixFileSystem(S.CachedDirs);
+  llvm::CrashRecoveryContext::Enable();
+
+  int ServerFD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un Addr;
+  if (ServerFD < 0 || SocketPath.empty() ||
+      SocketPath.size() >= sizeof(Addr.sun_path)) {
+    llvm::errs() << "error: cannot create socket '" << SocketPath << "'\n";
+    return 1;
+  }
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  memcpy(Addr.sun_path, SocketPath.data(), SocketPath.size());
+  ::unlink(SocketPath.c_str());
+  if (::bind(ServerFD, reinterpret_cast<struct sockaddr *>(&Addr),
+             sizeof(Addr)) < 0 ||
+      ::chmod(SocketPath.c_str(), S_IRUSR | S_IWUSR) < 0 ||
+      ::listen(ServerFD, 16) < 0) {
+    llvm::errs() << "error: cannot listen on socket '" << SocketPath << "'\n";
+    ::close(ServerFD);
+    return 1;
+  }
+
+  // Requests are served one at a time on a worker thread, since they change
+  // the working directory, the environment and the standard file descriptors
+  // of the process. Clients arriving while a request is being served are told
+  // to compile on their own instead of waiting.
+  std::thread Worker;
+  std::atomic<bool> Busy(false);
+  while (true) {
+    int ClientFD = ::accept(ServerFD, nullptr, nullptr);
+    if (ClientFD < 0)
+      continue;
+    Request R;
+    if (!isPeerSameUser(ClientFD) || !readRequest(ClientFD, R)) {
+      ::close(ClientFD);
+      continue;
+    }
+    if (R.isShutdown()) {
+      if (Worker.joinable())
+        Worker.join();
+      sendResult(ClientFD, 0, "", "");
+      ::close(ClientFD);
+      break;
+    }
+    if (Busy) {
+      sendResult(ClientFD, BusyResult, "", "");
+      ::close(ClientFD);
+      continue;
+    }
+    if (Worker.joinable())
+      Worker.join();
+    Busy = true;
+    Worker = std::thread([&S, &Busy, ClientFD, R] {
+      serveRequest(S, ClientFD, R);
+      ::close(ClientFD);
+      Busy = false;
+    });
+  }
+  ::close(ServerFD);
+  ::unlink(SocketPath.c_str());
+  return 0;
+}
+
+int cheerp_client_main(ArrayRef<const char *> Argv) {
+  int FD = connectToServer(getSocketPath(Argv[1]));
+  if (FD < 0)
+    return -1;
+
+  SmallString<256> WorkingDir;
+  llvm::sys::fs::current_path(WorkingDir);
+  // The client flag itself is not forwarded
+  std::vector<std::string> Args;
+  Args.push_back(Argv[0]);
+  for (const char *Arg : Argv.drop_front(2))
+    Args.push_back(Arg);
+  std::vector<std::string> Env;
+  for (char **Var = environ; *Var; ++Var)
+    Env.push_back(*Var);
+  bool Sent = sendString(FD, WorkingDir) && sendStrings(FD, Args) &&
+              sendStrings(FD, Env);
+
+  int32_t Res;
+  std::string Out, Err;
+  if (!Sent || !readAll(FD, &Res, sizeof(Res)) || !recvString(FD, Out) ||
+      !recvString(FD, Err)) {
+    ::close(FD);
+    llvm::errs() << "error: lost connection to the Cheerp compile server\n";
+    return 1;
+  }
+  ::close(FD);
+  // The server is busy, compile in process as if there was no server
+  if (Res == BusyResult)
+    return -1;
+  llvm::outs() << Out;
+  llvm::errs() << Err;
+  return Res;
+}
+
+#else
+
+int cheerp_server_main(ArrayRef<const char *> Argv, const char *Argv0,
+                       void *MainAddr) {
+  llvm::errs() << "error: the Cheerp compile server is not supported on this "
+                  "platform\n";
+  return 1;
+}
+
+int cheerp_client_main(ArrayRef<const char *> Argv) { return -1; }
+
+#endif
@@ -204,6 +204,13 @@ extern int cc1as_main(ArrayRef<const char *> Argv, const char *Argv0,
                       void *MainAddr);
 extern int cc1gen_reproducer_main(ArrayRef<const char *> Argv,
                                   const char *Argv0, void *MainAddr);
+extern int cheerp_server_main(ArrayRef<const char *> Argv, const char *Argv0,
+                              void *MainAddr);
+extern int cheerp_client_main(ArrayRef<const char *> Argv);
+
+static bool isCheerpServerArg(StringRef Arg, StringRef Name) {
+  return Arg == Name || Arg.startswith((Name + "=").str());
+}
 
 static void insertTargetAndModeArgs(const ParsedClangName &NameParts,
                                     SmallVectorImpl<const char *> &ArgVector,
@@ -318,6 +325,15 @@ static int ExecuteCC1Tool(ArrayRef<const char *> argv, StringRef Tool) {
   return 1;
 }
 
+/// Entry point of the cc1 tools when the driver runs them in-process through
+/// Driver::CC1Main.
+static int ExecuteInProcessCC1Tool(SmallVectorImpl<const char *> &ArgV) {
+  // The options are global and might have been used already by the driver or
+  // by a previous cc1 invocation.
+  llvm::cl::ResetAllOptionOccurrences();
+  return ExecuteCC1Tool(ArgV, ArgV[1] + 4);
+}
+
 int main(int argc_, const char **argv_) {
   llvm::InitLLVM X(argc_, argv_);
   SmallVector<const char *, 256> argv(argv_, argv_ + argc_);
@@ -381,6 +397,21 @@ int main(int argc_, const char **argv_) {
     return ExecuteCC1Tool(argv, argv[1] + 4);
   }
 
+  // Handle the Cheerp compile server and its client.
+  if (argv.size() > 1 && argv[1] &&
+      isCheerpServerArg(argv[1], "--cheerp-server")) {
+    void *GetExecutablePathVP = (void *)(intptr_t) GetExecutablePath;
+    return cheerp_server_main(argv, argv[0], GetExecutablePathVP);
+  }
+  if (argv.size() > 1 && argv[1] &&
+      isCheerpServerArg(argv[1], "--cheerp-client")) {
+    int Res = cheerp_client_main(argv);
+    if (Res >= 0)
+      return Res;
+    // No server is running or it is busy, compile in this process
+    argv.erase(argv.begin() + 1);
+  }
+
   bool CanonicalPrefixes = true;
   for (int i = 1, size = argv.size(); i < size; ++i) {
     // Skip end-of-line response file markers
@@ -449,6 +480,7 @@ int main(int argc_, const char **argv_) {
   Driver TheDriver(Path, llvm::sys::getDefaultTargetTriple(), Diags);
   SetInstallDir(argv, TheDriver, CanonicalPrefixes);
   TheDriver.setTargetAndMode(TargetAndMode);
+  TheDriver.CC1Main = &ExecuteInProcessCC1Tool;
 
   insertTargetAndModeArgs(TargetAndMode, argv, SavedStrings);
 
@@ -3315,6 +3315,16 @@ void clang_CXIndex_setInvocationEmissionPathOption(CXIndex CIdx,
     static_cast<CIndexer *>(CIdx)->setInvocationEmissionPath(Path ? Path : "");
 }
 
+void clang_CXIndex_setPreambleStoreOption(CXIndex CIdx, const char *Path,
+                                          unsigned long long MaxSize) {
+  if (!CIdx)
+    return;
+  std::shared_ptr<PreambleStore> Store;
+  if (Path && *Path)
+    Store = std::make_shared<PreambleStore>(Path, MaxSize);
+  static_cast<CIndexer *>(CIdx)->setPreambleStore(std::move(Store));
+}
+
 void clang_toggleCrashRecovery(unsigned isEnabled) {
   if (isEnabled)
     llvm::CrashRecoveryContext::Enable();
@@ -3516,7 +3526,7 @@ clang_parseTranslationUnit_Impl(CXIndex CIdx, const char *source_filename,
       /*AllowPCHWithCompilerErrors=*/true, SkipFunctionBodies, SingleFileParse,
       /*UserFilesAreVolatile=*/true, ForSerialization,
       CXXIdx->getPCHContainerOperations()->getRawReader().getFormat(),
-      &ErrUnit));
+      &ErrUnit, /*VFS=*/nullptr, CXXIdx->getPreambleStore()));
 
   // Early failures in LoadFromCommandLine may return with ErrUnit unset.
   if (!Unit && !ErrUnit)
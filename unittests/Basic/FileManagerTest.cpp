@@ -379,4 +379,66 @@ TEST_F(FileManagerTest, getFileDontOpenRealPath) {
   EXPECT_EQ(file->tryGetRealPathName(), ExpectedResult);
 }
 
+// The paths below are only absolute on POSIX.
+#ifndef _WIN32
+
+TEST_F(FileManagerTest, sharedCacheSharesStatsAndContents) {
+  auto FS = IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem>(
+      new llvm::vfs::InMemoryFileSystem);
+  FS->addFile("/shared/header.h", 0,
+              llvm::MemoryBuffer::getMemBuffer("int x;\n"));
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache = new SharedFileSystemCache;
+
+  FileManager Manager1(FileSystemOptions(), FS);
+  Manager1.setSharedCache(Cache);
+  const FileEntry *File1 = Manager1.getFile("/shared/header.h");
+  ASSERT_TRUE(File1 != nullptr);
+  auto Buffer1 = Manager1.getBufferForFile(File1);
+  ASSERT_TRUE(bool(Buffer1));
+
+  // The file is found through the shared stat, even though it is not in the
+  // file system of the second manager.
+  FileManager Manager2(FileSystemOptions(),
+                       new llvm::vfs::InMemoryFileSystem);
+  Manager2.setSharedCache(Cache);
+  const FileEntry *File2 = Manager2.getFile("/shared/header.h");
+  ASSERT_TRUE(File2 != nullptr);
+  EXPECT_EQ(File1->getUniqueID(), File2->getUniqueID());
+  auto Buffer2 = Manager2.getBufferForFile(File2);
+  ASSERT_TRUE(bool(Buffer2));
+  EXPECT_EQ((*Buffer1)->getBufferStart(), (*Buffer2)->getBufferStart());
+  EXPECT_EQ("int x;\n", (*Buffer2)->getBuffer());
+
+  // Negative results are not shared, and invalidated stats are looked up
+  // again.
+  EXPECT_EQ(nullptr, Manager2.getFile("/shared/missing.h"));
+  Manager2.invalidateCache(File2);
+  EXPECT_EQ(nullptr, Manager2.getFile("/shared/header.h"));
+}
+
+#endif  // !_WIN32
+
+TEST_F(FileManagerTest, sharedCacheChecksSizeAndModificationTime) {
+  SharedFileSystemCache Cache;
+  llvm::sys::fs::UniqueID ID(1, 2);
+  auto Shared = Cache.addBuffer(
+      ID, 7, 100, llvm::MemoryBuffer::getMemBufferCopy("int x;\n", "a.h"));
+  ASSERT_TRUE(Shared != nullptr);
+  EXPECT_EQ("a.h", Shared->getBufferIdentifier());
+
+  auto Hit = Cache.getBuffer(ID, 7, 100);
+  ASSERT_TRUE(Hit != nullptr);
+  EXPECT_EQ(Shared->getBufferStart(), Hit->getBufferStart());
+  EXPECT_EQ(nullptr, Cache.getBuffer(ID, 8, 100));
+  EXPECT_EQ(nullptr, Cache.getBuffer(ID, 7, 101));
+  EXPECT_EQ(nullptr, Cache.getBuffer(llvm::sys::fs::UniqueID(1, 3), 7, 100));
+
+  // Newer contents replace the old ones, which stay alive for their users.
+  auto Newer = Cache.addBuffer(
+      ID, 8, 101, llvm::MemoryBuffer::getMemBufferCopy("int xy;\n", "a.h"));
+  EXPECT_EQ("int xy;\n", Newer->getBuffer());
+  EXPECT_EQ("int x;\n", Hit->getBuffer());
+  EXPECT_EQ(nullptr, Cache.getBuffer(ID, 7, 100));
+}
+
 } // anonymous namespace
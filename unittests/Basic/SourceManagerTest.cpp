@@ -152,6 +152,72 @@ TEST_F(SourceManagerTest, getColumnNumber) {
   EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, 0, nullptr));
 }
 
+TEST_F(SourceManagerTest, getLineNumberAcrossChunks) {
+  // Lines of varying length with mixed line endings, so that lines and "\r\n"
+  // pairs straddle the boundaries of the line table chunks.
+  std::string Source;
+  std::vector<unsigned> LineStarts = {0};
+  const char *Endings[] = {"\n", "\r\n", "\r"};
+  for (unsigned I = 0; Source.size() < 5 * SrcMgr::LineOffsetMapping::ChunkSize;
+       ++I) {
+    // Lines are never empty, so a "\r" is never followed by a "\n".
+    Source.append(1 + I % 97, 'x');
+    Source += Endings[I % 3];
+    LineStarts.push_back(Source.size());
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> Buf =
+      llvm::MemoryBuffer::getMemBuffer(Source);
+  FileID MainFileID = SourceMgr.createFileID(std::move(Buf));
+  SourceMgr.setMainFileID(MainFileID);
+
+  // Query a line near the end first, then go back to the start.
+  unsigned Last = LineStarts.size() - 2;
+  EXPECT_EQ(Last + 1, SourceMgr.getLineNumber(MainFileID, LineStarts[Last]));
+  for (unsigned Line = 0; Line != LineStarts.size() - 1; ++Line) {
+    unsigned Start = LineStarts[Line];
+    unsigned LastCol = LineStarts[Line + 1] - 1;
+    EXPECT_EQ(Line + 1, SourceMgr.getLineNumber(MainFileID, Start));
+    EXPECT_EQ(Line + 1, SourceMgr.getLineNumber(MainFileID, LastCol));
+    EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, Start));
+    SourceLocation Loc = SourceMgr.translateLineCol(MainFileID, Line + 1, 1);
+    EXPECT_EQ(Start, SourceMgr.getFileOffset(Loc));
+  }
+
+  // The text ends with a newline, so the last line is empty.
+  EXPECT_EQ(LineStarts.size(),
+            SourceMgr.getLineNumber(MainFileID, Source.size()));
+}
+
+TEST_F(SourceManagerTest, getLineNumberAfterOverride) {
+  const char *Source = "int x;\n"
+                       "int y;\n";
+  std::unique_ptr<llvm::MemoryBuffer> Buf =
+      llvm::MemoryBuffer::getMemBuffer(Source);
+  const FileEntry *SourceFile =
+      FileMgr.getVirtualFile("/mainFile.cpp", Buf->getBufferSize(), 0);
+  SourceMgr.overrideFileContents(SourceFile, std::move(Buf));
+  FileID MainFileID = SourceMgr.getOrCreateFileID(SourceFile, SrcMgr::C_User);
+  SourceMgr.setMainFileID(MainFileID);
+
+  // Build the line table of the original contents.
+  EXPECT_EQ(2U, SourceMgr.getLineNumber(MainFileID, 7));
+  EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, 7));
+
+  // The new contents have more and shorter lines, the stale table would
+  // report the wrong line.
+  const char *NewSource = "x\n"
+                          "y\n"
+                          "z\n"
+                          "w\n"
+                          "v\n";
+  SourceMgr.overrideFileContents(SourceFile,
+                                 llvm::MemoryBuffer::getMemBuffer(NewSource));
+  EXPECT_EQ(4U, SourceMgr.getLineNumber(MainFileID, 7));
+  EXPECT_EQ(2U, SourceMgr.getColumnNumber(MainFileID, 7));
+  EXPECT_EQ(6U, SourceMgr.getLineNumber(MainFileID, 10));
+}
+
 TEST_F(SourceManagerTest, locationPrintTest) {
   const char *header = "#define IDENTITY(x) x\n";
 
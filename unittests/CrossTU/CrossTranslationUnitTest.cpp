@@ -12,6 +12,7 @@
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "gtest/gtest.h"
@@ -130,6 +131,99 @@ private:
   const unsigned OverrideLimit;
 };
 
+/// Imports the definitions of f and g, which live in two different AST files,
+/// with a memory budget that only fits one AST.
+class CTUEvictionASTConsumer : public clang::ASTConsumer {
+public:
+  explicit CTUEvictionASTConsumer(clang::CompilerInstance &CI, bool *Success)
+      : CTU(CI), Success(Success) {}
+
+  void HandleTranslationUnit(ASTContext &Ctx) {
+    const FunctionDecl *F = nullptr, *G = nullptr;
+    for (const Decl *D : Ctx.getTranslationUnitDecl()->decls()) {
+      if (const auto *FD = dyn_cast<FunctionDecl>(D)) {
+        if (FD->getName() == "f")
+          F = FD;
+        else if (FD->getName() == "g")
+          G = FD;
+      }
+    }
+    ASSERT_TRUE(F && G);
+
+    int IndexFD;
+    llvm::SmallString<256> IndexFileName;
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("index", "txt", IndexFD,
+                                                    IndexFileName));
+    llvm::ToolOutputFile IndexFile(IndexFileName, IndexFD);
+
+    // The AST files and the sources they reference must exist until the end
+    // of the test.
+    std::vector<std::unique_ptr<llvm::ToolOutputFile>> Files;
+    auto SaveAST = [&](StringRef Name, StringRef USR, StringRef SourceText) {
+      int SourceFD;
+      llvm::SmallString<256> SourceFileName;
+      ASSERT_FALSE(llvm::sys::fs::createTemporaryFile(Name, "cpp", SourceFD,
+                                                      SourceFileName));
+      Files.push_back(
+          llvm::make_unique<llvm::ToolOutputFile>(SourceFileName, SourceFD));
+      Files.back()->os() << SourceText;
+      Files.back()->os().flush();
+
+      int ASTFD;
+      llvm::SmallString<256> ASTFileName;
+      ASSERT_FALSE(
+          llvm::sys::fs::createTemporaryFile(Name, "ast", ASTFD, ASTFileName));
+      Files.push_back(
+          llvm::make_unique<llvm::ToolOutputFile>(ASTFileName, ASTFD));
+      tooling::buildASTFromCode(SourceText, SourceFileName)
+          ->Save(ASTFileName.str());
+      IndexFile.os() << USR << " " << ASTFileName << "\n";
+    };
+    SaveAST("f_ast", "c:@F@f#I#", "int f(int) { return 0; }\n");
+    SaveAST("g_ast", "c:@F@g#I#", "int g(int) { return 1; }\n");
+    IndexFile.os().flush();
+
+    CTU.setMemoryBudget(1);
+    llvm::Expected<const FunctionDecl *> NewF =
+        CTU.getCrossTUDefinition(F, "", IndexFileName);
+    ASSERT_TRUE(bool(NewF));
+    EXPECT_TRUE(CTU.getImportedFromSourceLocation((*NewF)->getLocation()));
+
+    // Loading the AST of g evicts the one of f. The definition of f that was
+    // already imported is not affected.
+    llvm::Expected<const FunctionDecl *> NewG =
+        CTU.getCrossTUDefinition(G, "", IndexFileName);
+    ASSERT_TRUE(bool(NewG));
+    EXPECT_TRUE(CTU.getImportedFromSourceLocation((*NewG)->getLocation()));
+    EXPECT_FALSE(CTU.getImportedFromSourceLocation((*NewF)->getLocation()));
+    EXPECT_TRUE((*NewF)->hasBody());
+
+    // The evicted AST is loaded again on demand.
+    llvm::Expected<ASTUnit *> FUnit =
+        CTU.loadExternalAST("c:@F@f#I#", "", IndexFileName);
+    ASSERT_TRUE(bool(FUnit));
+    *Success = true;
+  }
+
+private:
+  CrossTranslationUnitContext CTU;
+  bool *Success;
+};
+
+class CTUEvictionAction : public clang::ASTFrontendAction {
+public:
+  CTUEvictionAction(bool *Success) : Success(Success) {}
+
+protected:
+  std::unique_ptr<clang::ASTConsumer>
+  CreateASTConsumer(clang::CompilerInstance &CI, StringRef) override {
+    return llvm::make_unique<CTUEvictionASTConsumer>(CI, Success);
+  }
+
+private:
+  bool *Success;
+};
+
 } // end namespace
 
 TEST(CrossTranslationUnit, CanLoadFunctionDefinition) {
@@ -146,6 +240,13 @@ TEST(CrossTranslationUnit, RespectsLoadThreshold) {
   EXPECT_FALSE(Success);
 }
 
+TEST(CrossTranslationUnit, EvictsASTsOverMemoryBudget) {
+  bool Success = false;
+  EXPECT_TRUE(tooling::runToolOnCode(new CTUEvictionAction(&Success),
+                                     "int f(int); int g(int);"));
+  EXPECT_TRUE(Success);
+}
+
 TEST(CrossTranslationUnit, IndexFormatCanBeParsed) {
   llvm::StringMap<std::string> Index;
   Index["a"] = "/b/f1";
@@ -193,5 +294,43 @@ TEST(CrossTranslationUnit, CTUDirIsHandledCorrectly) {
   EXPECT_EQ(ParsedIndex["a"], "/ctudir/b/c/d");
 }
 
+TEST(CrossTranslationUnit, IndexTableCanBeRead) {
+  llvm::StringMap<std::string> Index;
+  Index["a"] = "b/f1";
+  Index["c"] = "/d/f2";
+  Index["e"] = "b/f1";
+
+  llvm::SmallString<256> IndexFileName;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("index", "bin",
+                                                  IndexFileName));
+  llvm::FileRemover Remover(IndexFileName);
+  ASSERT_FALSE(bool(writeCrossTUIndexTable(Index, IndexFileName)));
+  EXPECT_TRUE(OnDiskCrossTUIndex::isOnDiskIndex(IndexFileName));
+
+  llvm::Expected<std::unique_ptr<OnDiskCrossTUIndex>> IndexOrErr =
+      OnDiskCrossTUIndex::create(IndexFileName, "/ctudir");
+  ASSERT_TRUE(bool(IndexOrErr));
+  OnDiskCrossTUIndex &Table = **IndexOrErr;
+  EXPECT_EQ(Table.lookup("a"), std::string("/ctudir/b/f1"));
+  EXPECT_EQ(Table.lookup("c"), std::string("/ctudir/d/f2"));
+  EXPECT_EQ(Table.lookup("e"), std::string("/ctudir/b/f1"));
+  EXPECT_FALSE(Table.lookup("b"));
+}
+
+TEST(CrossTranslationUnit, TextIndexIsNotIndexTable) {
+  int IndexFD;
+  llvm::SmallString<256> IndexFileName;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("index", "txt", IndexFD,
+                                                  IndexFileName));
+  llvm::ToolOutputFile IndexFile(IndexFileName, IndexFD);
+  IndexFile.os() << "c:@F@f#I# f.ast\n";
+  IndexFile.os().flush();
+  EXPECT_FALSE(OnDiskCrossTUIndex::isOnDiskIndex(IndexFileName));
+  llvm::Expected<std::unique_ptr<OnDiskCrossTUIndex>> IndexOrErr =
+      OnDiskCrossTUIndex::create(IndexFileName, "");
+  EXPECT_FALSE(bool(IndexOrErr));
+  llvm::consumeError(IndexOrErr.takeError());
+}
+
 } // end namespace cross_tu
 } // end namespace clang
@@ -17,6 +17,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -76,7 +77,9 @@ public:
     RemappedFiles[Filename] = Contents;
   }
 
-  std::unique_ptr<ASTUnit> ParseAST(const std::string &EntryFile) {
+  std::unique_ptr<ASTUnit>
+  ParseAST(const std::string &EntryFile,
+           std::shared_ptr<PreambleStore> Preambles = nullptr) {
     PCHContainerOpts = std::make_shared<PCHContainerOperations>();
     std::shared_ptr<CompilerInvocation> CI(new CompilerInvocation);
     CI->getFrontendOpts().Inputs.push_back(
@@ -97,7 +100,10 @@ public:
 
     std::unique_ptr<ASTUnit> AST = ASTUnit::LoadFromCompilerInvocation(
         CI, PCHContainerOpts, Diags, FileMgr, false, CaptureDiagsKind::None,
-        /*PrecompilePreambleAfterNParses=*/1);
+        /*PrecompilePreambleAfterNParses=*/1, TU_Complete,
+        /*CacheCodeCompletionResults=*/false,
+        /*IncludeBriefCommentsInCodeCompletion=*/false,
+        /*UserFilesAreVolatile=*/false, std::move(Preambles));
     return AST;
   }
 
@@ -262,4 +268,79 @@ TEST_F(PCHPreambleTest, ParseWithBom) {
   ASSERT_LE(HeaderReadCount, GetFileReadCount(Header));
 }
 
+TEST_F(PCHPreambleTest, PreambleIsSharedThroughStore) {
+  SmallString<128> StoreDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("preamble-store", StoreDir));
+  auto Store = std::make_shared<PreambleStore>(StoreDir);
+
+  std::string Header = "//./header.h";
+  std::string Main = "//./main.cpp";
+  std::string MainContents = "#include \"//./header.h\"\n"
+                             "int main() { return ZERO; }\n";
+  AddFile(Header, "#define ZERO 0\n");
+  AddFile(Main, MainContents);
+
+  std::unique_ptr<ASTUnit> First(ParseAST(Main, Store));
+  ASSERT_TRUE(First.get());
+  ASSERT_FALSE(First->getDiagnostics().hasErrorOccurred());
+  ASSERT_EQ(First->getPreambleCounterForTests(), 1U);
+
+  // Make the stored preamble look like it was last used long ago.
+  std::error_code EC;
+  sys::fs::directory_iterator Entry(StoreDir, EC);
+  ASSERT_FALSE(EC);
+  ASSERT_TRUE(Entry != sys::fs::directory_iterator());
+  std::string EntryPath = Entry->path();
+  sys::TimePoint<> LongAgo = sys::toTimePoint(946684800); // 2000-01-01
+  int FD;
+  ASSERT_FALSE(sys::fs::openFileForRead(EntryPath, FD));
+  ASSERT_FALSE(sys::fs::setLastAccessAndModificationTime(FD, LongAgo, LongAgo));
+  sys::Process::SafelyCloseFileDescriptor(FD);
+
+  // The second translation unit loads the preamble from the store instead of
+  // building it again, and marks it as recently used.
+  unsigned HeaderReadCount = GetFileReadCount(Header);
+  std::unique_ptr<ASTUnit> Second(ParseAST(Main, Store));
+  ASSERT_TRUE(Second.get());
+  ASSERT_FALSE(Second->getDiagnostics().hasErrorOccurred());
+  ASSERT_EQ(Second->getPreambleCounterForTests(), 0U);
+  ASSERT_EQ(HeaderReadCount, GetFileReadCount(Header));
+  sys::fs::file_status Status;
+  ASSERT_FALSE(sys::fs::status(EntryPath, Status));
+  EXPECT_GT(Status.getLastModificationTime(), LongAgo);
+
+  // Changing the header invalidates the stored preamble.
+  ResetVFS();
+  AddFile(Header, "#define ZERO 10\n");
+  AddFile(Main, MainContents);
+  std::unique_ptr<ASTUnit> Third(ParseAST(Main, Store));
+  ASSERT_TRUE(Third.get());
+  ASSERT_FALSE(Third->getDiagnostics().hasErrorOccurred());
+  ASSERT_EQ(Third->getPreambleCounterForTests(), 1U);
+
+  sys::fs::remove_directories(StoreDir);
+}
+
+TEST_F(PCHPreambleTest, PreambleStoreIsTrimmedToSizeLimit) {
+  SmallString<128> StoreDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("preamble-store", StoreDir));
+  auto Store = std::make_shared<PreambleStore>(StoreDir, /*SizeLimit=*/1);
+
+  std::string Header = "//./header.h";
+  std::string Main = "//./main.cpp";
+  AddFile(Header, "#define ZERO 0\n");
+  AddFile(Main, "#include \"//./header.h\"\n"
+                "int main() { return ZERO; }\n");
+
+  // Every preamble is larger than the limit, so none is kept.
+  std::unique_ptr<ASTUnit> AST(ParseAST(Main, Store));
+  ASSERT_TRUE(AST.get());
+  ASSERT_EQ(AST->getPreambleCounterForTests(), 1U);
+  std::error_code EC;
+  EXPECT_TRUE(sys::fs::directory_iterator(StoreDir, EC) ==
+              sys::fs::directory_iterator());
+
+  sys::fs::remove_directories(StoreDir);
+}
+
 } // anonymous namespace
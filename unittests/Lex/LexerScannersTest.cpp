@@ -0,0 +1,178 @@
+//===- unittests/Lex/LexerScannersTest.cpp - Lexer scanner tests ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/LexerScanners.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <string>
+
+using namespace clang;
+using namespace clang::lexer_scan;
+
+namespace {
+
+const ScannerKind AllKinds[] = {ScannerKind::Scalar, ScannerKind::SSE2,
+                                ScannerKind::AVX2};
+
+const char *kindName(ScannerKind Kind) {
+  switch (Kind) {
+  case ScannerKind::Scalar:
+    return "scalar";
+  case ScannerKind::SSE2:
+    return "sse2";
+  case ScannerKind::AVX2:
+    return "avx2";
+  }
+  llvm_unreachable("unknown scanner kind");
+}
+
+/// Restores the scanner selection at the end of a test.
+class LexerScannersTest : public ::testing::Test {
+protected:
+  LexerScannersTest() : SavedKind(getScannerKind()) {}
+  ~LexerScannersTest() override { setScannerKind(SavedKind); }
+
+  /// Run all the scanners on \p Source with every available implementation,
+  /// and check that they stop at the same place as the scalar ones.
+  void checkAllKinds(const std::string &Source) {
+    const char *Start = Source.c_str();
+    const char *End = Start + Source.size();
+    for (size_t Offset = 0; Offset <= Source.size(); ++Offset) {
+      const char *Ptr = Start + Offset;
+      ASSERT_TRUE(setScannerKind(ScannerKind::Scalar));
+      const char *Expected[] = {
+          skipLineCommentBody(Ptr, End), skipHorizontalWhitespace(Ptr, End),
+          skipIdentifierBody(Ptr, End), skipStringLiteralBody(Ptr, End),
+          skipRawStringLiteralBody(Ptr, End)};
+      for (ScannerKind Kind : AllKinds) {
+        if (!setScannerKind(Kind))
+          continue;
+        SCOPED_TRACE(kindName(Kind));
+        EXPECT_EQ(Expected[0], skipLineCommentBody(Ptr, End));
+        EXPECT_EQ(Expected[1], skipHorizontalWhitespace(Ptr, End));
+        EXPECT_EQ(Expected[2], skipIdentifierBody(Ptr, End));
+        EXPECT_EQ(Expected[3], skipStringLiteralBody(Ptr, End));
+        EXPECT_EQ(Expected[4], skipRawStringLiteralBody(Ptr, End));
+      }
+    }
+  }
+
+  ScannerKind SavedKind;
+};
+
+TEST_F(LexerScannersTest, ScalarAlwaysAvailable) {
+  EXPECT_TRUE(isScannerKindAvailable(ScannerKind::Scalar));
+  EXPECT_TRUE(isScannerKindAvailable(SavedKind));
+}
+
+TEST_F(LexerScannersTest, StopCharacters) {
+  std::string Body(100, 'a');
+  const char *Stops = "\n\r\t\f\v $?\\\"()_09AZaz@[`{/\x7f\x80\xff";
+  for (const char *S = Stops; *S; ++S) {
+    for (size_t Pos : {0, 15, 16, 31, 32, 33, 63, 99}) {
+      std::string Source = Body;
+      Source[Pos] = *S;
+      checkAllKinds(Source);
+    }
+  }
+}
+
+TEST_F(LexerScannersTest, StopsAtNull) {
+  std::string Source(80, ' ');
+  Source[40] = '\0';
+  checkAllKinds(Source);
+  Source.assign(80, 'x');
+  Source[40] = '\0';
+  checkAllKinds(Source);
+}
+
+TEST_F(LexerScannersTest, RandomRuns) {
+  const char Alphabet[] = " \t\f\vaZz_09$?\\\"()\n\r/\x80";
+  std::mt19937 Rand(42);
+  for (unsigned I = 0; I != 200; ++I) {
+    // Long runs of a single character, broken up by random characters.
+    std::string Source;
+    char Run = Alphabet[Rand() % (sizeof(Alphabet) - 1)];
+    for (unsigned Len = Rand() % 100; Len; --Len)
+      Source.push_back(Rand() % 8 ? Run
+                                  : Alphabet[Rand() % (sizeof(Alphabet) - 1)]);
+    checkAllKinds(Source);
+  }
+}
+
+/// Generate a header with the shape of the large generated headers that the
+/// scanners speed up: long comments, deep indentation, long identifiers and
+/// long string literals.
+std::string generateHeader(unsigned NumDecls) {
+  std::string Source;
+  llvm::raw_string_ostream OS(Source);
+  for (unsigned I = 0; I != NumDecls; ++I) {
+    OS << "// Generated declaration number " << I
+       << " of the benchmark header, with a long explanatory comment.\n"
+       << "namespace generated_namespace_" << I << " {\n"
+       << "                static const char *generated_string_" << I
+       << " = \"a long string literal that is part of generated table " << I
+       << "\";\n"
+       << "                static const char *generated_raw_string_" << I
+       << " = R\"(raw (string) literal for table entry " << I << ")\";\n"
+       << "                int very_long_generated_identifier_name_number_"
+       << I << "_in_the_table;\n"
+       << "}\n";
+  }
+  return OS.str();
+}
+
+unsigned lexRaw(const std::string &Source) {
+  LangOptions LangOpts;
+  LangOpts.CPlusPlus = LangOpts.CPlusPlus11 = true;
+  Lexer L(SourceLocation(), LangOpts, Source.c_str(), Source.c_str(),
+          Source.c_str() + Source.size());
+  L.SetCommentRetentionState(false);
+  unsigned NumTokens = 0;
+  Token Tok;
+  while (!L.LexFromRawLexer(Tok))
+    ++NumTokens;
+  return NumTokens;
+}
+
+TEST_F(LexerScannersTest, SameTokens) {
+  std::string Source = generateHeader(100);
+  ASSERT_TRUE(setScannerKind(ScannerKind::Scalar));
+  unsigned Expected = lexRaw(Source);
+  for (ScannerKind Kind : AllKinds) {
+    if (!setScannerKind(Kind))
+      continue;
+    SCOPED_TRACE(kindName(Kind));
+    EXPECT_EQ(Expected, lexRaw(Source));
+  }
+}
+
+// A microbenchmark of the raw lexer on a large generated header. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*.
+TEST_F(LexerScannersTest, DISABLED_Benchmark) {
+  std::string Source = generateHeader(200000);
+  for (ScannerKind Kind : AllKinds) {
+    if (!setScannerKind(Kind))
+      continue;
+    llvm::TimeRecord Start = llvm::TimeRecord::getCurrentTime(true);
+    unsigned NumTokens = 0;
+    for (unsigned I = 0; I != 5; ++I)
+      NumTokens += lexRaw(Source);
+    llvm::TimeRecord Elapsed = llvm::TimeRecord::getCurrentTime(false);
+    Elapsed -= Start;
+    llvm::outs() << kindName(Kind) << ": " << NumTokens << " tokens, "
+                 << 5 * Source.size() / Elapsed.getWallTime() / (1 << 20)
+                 << " MiB/s\n";
+  }
+}
+
+} // end anonymous namespace
@@ -116,4 +116,35 @@ TEST(InMemoryModuleCacheTest, finalizePCM) {
   EXPECT_TRUE(Cache.isPCMFinal("B"));
 }
 
+TEST(InMemoryModuleCacheTest, replaceWrittenPCM) {
+  InMemoryModuleCache Cache;
+  EXPECT_FALSE(Cache.isPCMWritten("B"));
+  Cache.addWrittenPCM("B", MemoryBuffer::getMemBufferCopy("data:1"));
+  EXPECT_EQ(InMemoryModuleCache::Final, Cache.getPCMState("B"));
+  EXPECT_TRUE(Cache.isPCMWritten("B"));
+
+  // Buffers with other contents are rejected.
+  EXPECT_FALSE(
+      Cache.replaceWrittenPCM("B", MemoryBuffer::getMemBufferCopy("data:2")));
+  EXPECT_TRUE(Cache.isPCMWritten("B"));
+
+  auto Mapped = MemoryBuffer::getMemBufferCopy("data:1");
+  auto *RawMapped = Mapped.get();
+  EXPECT_TRUE(Cache.replaceWrittenPCM("B", std::move(Mapped)));
+  EXPECT_EQ(RawMapped, Cache.lookupPCM("B"));
+  EXPECT_TRUE(Cache.isPCMFinal("B"));
+
+  // The buffer is only replaced once.
+  EXPECT_FALSE(Cache.isPCMWritten("B"));
+  EXPECT_FALSE(
+      Cache.replaceWrittenPCM("B", MemoryBuffer::getMemBufferCopy("data:1")));
+  EXPECT_EQ(RawMapped, Cache.lookupPCM("B"));
+
+  // Neither are PCMs that were not stored by addWrittenPCM.
+  Cache.addBuiltPCM("C", MemoryBuffer::getMemBufferCopy("data:1"));
+  EXPECT_FALSE(Cache.isPCMWritten("C"));
+  EXPECT_FALSE(
+      Cache.replaceWrittenPCM("C", MemoryBuffer::getMemBufferCopy("data:1")));
+}
+
 } // namespace
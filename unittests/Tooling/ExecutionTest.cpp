@@ -18,6 +18,7 @@
 #include "clang/Tooling/StandaloneExecution.h"
 #include "clang/Tooling/ToolExecutorPluginRegistry.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/Support/FileSystem.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <algorithm>
@@ -293,5 +294,50 @@ TEST(AllTUsToolTest, ManyFiles) {
   EXPECT_THAT(ExpectedSymbols, ::testing::UnorderedElementsAreArray(Results));
 }
 
+TEST(AllTUsToolTest, ResultsOnDisk) {
+  SmallString<128> Dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("all-tus-results", Dir));
+  std::vector<std::string> Files = {"a.cc", "b.cc", "c.cc"};
+  FixedCompilationDatabaseWithFiles Compilations(".", Files,
+                                                 std::vector<std::string>());
+  AllTUsToolExecutor Executor(Compilations, /*ThreadCount=*/2);
+  ASSERT_FALSE(bool(Executor.setResultsDirectory(Dir, /*NumShards=*/2)));
+  Executor.mapVirtualFile("a.cc", "void x() {}");
+  Executor.mapVirtualFile("b.cc", "void y() {}");
+  Executor.mapVirtualFile("c.cc", "void z() {}");
+
+  auto Err = Executor.execute(std::unique_ptr<FrontendActionFactory>(
+      new ReportResultActionFactory(Executor.getExecutionContext())));
+  ASSERT_TRUE(!Err);
+  EXPECT_THAT(
+      Executor.getToolResults()->AllKVResults(),
+      ::testing::UnorderedElementsAre(Named("x"), Named("y"), Named("z")));
+  llvm::sys::fs::remove_directories(Dir);
+}
+
+TEST(OnDiskToolResultsTest, ReadBack) {
+  SmallString<128> Dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("tool-results", Dir));
+  auto Results = OnDiskToolResults::create(Dir, /*NumShards=*/3);
+  ASSERT_TRUE(bool(Results));
+  (*Results)->addResult("a", "1");
+  (*Results)->addResult("multi\nline", "value 2\nwith 10 spaces");
+  (*Results)->addResult("", "");
+  (*Results)->addResult("a", "3");
+  ASSERT_FALSE(bool((*Results)->flush()));
+  EXPECT_EQ(3u, (*Results)->getShardPaths().size());
+
+  typedef std::pair<std::string, std::string> KV;
+  std::vector<KV> Read;
+  (*Results)->forEachResult(
+      [&](StringRef Key, StringRef Value) { Read.push_back(KV(Key, Value)); });
+  EXPECT_THAT(Read, ::testing::UnorderedElementsAre(
+                        KV("a", "1"), KV("a", "3"),
+                        KV("multi\nline", "value 2\nwith 10 spaces"),
+                        KV("", "")));
+  EXPECT_EQ(4u, (*Results)->AllKVResults().size());
+  llvm::sys::fs::remove_directories(Dir);
+}
+
 } // end namespace tooling
 } // end namespace clang